@@ -0,0 +1,165 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CLOCK_TREE_H_
+#define CLOCK_TREE_H_
+
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Compile time model of the STM32F0 clock tree.
+//
+// The PLL source and multiplier and the bus prescalers are given by
+// the OS_USE_CLOCK_* and OS_INTEGER_CLOCK_* definitions below; the
+// preprocessor checks them against the device limits, and computes
+// the bus frequencies and the RCC/FLASH register values, so the clock
+// setup in __initialize_hardware_early() is a fixed sequence of
+// stores, and the peripheral clocks are constants (CLOCK_*_HZ, or
+// clock_tree::* in C++) instead of run time divisions of
+// SystemCoreClock.
+//
+// By default the PLL runs from HSI/2, at 48 MHz, which needs no
+// external parts (the HSE crystal is not fitted on the discovery
+// boards). With OS_USE_CLOCK_HSE defined, it runs from the HSE
+// (OS_INTEGER_CLOCK_HSE_HZ, a plain number, defaults to HSE_VALUE);
+// on the Nucleo boards the HSE is the 8 MHz MCO output of the
+// ST-LINK, so also define OS_USE_CLOCK_HSE_BYPASS.
+
+#if !defined(OS_INTEGER_CLOCK_HSE_HZ)
+#define OS_INTEGER_CLOCK_HSE_HZ                 (HSE_VALUE)
+#endif
+
+// PLL input = HSE / PREDIV (1-16), or HSI / 2.
+#if !defined(OS_INTEGER_CLOCK_PLL_PREDIV)
+#define OS_INTEGER_CLOCK_PLL_PREDIV             (1)
+#endif
+
+// SYSCLK = PLL input * MUL (2-16).
+#if !defined(OS_INTEGER_CLOCK_PLL_MUL)
+#if defined(OS_USE_CLOCK_HSE)
+#define OS_INTEGER_CLOCK_PLL_MUL \
+  (48000000 / (OS_INTEGER_CLOCK_HSE_HZ / OS_INTEGER_CLOCK_PLL_PREDIV))
+#else
+#define OS_INTEGER_CLOCK_PLL_MUL                (12)
+#endif
+#endif
+
+// HCLK = SYSCLK / AHB divider (1, 2, 4, ..., 512, except 32).
+#if !defined(OS_INTEGER_CLOCK_AHB_DIV)
+#define OS_INTEGER_CLOCK_AHB_DIV                (1)
+#endif
+
+// PCLK = HCLK / APB divider (1, 2, 4, 8, 16).
+#if !defined(OS_INTEGER_CLOCK_APB_DIV)
+#define OS_INTEGER_CLOCK_APB_DIV                (1)
+#endif
+
+// ----- Frequencies ----------------------------------------------------------
+
+#if defined(OS_USE_CLOCK_HSE)
+#define CLOCK_PLL_IN_HZ \
+  (OS_INTEGER_CLOCK_HSE_HZ / OS_INTEGER_CLOCK_PLL_PREDIV)
+#else
+// HSI_VALUE is cast, not usable by #if.
+#define CLOCK_PLL_IN_HZ                         (8000000 / 2)
+#endif
+
+#define CLOCK_SYSCLK_HZ \
+  (CLOCK_PLL_IN_HZ * OS_INTEGER_CLOCK_PLL_MUL)
+#define CLOCK_HCLK_HZ \
+  (CLOCK_SYSCLK_HZ / OS_INTEGER_CLOCK_AHB_DIV)
+#define CLOCK_PCLK_HZ \
+  (CLOCK_HCLK_HZ / OS_INTEGER_CLOCK_APB_DIV)
+
+// The timers run at twice the bus clock when the bus is divided.
+#define CLOCK_TIM_HZ \
+  (OS_INTEGER_CLOCK_APB_DIV == 1 ? CLOCK_PCLK_HZ : 2 * CLOCK_PCLK_HZ)
+
+// ----- Checks ---------------------------------------------------------------
+
+#if (OS_INTEGER_CLOCK_PLL_PREDIV < 1) || (OS_INTEGER_CLOCK_PLL_PREDIV > 16)
+#error "PLL_PREDIV out of range (1-16)"
+#endif
+
+#if defined(OS_USE_CLOCK_HSE) \
+  && ((OS_INTEGER_CLOCK_HSE_HZ < 4000000) || (OS_INTEGER_CLOCK_HSE_HZ > 32000000))
+#error "HSE out of range (4-32 MHz)"
+#endif
+
+#if (CLOCK_PLL_IN_HZ < 1000000) || (CLOCK_PLL_IN_HZ > 24000000)
+#error "PLL input out of range (1-24 MHz)"
+#endif
+
+#if (OS_INTEGER_CLOCK_PLL_MUL < 2) || (OS_INTEGER_CLOCK_PLL_MUL > 16)
+#error "PLL_MUL out of range (2-16)"
+#endif
+
+#if (CLOCK_SYSCLK_HZ < 16000000) || (CLOCK_SYSCLK_HZ > 48000000)
+#error "PLL output out of range (16-48 MHz)"
+#endif
+
+#if (OS_INTEGER_CLOCK_AHB_DIV != 1) && (OS_INTEGER_CLOCK_AHB_DIV != 2) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 4) && (OS_INTEGER_CLOCK_AHB_DIV != 8) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 16) && (OS_INTEGER_CLOCK_AHB_DIV != 64) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 128) && (OS_INTEGER_CLOCK_AHB_DIV != 256) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 512)
+#error "AHB divider must be 1, 2, 4, 8, 16, 64, 128, 256 or 512"
+#endif
+
+#if (OS_INTEGER_CLOCK_APB_DIV != 1) && (OS_INTEGER_CLOCK_APB_DIV != 2) \
+  && (OS_INTEGER_CLOCK_APB_DIV != 4) && (OS_INTEGER_CLOCK_APB_DIV != 8) \
+  && (OS_INTEGER_CLOCK_APB_DIV != 16)
+#error "APB divider must be 1, 2, 4, 8 or 16"
+#endif
+
+// ----- Register values ------------------------------------------------------
+
+// Flash wait states for SYSCLK.
+#define CLOCK_FLASH_LATENCY                     (CLOCK_SYSCLK_HZ <= 24000000 ? 0 : 1)
+
+#define CLOCK_HPRE_BITS(_D) \
+  ((_D) == 1 ? 0 : (_D) == 2 ? 8 : (_D) == 4 ? 9 : (_D) == 8 ? 10 \
+      : (_D) == 16 ? 11 : (_D) == 64 ? 12 : (_D) == 128 ? 13 \
+      : (_D) == 256 ? 14 : 15)
+#define CLOCK_PPRE_BITS(_D) \
+  ((_D) == 1 ? 0 : (_D) == 2 ? 4 : (_D) == 4 ? 5 : (_D) == 8 ? 6 : 7)
+
+#if defined(OS_USE_CLOCK_HSE)
+#define CLOCK_RCC_CFGR_PLLSRC                   (RCC_CFGR_PLLSRC_PREDIV1)
+#else
+#define CLOCK_RCC_CFGR_PLLSRC                   (0)
+#endif
+
+// The prescalers and PLL only; SW is added when switching to the PLL.
+#define CLOCK_RCC_CFGR \
+  ((uint32_t) ((CLOCK_HPRE_BITS(OS_INTEGER_CLOCK_AHB_DIV) << 4) \
+      | (CLOCK_PPRE_BITS(OS_INTEGER_CLOCK_APB_DIV) << 8) \
+      | CLOCK_RCC_CFGR_PLLSRC \
+      | ((OS_INTEGER_CLOCK_PLL_MUL - 2) << 18)))
+
+#define CLOCK_RCC_CFGR2 \
+  ((uint32_t) (OS_INTEGER_CLOCK_PLL_PREDIV - 1))
+
+#define CLOCK_FLASH_ACR \
+  ((uint32_t) (CLOCK_FLASH_LATENCY | FLASH_ACR_PRFTBE))
+
+// ----------------------------------------------------------------------------
+
+#if defined(__cplusplus)
+
+namespace clock_tree
+{
+  constexpr uint32_t sysclk_hz = CLOCK_SYSCLK_HZ;
+  constexpr uint32_t hclk_hz = CLOCK_HCLK_HZ;
+  constexpr uint32_t pclk_hz = CLOCK_PCLK_HZ;
+  constexpr uint32_t tim_hz = CLOCK_TIM_HZ;
+}
+
+#endif // defined(__cplusplus)
+
+// ----------------------------------------------------------------------------
+
+#endif // CLOCK_TREE_H_
@@ -0,0 +1,46 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef SEMIHOSTING_LATENCY_H_
+#define SEMIHOSTING_LATENCY_H_
+
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Micro-benchmark of the semihosting trap-to-return latency.
+//
+// Issues a number of cheap semihosting calls (SYS_ERRNO) and measures
+// the core cycles between the instruction before the BKPT and the
+// one after it, using the SysTick current value (ARMv6-M has no
+// DWT cycle counter). With the debugger attached the host processes
+// the call; without it, the HardFault trampoline does.
+//
+// SysTick must be already running with a reload period longer than
+// the longest trap (the 1 ms timer_systick is more than enough).
+
+class semihosting_latency
+{
+public:
+  typedef uint32_t cycles_t;
+
+  semihosting_latency () = default;
+
+  void
+  run (unsigned int count);
+
+  void
+  report (void);
+
+private:
+  cycles_t min_ = 0;
+  cycles_t max_ = 0;
+  uint64_t total_ = 0;
+  unsigned int count_ = 0;
+};
+
+// ----------------------------------------------------------------------------
+
+#endif // SEMIHOSTING_LATENCY_H_
@@ -10,6 +10,11 @@
 #include <stdlib.h>
 #include <timer_systick.h>
 #include "diag/Trace.h"
+#include "cortexm/critical_section.h"
+
+#if defined(OS_BENCHMARK_SEMIHOSTING_LATENCY)
+#include <semihosting_latency.h>
+#endif
 
 // ----------------------------------------------------------------------------
 //
@@ -82,7 +87,12 @@ blink_led blink_leds[2] =
 #define BUTTON_PIN_MASK(_N)             (1 << (_N))
 #define BUTTON_RCC_MASKx(_N)         	(RCC_AHBPeriph_GPIOA << (_N))
 
-int button_pressed = 0;
+// The button interrupt priority; the critical sections in main()
+// mask it, and all lower priority interrupts.
+#define BUTTON_IRQ_PRIORITY             (2)
+
+// Set by the interrupt handler, polled by main().
+volatile int button_pressed = 0;
 
 // ----- main() ---------------------------------------------------------------
 
@@ -116,6 +126,14 @@ main (int argc, char* argv[])
   timer_systick timer;
   timer.start ();
 
+#if defined(OS_BENCHMARK_SEMIHOSTING_LATENCY)
+  // Measure the cost of the semihosting calls, with or without
+  // the debugger attached.
+  semihosting_latency latency;
+  latency.run (100);
+  latency.report ();
+#endif
+
 #define LOOP_COUNT (1 << (sizeof(blink_leds) / sizeof(blink_leds[0])))
 
   int loops = LOOP_COUNT;
@@ -150,6 +168,7 @@ main (int argc, char* argv[])
   EXTI->RTSR |= BUTTON_PIN_MASK(BUTTON_PIN_NUMBER);
   EXTI->FTSR |= BUTTON_PIN_MASK(BUTTON_PIN_NUMBER);
 
+  NVIC_SetPriority (EXTI0_1_IRQn, BUTTON_IRQ_PRIORITY);
   NVIC_EnableIRQ (EXTI0_1_IRQn);
 
   // --------------------------------------------------------------------------
@@ -203,14 +222,21 @@ main (int argc, char* argv[])
   // Blink binary.
   for (int i = 0; (i < loops) && (!button_pressed); i++)
     {
-      for (size_t l = 0; l < (sizeof(blink_leds) / sizeof(blink_leds[0])); ++l)
-	{
-	  blink_leds[l].toggle ();
-	  if (blink_leds[l].is_on ())
-	    {
-	      break;
-	    }
-	}
+      {
+	// The handler also drives the LEDs; prevent it from interfering
+	// with the read-modify-write done by toggle().
+	critical_section cs (BUTTON_IRQ_PRIORITY);
+
+	for (size_t l = 0; l < (sizeof(blink_leds) / sizeof(blink_leds[0]));
+	    ++l)
+	  {
+	    blink_leds[l].toggle ();
+	    if (blink_leds[l].is_on ())
+	      {
+		break;
+	      }
+	  }
+      }
 
       if (button_pressed)
 	break;
@@ -0,0 +1,56 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include <semihosting_latency.h>
+#include "arm/semihosting.h"
+#include "diag/Trace.h"
+
+// ----------------------------------------------------------------------------
+
+void
+semihosting_latency::run (unsigned int count)
+{
+  min_ = 0xFFFFFFFF;
+  max_ = 0;
+  total_ = 0;
+  count_ = count;
+
+  cycles_t reload = SysTick->LOAD + 1;
+
+  for (unsigned int i = 0; i < count; ++i)
+    {
+      cycles_t begin = SysTick->VAL;
+      call_host (SEMIHOSTING_SYS_ERRNO, nullptr);
+      cycles_t end = SysTick->VAL;
+
+      // SysTick counts down; compensate a single reload.
+      cycles_t delta = (begin >= end) ? (begin - end) : (begin + reload - end);
+
+      if (delta < min_)
+        {
+          min_ = delta;
+        }
+      if (delta > max_)
+        {
+          max_ = delta;
+        }
+      total_ += delta;
+    }
+}
+
+void
+semihosting_latency::report (void)
+{
+  if (count_ == 0)
+    {
+      return;
+    }
+
+  trace_printf ("Semihosting trap latency (%u calls): "
+                "min %u, avg %u, max %u cycles\n",
+                count_, min_, (cycles_t) (total_ / count_), max_);
+}
+
+// ----------------------------------------------------------------------------
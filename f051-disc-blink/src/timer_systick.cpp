@@ -8,34 +8,50 @@
 
 // ----------------------------------------------------------------------------
 
-#if defined(USE_HAL_DRIVER)
-extern "C" void HAL_IncTick(void);
-#endif
-
-// ----------------------------------------------------------------------------
-
-volatile timer_systick::ticks_t timer_systick::ms_delayCount;
+volatile timer_systick::ticks_t timer_systick::ms_ticks;
 
 // ----------------------------------------------------------------------------
 
 void
 timer_systick::sleep (ticks_t ticks)
 {
-  ms_delayCount = ticks;
+  ticks_t start = ms_ticks;
+
+  // Sleep until the next interrupt, SysTick at the latest; the
+  // difference is correct across the counter wrap.
+  while ((ticks_t) (ms_ticks - start) < ticks)
+    {
+      __WFI ();
+    }
+}
+
+#if defined(USE_HAL_DRIVER)
+
+static_assert(timer_systick::FREQUENCY_HZ == 1000u,
+    "The HAL tick is in milliseconds");
+
+// Replace the HAL weak definitions, which keep a second counter
+// (uwTick, incremented by HAL_IncTick()) and busy wait.
 
-  // Busy wait until the SysTick decrements the counter to zero.
-  while (ms_delayCount != 0u)
-    ;
+extern "C" uint32_t
+HAL_GetTick (void)
+{
+  return timer_systick::now ();
+}
+
+extern "C" void
+HAL_Delay (__IO uint32_t delay)
+{
+  timer_systick::sleep (delay);
 }
 
+#endif
+
 // ----- SysTick_Handler() ----------------------------------------------------
 
 extern "C" void
 SysTick_Handler (void)
 {
-#if defined(USE_HAL_DRIVER)
-  HAL_IncTick();
-#endif
   timer_systick::tick ();
 }
 
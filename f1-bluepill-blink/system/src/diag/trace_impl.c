@@ -40,6 +40,7 @@
 //#define OS_USE_TRACE_ITM
 //#define OS_USE_TRACE_SEMIHOSTING_DEBUG
 //#define OS_USE_TRACE_SEMIHOSTING_STDOUT
+//#define OS_USE_TRACE_USART
 
 #if !(defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
 #if defined(OS_USE_TRACE_ITM)
@@ -73,12 +74,25 @@ static ssize_t
 _trace_write_semihosting_debug(const char* buf, size_t nbyte);
 #endif
 
+#if defined(OS_USE_TRACE_USART)
+// In trace_usart.c.
+void
+_trace_initialize_usart (void);
+
+ssize_t
+_trace_write_usart (const char* buf, size_t nbyte);
+#endif
+
 // ----------------------------------------------------------------------------
 
 void
 trace_initialize(void)
 {
   // For regular ITM / semihosting, no inits required.
+#if defined(OS_USE_TRACE_USART)
+  // Otherwise done on the first write.
+  _trace_initialize_usart ();
+#endif
 }
 
 // ----------------------------------------------------------------------------
@@ -96,6 +110,8 @@ trace_write (const char* buf __attribute__((unused)),
   return _trace_write_semihosting_stdout(buf, nbyte);
 #elif defined(OS_USE_TRACE_SEMIHOSTING_DEBUG)
   return _trace_write_semihosting_debug(buf, nbyte);
+#elif defined(OS_USE_TRACE_USART)
+  return _trace_write_usart (buf, nbyte);
 #endif
 
   return -1;
@@ -78,6 +78,11 @@ extern "C"
   void
   HardFault_Handler_C (ExceptionStackFrame* frame, uint32_t lr);
 
+#if defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT) || defined(OS_USE_TRACE_SEMIHOSTING_DEBUG)
+  void
+  HardFault_Semihosting_C (ExceptionStackFrame* frame, uint32_t lr);
+#endif
+
 #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
   void
   UsageFault_Handler_C (ExceptionStackFrame* frame, uint32_t lr);
@@ -11,6 +11,8 @@
 
 #include "Timer.h"
 #include "BlinkLed.h"
+#include "cortexm/irq_vectors.h"
+#include "cortexm/work_queue.h"
 
 // ----------------------------------------------------------------------------
 //
@@ -126,6 +128,34 @@ BlinkLed blinkLeds[1] =
 
 #endif
 
+// ----- Button definitions ---------------------------------------------------
+
+// After an edge, the button interrupt stays masked for this long, to
+// ignore the contact bounce; then the pin is sampled again.
+#define BUTTON_DEBOUNCE_MS        (20)
+
+// The button handler only samples the pin and defers the LED update
+// to the work queue, dispatched from PendSV if OS_USE_WORK_QUEUE_PENDSV
+// is defined, or from the main loop otherwise.
+static work_queue_t button_work;
+
+// Cleared by the button handler, together with masking the interrupt;
+// set again by the work item posted from button_poll().
+static volatile bool button_armed = true;
+static volatile uint32_t button_disarmed_at;
+
+static void
+button_irq_handler(void);
+
+static void
+button_work_handler(void* arg, uint32_t timestamp);
+
+static void
+button_rearm_handler(void* arg, uint32_t timestamp);
+
+static void
+button_poll(void);
+
 // ----- main() ---------------------------------------------------------------
 
 #define BLINK_GPIOx(_N)       ((GPIO_TypeDef *)(GPIOA_BASE + (GPIOB_BASE-GPIOA_BASE)*(_N)))
@@ -193,11 +223,25 @@ main (int argc, char* argv[])
   GPIO_InitStructure.Pull = GPIO_NOPULL;
   HAL_GPIO_Init (BLINK_GPIOx(BUTTON_PORT_NUMBER), &GPIO_InitStructure);
 
+  work_queue_init (&button_work);
+#if defined(OS_USE_WORK_QUEUE_PENDSV)
+  work_queue_start_pendsv (&button_work);
+#endif
+
+  // Install the handler directly in the RAM vector table.
+  irq_attach (EXTI0_IRQn, button_irq_handler, nullptr);
   NVIC_EnableIRQ(EXTI0_IRQn);
 
   while (1)
     {
-      timer.sleep (1000);
+#if !defined(OS_USE_WORK_QUEUE_PENDSV)
+      // Run everything posted so far.
+      work_queue_dispatch (&button_work, OS_INTEGER_WORK_QUEUE_SIZE);
+#endif
+      button_poll ();
+
+      // Wait for the next interrupt (at least the SysTick).
+      __WFI ();
     }
 
   return 0;
@@ -205,40 +249,86 @@ main (int argc, char* argv[])
 
 #pragma GCC diagnostic pop
 
-extern "C" void
-EXTI0_IRQHandler(void);
+static inline int
+button_read(void)
+{
+  return ((GPIOA->IDR & BLINK_PIN_MASK(BUTTON_PIN_NUMBER)) != 0);
+}
 
-void
-EXTI0_IRQHandler(void)
+static void
+button_irq_handler(void)
 {
-  trace_printf ("EXTI\n");
-  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0);
+  // Do only the urgent part here: acknowledge and sample the pin, and
+  // ignore the bounces until button_poll() rearms the interrupt. The
+  // debounce window starts when the edge is seen, so it does not
+  // depend on the dispatch latency.
+  EXTI->IMR &= ~BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+  __HAL_GPIO_EXTI_CLEAR_IT(GPIO_PIN_0);
+  int val = button_read ();
+
+  button_disarmed_at = DWT->CYCCNT;
+  button_armed = false;
+
+  work_queue_post (&button_work, button_work_handler,
+                   reinterpret_cast<void*> (val));
+}
+
+// Called from the main loop, at least once per SysTick; rearms the
+// button once the debounce window has passed, long before the cycle
+// counter wraps.
+static void
+button_poll(void)
+{
+  if (!button_armed
+      && (DWT->CYCCNT - button_disarmed_at)
+          >= (SystemCoreClock / 1000) * BUTTON_DEBOUNCE_MS)
+    {
+      work_queue_post (&button_work, button_rearm_handler, nullptr);
+    }
 }
 
 int led_no = 0;
 int old_val = 0;
 
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+static void
+button_work_handler(void* arg, uint32_t timestamp __attribute__((unused)))
 {
-  int val = ((GPIOA->IDR & BLINK_PIN_MASK(BUTTON_PIN_NUMBER)) != 0);
+  int val = static_cast<int> (reinterpret_cast<intptr_t> (arg));
 
   if (val != old_val)
-	{
-	  if (val)
-	    {
-	      blinkLeds[led_no].turnOn ();
-	    }
-	  else
-	    {
-	      blinkLeds[led_no].turnOff ();
-#if 1
-	      led_no = (led_no + 1)
-		  % (sizeof(blinkLeds) / sizeof(blinkLeds[0]));
-	      // trace_printf ("Led %d\n", led_no);
-#endif
-	    }
-	}
+    {
+      trace_printf ("EXTI %d\n", val);
+
+      if (val)
+        {
+          blinkLeds[led_no].turnOn ();
+        }
+      else
+        {
+          blinkLeds[led_no].turnOff ();
+          led_no = (led_no + 1) % (sizeof(blinkLeds) / sizeof(blinkLeds[0]));
+        }
+    }
   old_val = val;
 }
 
+static void
+button_rearm_handler(void* arg __attribute__((unused)),
+                     uint32_t timestamp __attribute__((unused)))
+{
+  if (button_armed)
+    {
+      // Posted again before the previous one ran.
+      return;
+    }
+
+  // Unmask first, so an edge after the sample is not lost; then
+  // catch up with a change made during the debounce window.
+  button_armed = true;
+  EXTI->PR = BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+  EXTI->IMR |= BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+
+  button_work_handler (reinterpret_cast<void*> (button_read ()), 0);
+}
+
 // ----------------------------------------------------------------------------
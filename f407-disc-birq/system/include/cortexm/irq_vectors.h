@@ -0,0 +1,166 @@
+//
+// This file is part of the µOS++ III distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CORTEXM_IRQ_VECTORS_H_
+#define CORTEXM_IRQ_VECTORS_H_
+
+#include <stdint.h>
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// RAM vector table, with runtime installation of interrupt handlers.
+//
+// The flash table (__isr_vectors[]) is copied to a RAM array and VTOR
+// is pointed to it. Handlers are then installed directly in the
+// table, so the core fetches them without flash wait states, and
+// there is no extra dispatch function between the vector and the
+// handler.
+//
+// Each vector also has a user context pointer, that the handler can
+// retrieve with irq_current_context(); this allows C++ member
+// functions to be used as handlers (see irq_attach_member<>()).
+//
+// VTOR is available only on ARMv7-M; the Cortex-M0 devices can remap
+// SRAM at address 0, but this needs the vector table at the very
+// beginning of RAM, and is not supported here.
+
+#if !(defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+#error "The RAM vector table requires VTOR (ARMv7-M)"
+#endif
+
+// The number of vectors, including the 16 system exceptions; the
+// last interrupt differs between the STM32F4 lines.
+#if !defined(OS_INTEGER_IRQ_VECTORS_COUNT)
+#if defined(STM32F405xx) || defined(STM32F415xx) || defined(STM32F407xx) \
+  || defined(STM32F417xx)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + FPU_IRQn + 1)
+#elif defined(STM32F427xx) || defined(STM32F437xx) \
+  || defined(STM32F429xx) || defined(STM32F439xx)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + DMA2D_IRQn + 1)
+#elif defined(STM32F401xC) || defined(STM32F401xE)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + SPI4_IRQn + 1)
+#elif defined(STM32F411xE)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + SPI5_IRQn + 1)
+#elif defined(STM32F410Tx) || defined(STM32F410Cx) || defined(STM32F410Rx)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + LPTIM1_IRQn + 1)
+#elif defined(STM32F446xx)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + FMPI2C1_ER_IRQn + 1)
+#elif defined(STM32F469xx) || defined(STM32F479xx)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + DSI_IRQn + 1)
+#elif defined(STM32F10X_CL)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + OTG_FS_IRQn + 1)
+#elif defined(STM32F10X_HD) || defined(STM32F10X_XL)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + DMA2_Channel4_5_IRQn + 1)
+#elif defined(STM32F10X_LD) || defined(STM32F10X_MD)
+#define OS_INTEGER_IRQ_VECTORS_COUNT    (16 + USBWakeUp_IRQn + 1)
+#else
+#error "Define OS_INTEGER_IRQ_VECTORS_COUNT for this device"
+#endif
+#endif
+
+// The table must be aligned to the next power of two greater than
+// or equal to its size, but not less than 128 bytes.
+#if !defined(OS_INTEGER_IRQ_VECTORS_ALIGNMENT)
+#define OS_INTEGER_IRQ_VECTORS_ALIGNMENT (512)
+#endif
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+  typedef void
+  (*irq_handler_t) (void);
+
+  // Indexed by exception number (IRQn + 16); only for inline use.
+  extern void* volatile irq_contexts[OS_INTEGER_IRQ_VECTORS_COUNT];
+
+  /**
+   * Copy the flash vector table to RAM and switch VTOR to it.
+   * Called automatically by the first irq_attach(); can be called
+   * earlier, for example from __initialize_hardware().
+   */
+  void
+  irq_vectors_relocate (void);
+
+  /**
+   * Install a handler directly in the RAM vector table.
+   * @param irqn the interrupt number; system exceptions (negative
+   * numbers) are also accepted.
+   * @param handler the function called when the interrupt fires.
+   * @param ctx a user pointer, retrievable with irq_current_context().
+   */
+  void
+  irq_attach (IRQn_Type irqn, irq_handler_t handler, void* ctx);
+
+  /**
+   * Restore the original handler, from the flash vector table.
+   */
+  void
+  irq_detach (IRQn_Type irqn);
+
+  static inline void*
+  irq_get_context (IRQn_Type irqn);
+
+  static inline void*
+  irq_current_context (void);
+
+  // --------------------------------------------------------------------------
+
+  static inline void*
+  __attribute__((always_inline))
+  irq_get_context (IRQn_Type irqn)
+  {
+    return irq_contexts[(int32_t) irqn + 16];
+  }
+
+  /**
+   * Return the context of the running handler; valid only in handler mode.
+   */
+  static inline void*
+  __attribute__((always_inline))
+  irq_current_context (void)
+  {
+    return irq_contexts[SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk];
+  }
+
+#if defined(__cplusplus)
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#if defined(__cplusplus)
+
+// The trampoline is the function installed in the vector; the
+// member function pointer is a template argument, so the call
+// is resolved and usually inlined at compile time.
+
+template<typename T, void
+(T::*Method) (void)>
+  void
+  irq_member_trampoline (void)
+  {
+    (static_cast<T*> (irq_current_context ())->*Method) ();
+  }
+
+// Usage:
+//   irq_attach_member<button, &button::interrupt_service_routine> (
+//       EXTI0_IRQn, &user_button);
+
+template<typename T, void
+(T::*Method) (void)>
+  inline void
+  irq_attach_member (IRQn_Type irqn, T* object)
+  {
+    irq_attach (irqn, irq_member_trampoline<T, Method>, object);
+  }
+
+#endif // defined(__cplusplus)
+
+// ----------------------------------------------------------------------------
+
+#endif // CORTEXM_IRQ_VECTORS_H_
@@ -0,0 +1,127 @@
+//
+// This file is part of the µOS++ III distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CORTEXM_WORK_QUEUE_H_
+#define CORTEXM_WORK_QUEUE_H_
+
+#include <stdint.h>
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Deferred interrupt work (bottom halves).
+//
+// Interrupt handlers do only the urgent part of their job (clear the
+// source, sample the inputs) and post a small work item; the rest is
+// executed later, outside the interrupt context, by a dispatcher
+// running either from the main loop or from PendSV, at the lowest
+// exception priority.
+//
+// The queue is a bounded lock-free multi-producer single-consumer
+// ring: any number of handlers, at any priority, can post concurrently
+// (slots are reserved with LDREX/STREX), and a single dispatcher
+// consumes. Each item is time stamped with the DWT cycle counter when
+// posted, and the dispatcher keeps the maximum post-to-run latency.
+//
+// If the queue is full, the item is dropped and counted.
+
+#if !(defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+#error "The work queue requires LDREX/STREX and DWT (ARMv7-M)"
+#endif
+
+// Must be a power of 2.
+#if !defined(OS_INTEGER_WORK_QUEUE_SIZE)
+#define OS_INTEGER_WORK_QUEUE_SIZE      (16)
+#endif
+
+// The maximum number of items executed by one PendSV run; if more
+// are pending, PendSV is pended again, allowing the other pending
+// exceptions of the same priority to be served in between.
+#if !defined(OS_INTEGER_WORK_QUEUE_PENDSV_BATCH)
+#define OS_INTEGER_WORK_QUEUE_PENDSV_BATCH      (4)
+#endif
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+  /**
+   * The deferred function.
+   * @param arg the value given when posted.
+   * @param timestamp the DWT->CYCCNT value when posted.
+   */
+  typedef void
+  (*work_func_t) (void* arg, uint32_t timestamp);
+
+  typedef struct work_item_s
+  {
+    work_func_t func;
+    void* arg;
+    uint32_t timestamp;
+    // Vyukov style sequence number, to hand the slot over between
+    // the producers and the consumer.
+    volatile uint32_t sequence;
+  } work_item_t;
+
+  typedef struct work_queue_s
+  {
+    work_item_t items[OS_INTEGER_WORK_QUEUE_SIZE];
+    // Next slot to be reserved by the producers.
+    volatile uint32_t head;
+    // Next slot to be consumed.
+    uint32_t tail;
+    // Statistics.
+    volatile uint32_t dropped;
+    uint32_t executed;
+    uint32_t max_latency_cycles;
+  } work_queue_t;
+
+  /**
+   * Initialise the queue and enable the DWT cycle counter.
+   */
+  void
+  work_queue_init (work_queue_t* q);
+
+  /**
+   * Post a work item; can be called from any handler or thread.
+   * @return 1 if queued, 0 if the queue is full.
+   */
+  int
+  work_queue_post (work_queue_t* q, work_func_t func, void* arg);
+
+  /**
+   * Execute up to max_batch pending items, in the order they were posted.
+   * Must be called from a single context (the main loop or PendSV).
+   * @return the number of executed items.
+   */
+  uint32_t
+  work_queue_dispatch (work_queue_t* q, uint32_t max_batch);
+
+  /**
+   * Return non-zero if there are items waiting to be executed.
+   */
+  int
+  work_queue_is_pending (work_queue_t* q);
+
+#if defined(OS_USE_WORK_QUEUE_PENDSV)
+
+  /**
+   * Dispatch the queue from PendSV. Sets PendSV to the lowest priority;
+   * from now on, each post also pends PendSV.
+   * Not usable with RTOSes, which own PendSV.
+   */
+  void
+  work_queue_start_pendsv (work_queue_t* q);
+
+#endif // defined(OS_USE_WORK_QUEUE_PENDSV)
+
+#if defined(__cplusplus)
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // CORTEXM_WORK_QUEUE_H_
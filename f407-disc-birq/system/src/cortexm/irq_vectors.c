@@ -0,0 +1,84 @@
+//
+// This file is part of the µOS++ III distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#include "cortexm/irq_vectors.h"
+
+// ----------------------------------------------------------------------------
+
+_Static_assert(
+    (OS_INTEGER_IRQ_VECTORS_ALIGNMENT & (OS_INTEGER_IRQ_VECTORS_ALIGNMENT - 1)) == 0,
+    "OS_INTEGER_IRQ_VECTORS_ALIGNMENT must be a power of 2");
+_Static_assert(
+    OS_INTEGER_IRQ_VECTORS_ALIGNMENT >= OS_INTEGER_IRQ_VECTORS_COUNT * 4,
+    "OS_INTEGER_IRQ_VECTORS_ALIGNMENT too small for the vector table");
+_Static_assert(OS_INTEGER_IRQ_VECTORS_ALIGNMENT >= 128,
+    "OS_INTEGER_IRQ_VECTORS_ALIGNMENT must be at least 128");
+
+// The flash vector table, defined in vectors_*.c.
+extern irq_handler_t __isr_vectors[];
+
+static irq_handler_t ram_vectors[OS_INTEGER_IRQ_VECTORS_COUNT]
+__attribute__((aligned(OS_INTEGER_IRQ_VECTORS_ALIGNMENT)));
+
+void* volatile irq_contexts[OS_INTEGER_IRQ_VECTORS_COUNT];
+
+// ----------------------------------------------------------------------------
+
+void
+irq_vectors_relocate (void)
+{
+  if (SCB->VTOR == (uint32_t) ram_vectors)
+    {
+      return;
+    }
+
+  for (int i = 0; i < OS_INTEGER_IRQ_VECTORS_COUNT; ++i)
+    {
+      ram_vectors[i] = __isr_vectors[i];
+    }
+
+  // Make sure the table is in memory before the core uses it.
+  __DSB ();
+  SCB->VTOR = (uint32_t) ram_vectors;
+  __DSB ();
+  __ISB ();
+}
+
+void
+irq_attach (IRQn_Type irqn, irq_handler_t handler, void* ctx)
+{
+  int n = (int) irqn + 16;
+  if ((n < 2) || (n >= OS_INTEGER_IRQ_VECTORS_COUNT))
+    {
+      // Do not allow to change the initial SP and the reset vector.
+      return;
+    }
+
+  irq_vectors_relocate ();
+
+  // The context must be visible before the handler can be called.
+  irq_contexts[n] = ctx;
+  __DSB ();
+  ram_vectors[n] = handler;
+  __DSB ();
+}
+
+void
+irq_detach (IRQn_Type irqn)
+{
+  int n = (int) irqn + 16;
+  if ((n < 2) || (n >= OS_INTEGER_IRQ_VECTORS_COUNT))
+    {
+      return;
+    }
+
+  ram_vectors[n] = __isr_vectors[n];
+  __DSB ();
+  irq_contexts[n] = 0;
+}
+
+// ----------------------------------------------------------------------------
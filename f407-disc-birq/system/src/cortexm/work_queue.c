@@ -0,0 +1,179 @@
+//
+// This file is part of the µOS++ III distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#include "cortexm/work_queue.h"
+#include "cortexm/ExceptionHandlers.h"
+
+// ----------------------------------------------------------------------------
+
+_Static_assert(
+    (OS_INTEGER_WORK_QUEUE_SIZE & (OS_INTEGER_WORK_QUEUE_SIZE - 1)) == 0,
+    "OS_INTEGER_WORK_QUEUE_SIZE must be a power of 2");
+
+#define WORK_QUEUE_MASK (OS_INTEGER_WORK_QUEUE_SIZE - 1)
+
+#if defined(OS_USE_WORK_QUEUE_PENDSV)
+static work_queue_t* volatile pendsv_queue;
+#endif
+
+// ----------------------------------------------------------------------------
+
+void
+work_queue_init (work_queue_t* q)
+{
+  for (uint32_t i = 0; i < OS_INTEGER_WORK_QUEUE_SIZE; ++i)
+    {
+      q->items[i].sequence = i;
+    }
+  q->head = 0;
+  q->tail = 0;
+  q->dropped = 0;
+  q->executed = 0;
+  q->max_latency_cycles = 0;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+int
+work_queue_post (work_queue_t* q, work_func_t func, void* arg)
+{
+  uint32_t timestamp = DWT->CYCCNT;
+
+  uint32_t pos = q->head;
+  work_item_t* item;
+  for (;;)
+    {
+      item = &q->items[pos & WORK_QUEUE_MASK];
+      int32_t diff = (int32_t) (item->sequence - pos);
+      if (diff == 0)
+        {
+          // The slot is free; try to reserve it. Any exception entry
+          // between LDREX and STREX makes the exchange fail, and the
+          // loop retries with the updated head.
+          if (__atomic_compare_exchange_n (&q->head, &pos, pos + 1, 1,
+                                           __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+            {
+              break;
+            }
+          // pos was updated with the current head.
+        }
+      else if (diff < 0)
+        {
+          // The consumer did not release this slot yet; full.
+          __atomic_fetch_add (&q->dropped, 1, __ATOMIC_RELAXED);
+          return 0;
+        }
+      else
+        {
+          // Another producer took it; reload.
+          pos = q->head;
+        }
+    }
+
+  item->func = func;
+  item->arg = arg;
+  item->timestamp = timestamp;
+  // Publish the content before releasing the slot to the consumer.
+  __DMB ();
+  item->sequence = pos + 1;
+
+#if defined(OS_USE_WORK_QUEUE_PENDSV)
+  if (q == pendsv_queue)
+    {
+      SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+#endif
+
+  return 1;
+}
+
+uint32_t
+work_queue_dispatch (work_queue_t* q, uint32_t max_batch)
+{
+  uint32_t count = 0;
+  while (count < max_batch)
+    {
+      uint32_t pos = q->tail;
+      work_item_t* item = &q->items[pos & WORK_QUEUE_MASK];
+      if (item->sequence != pos + 1)
+        {
+          // Empty, or the producer is still filling it in.
+          break;
+        }
+      __DMB ();
+
+      work_func_t func = item->func;
+      void* arg = item->arg;
+      uint32_t timestamp = item->timestamp;
+
+      // Release the slot before running the function, so it can post
+      // again into the same queue.
+      __DMB ();
+      item->sequence = pos + OS_INTEGER_WORK_QUEUE_SIZE;
+      q->tail = pos + 1;
+
+      uint32_t latency = DWT->CYCCNT - timestamp;
+      if (latency > q->max_latency_cycles)
+        {
+          q->max_latency_cycles = latency;
+        }
+
+      func (arg, timestamp);
+      ++count;
+    }
+
+  q->executed += count;
+  return count;
+}
+
+int
+work_queue_is_pending (work_queue_t* q)
+{
+  uint32_t pos = q->tail;
+  return q->items[pos & WORK_QUEUE_MASK].sequence == pos + 1;
+}
+
+// ----------------------------------------------------------------------------
+
+#if defined(OS_USE_WORK_QUEUE_PENDSV)
+
+void
+work_queue_start_pendsv (work_queue_t* q)
+{
+  // The lowest priority, so it runs only after all other handlers
+  // returned (tail-chained).
+  NVIC_SetPriority (PendSV_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+  pendsv_queue = q;
+
+  if (work_queue_is_pending (q))
+    {
+      SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+}
+
+void __attribute__ ((section(".after_vectors")))
+PendSV_Handler (void)
+{
+  work_queue_t* q = pendsv_queue;
+  if (q == 0)
+    {
+      return;
+    }
+
+  work_queue_dispatch (q, OS_INTEGER_WORK_QUEUE_PENDSV_BATCH);
+  if (work_queue_is_pending (q))
+    {
+      // Let other exceptions of the same priority in; continue later.
+      SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    }
+}
+
+#endif // defined(OS_USE_WORK_QUEUE_PENDSV)
+
+// ----------------------------------------------------------------------------
@@ -17,7 +17,9 @@ public:
   static constexpr ticks_t FREQUENCY_HZ = 1000u;
 
 private:
-  static volatile ticks_t ms_delayCount;
+  // Ticks (milliseconds) since start(), wrapping; the only time base,
+  // with the HAL also behind HAL_GetTick().
+  static volatile ticks_t ms_ticks;
 
 public:
   // Default constructor
@@ -33,14 +35,16 @@ public:
   static void
   sleep(ticks_t ticks);
 
+  inline static ticks_t
+  now(void)
+  {
+    return ms_ticks;
+  }
+
   inline static void
   tick(void)
   {
-    // Decrement to zero the counter used by the delay routine.
-    if (ms_delayCount != 0u)
-      {
-        --ms_delayCount;
-      }
+    ++ms_ticks;
   }
 };
 
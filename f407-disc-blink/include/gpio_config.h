@@ -0,0 +1,174 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef GPIO_CONFIG_H_
+#define GPIO_CONFIG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+// ----------------------------------------------------------------------------
+
+// Batched configuration of the pins of a GPIO port.
+//
+// HAL_GPIO_Init() walks all 16 pin positions and does a read-modify-
+// write of each configuration register for every pin it sets up. Here
+// a table of pin configurations is folded, at compile time, into the
+// final register images of the port (the values and the masks of the
+// fields they cover), and gpio::configure() writes each register once:
+//
+//   constexpr gpio::pin_config leds[] =
+//     {
+//       { 12, gpio::mode::output, gpio::type::push_pull, gpio::speed::fast,
+//           gpio::pull::none, 0, false },
+//       ...
+//     };
+//   constexpr gpio::port_image leds_image = gpio::make_image (leds);
+//
+//   gpio::configure (GPIOD, leds_image);
+//
+// Only the GPIO registers are set; interrupt/event pins (EXTI) still
+// need to be configured separately. The port clock must be enabled.
+
+namespace gpio
+{
+  enum class mode : uint8_t
+  {
+    input = 0, output = 1, alternate = 2, analog = 3
+  };
+
+  enum class type : uint8_t
+  {
+    push_pull = 0, open_drain = 1
+  };
+
+  enum class speed : uint8_t
+  {
+    low = 0, medium = 1, fast = 2, high = 3
+  };
+
+  enum class pull : uint8_t
+  {
+    none = 0, up = 1, down = 2
+  };
+
+  struct pin_config
+  {
+    uint8_t pin;
+    gpio::mode mode;
+    gpio::type type;
+    gpio::speed speed;
+    gpio::pull pull;
+    // The alternate function number, for mode::alternate.
+    uint8_t af;
+    // The initial output level.
+    bool high;
+  };
+
+  // The register values, and the masks of the fields they set.
+  struct port_image
+  {
+    uint32_t moder;
+    uint32_t moder_mask;
+    uint32_t otyper;
+    uint32_t otyper_mask;
+    uint32_t ospeedr;
+    uint32_t ospeedr_mask;
+    uint32_t pupdr;
+    uint32_t pupdr_mask;
+    uint32_t afrl;
+    uint32_t afrl_mask;
+    uint32_t afrh;
+    uint32_t afrh_mask;
+    // Set and reset bits of the initial output levels.
+    uint32_t bsrr;
+  };
+
+  namespace detail
+  {
+    // Replace the field at (mask << shift) with (value << shift).
+    constexpr uint32_t
+    field (uint32_t reg, uint32_t mask, uint32_t value, uint32_t shift)
+    {
+      return (reg & ~(mask << shift)) | ((value & mask) << shift);
+    }
+
+    constexpr port_image
+    add (const port_image& img, const pin_config& c)
+    {
+      return port_image
+        {
+          field (img.moder, 3, static_cast<uint32_t> (c.mode), 2 * c.pin),
+          img.moder_mask | (3u << (2 * c.pin)),
+          field (img.otyper, 1, static_cast<uint32_t> (c.type), c.pin),
+          img.otyper_mask | (1u << c.pin),
+          field (img.ospeedr, 3, static_cast<uint32_t> (c.speed), 2 * c.pin),
+          img.ospeedr_mask | (3u << (2 * c.pin)),
+          field (img.pupdr, 3, static_cast<uint32_t> (c.pull), 2 * c.pin),
+          img.pupdr_mask | (3u << (2 * c.pin)),
+          (c.pin < 8) ? field (img.afrl, 15, c.af, 4 * c.pin) : img.afrl,
+          (c.pin < 8) ? (img.afrl_mask | (15u << (4 * c.pin))) : img.afrl_mask,
+          (c.pin >= 8) ? field (img.afrh, 15, c.af, 4 * (c.pin - 8)) : img.afrh,
+          (c.pin >= 8) ?
+              (img.afrh_mask | (15u << (4 * (c.pin - 8)))) : img.afrh_mask,
+          field (img.bsrr, 0x10001, c.high ? 1 : 0x10000, c.pin) };
+    }
+
+    template<size_t N>
+      constexpr port_image
+      fold (const pin_config (&table)[N], size_t i, const port_image& img)
+      {
+        return (i == N) ? img : fold (table, i + 1, add (img, table[i]));
+      }
+  }
+
+  // Fold a table of pin configurations into the port register images;
+  // when a pin appears more than once, the last entry wins.
+  template<size_t N>
+    constexpr port_image
+    make_image (const pin_config (&table)[N])
+    {
+      return detail::fold (table, 0, port_image
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
+    }
+
+  // Write the images, one access per register. The output levels,
+  // types, speeds, pulls and alternate functions are set before the
+  // modes, so the pins do not glitch when switched to outputs.
+  inline void
+  configure (GPIO_TypeDef* port, const port_image& img)
+  {
+    port->BSRR = img.bsrr;
+    if (img.otyper_mask)
+      {
+        port->OTYPER = (port->OTYPER & ~img.otyper_mask) | img.otyper;
+      }
+    if (img.ospeedr_mask)
+      {
+        port->OSPEEDR = (port->OSPEEDR & ~img.ospeedr_mask) | img.ospeedr;
+      }
+    if (img.pupdr_mask)
+      {
+        port->PUPDR = (port->PUPDR & ~img.pupdr_mask) | img.pupdr;
+      }
+    if (img.afrl_mask)
+      {
+        port->AFR[0] = (port->AFR[0] & ~img.afrl_mask) | img.afrl;
+      }
+    if (img.afrh_mask)
+      {
+        port->AFR[1] = (port->AFR[1] & ~img.afrh_mask) | img.afrh;
+      }
+    if (img.moder_mask)
+      {
+        port->MODER = (port->MODER & ~img.moder_mask) | img.moder;
+      }
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // GPIO_CONFIG_H_
@@ -0,0 +1,230 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef REGISTERS_H_
+#define REGISTERS_H_
+
+#include <stddef.h>
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Typed access to the peripheral registers, over the CMSIS *_TypeDef
+// layouts.
+//
+// A register is a type, reg::reg32<Address, Access>, and a field is a
+// type, reg::field<Register, Position, Width>; field::value(v) gives
+// a field_value tagged with its register, so fields of another
+// register are rejected by the compiler.
+//
+// All the values passed to one modify() call are merged, by constexpr
+// functions, into one mask and one value, so the register is read and
+// written once, whatever the number of fields; if the fields cover
+// the whole register, it is only written. write() sets the register
+// from the fields, the others zero, without reading it, and is the
+// only access allowed to write only registers (like GPIO BSRR);
+// read() is not allowed on them, and modify()/write() are not allowed
+// on read only registers.
+//
+// With constant arguments everything folds to a load, a BIC/ORR and
+// a store, as the hand written code, but with no repeated volatile
+// loads and no shift/mask arithmetic at the call site.
+
+namespace reg
+{
+  enum class access
+  {
+    read_write, //
+    read_only, //
+    write_only
+  };
+
+  template<typename Register>
+    struct field_value
+    {
+      uint32_t mask;
+      uint32_t value;
+    };
+
+  namespace detail
+  {
+    // Later values override earlier ones, for the overlapping bits.
+    template<typename Register>
+      constexpr field_value<Register>
+      combine (field_value<Register> a, field_value<Register> b)
+      {
+        return field_value<Register>
+          { a.mask | b.mask, (a.value & ~b.mask) | b.value };
+      }
+
+    template<typename Register>
+      constexpr field_value<Register>
+      merge (field_value<Register> v)
+      {
+        return v;
+      }
+
+    template<typename Register, typename ... Values>
+      constexpr field_value<Register>
+      merge (field_value<Register> v, Values ... values)
+      {
+        return combine (v, merge<Register> (values...));
+      }
+  }
+
+  template<uint32_t Address, access Access = access::read_write>
+    class reg32
+    {
+    public:
+
+      static constexpr uint32_t address = Address;
+
+      static uint32_t
+      read (void)
+      {
+        static_assert(Access != access::write_only,
+            "Cannot read a write only register");
+        return *pointer ();
+      }
+
+      // Set the given fields, the others to zero; no read.
+      template<typename ... Values>
+        static void
+        write (field_value<reg32> v, Values ... values)
+        {
+          static_assert(Access != access::read_only,
+              "Cannot write a read only register");
+          *pointer () = detail::merge<reg32> (v, values...).value;
+        }
+
+      // Set the given fields, keep the others; one read-modify-write.
+      template<typename ... Values>
+        static void
+        modify (field_value<reg32> v, Values ... values)
+        {
+          static_assert(Access == access::read_write,
+              "Read-modify-write needs a read/write register");
+          const field_value<reg32> m = detail::merge<reg32> (v, values...);
+          if (m.mask == 0xFFFFFFFFu)
+            {
+              *pointer () = m.value;
+            }
+          else
+            {
+              *pointer () = (*pointer () & ~m.mask) | m.value;
+            }
+        }
+
+    private:
+
+      static volatile uint32_t*
+      pointer (void)
+      {
+        return reinterpret_cast<volatile uint32_t*> (Address);
+      }
+    };
+
+  template<typename Register, unsigned Position, unsigned Width = 1>
+    struct field
+    {
+      static_assert(Width > 0 && Position + Width <= 32,
+          "The field must be inside the register");
+
+      static constexpr uint32_t mask =
+          (Width == 32) ? 0xFFFFFFFFu : ((1u << Width) - 1) << Position;
+
+      static constexpr field_value<Register>
+      value (uint32_t v)
+      {
+        return field_value<Register>
+          { mask, (v << Position) & mask };
+      }
+
+      // All field bits set; the usual way to enable a single bit.
+      static constexpr field_value<Register>
+      set (void)
+      {
+        return field_value<Register>
+          { mask, mask };
+      }
+
+      static uint32_t
+      read (void)
+      {
+        return (Register::read () & mask) >> Position;
+      }
+    };
+
+// The address of a register, from the CMSIS definitions.
+#define REG_ADDRESS(_PERIPH, _MEMBER) \
+  ((uint32_t) (_PERIPH##_BASE) + offsetof(_PERIPH##_TypeDef, _MEMBER))
+
+  // ----- STM32F4 registers ------------------------------------------------
+
+  namespace rcc
+  {
+    using ahb1enr = reg32<REG_ADDRESS(RCC, AHB1ENR)>;
+    using apb2enr = reg32<REG_ADDRESS(RCC, APB2ENR)>;
+
+    // GPIOAEN, GPIOBEN, ...
+    template<unsigned Port>
+      using gpioen = field<ahb1enr, Port>;
+
+    using syscfgen = field<apb2enr, 14>;
+  }
+
+  namespace syscfg
+  {
+    // EXTICR1-4, four lines each.
+    template<unsigned Line>
+      using exticr = reg32<REG_ADDRESS(SYSCFG, EXTICR) + 4 * (Line / 4)>;
+
+    // The port number of an EXTI line.
+    template<unsigned Line>
+      using exti = field<exticr<Line>, 4 * (Line % 4), 4>;
+  }
+
+  namespace exti
+  {
+    using imr = reg32<REG_ADDRESS(EXTI, IMR)>;
+    using rtsr = reg32<REG_ADDRESS(EXTI, RTSR)>;
+    using ftsr = reg32<REG_ADDRESS(EXTI, FTSR)>;
+
+    template<unsigned Line>
+      using mr = field<imr, Line>;
+    template<unsigned Line>
+      using tr_rising = field<rtsr, Line>;
+    template<unsigned Line>
+      using tr_falling = field<ftsr, Line>;
+  }
+
+  template<unsigned Port>
+    struct gpio
+    {
+      static constexpr uint32_t base = GPIOA_BASE
+          + (GPIOB_BASE - GPIOA_BASE) * Port;
+
+      using moder = reg32<base + offsetof(GPIO_TypeDef, MODER)>;
+      using pupdr = reg32<base + offsetof(GPIO_TypeDef, PUPDR)>;
+      using idr = reg32<base + offsetof(GPIO_TypeDef, IDR), access::read_only>;
+      using odr = reg32<base + offsetof(GPIO_TypeDef, ODR)>;
+      using bsrr = reg32<base + offsetof(GPIO_TypeDef, BSRR), access::write_only>;
+
+      template<unsigned Pin>
+        using mode = field<moder, 2 * Pin, 2>;
+      template<unsigned Pin>
+        using pupd = field<pupdr, 2 * Pin, 2>;
+      template<unsigned Pin>
+        using id = field<idr, Pin>;
+      template<unsigned Pin>
+        using bs = field<bsrr, Pin>;
+      template<unsigned Pin>
+        using br = field<bsrr, Pin + 16>;
+    };
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // REGISTERS_H_
@@ -7,6 +7,7 @@
 #define TIMER_H_
 
 #include "cmsis_device.h"
+#include "clock_tree.h"
 
 // ----------------------------------------------------------------------------
 
@@ -17,7 +18,9 @@ public:
   static constexpr ticks_t FREQUENCY_HZ = 1000u;
 
 private:
-  static volatile ticks_t ms_delayCount;
+  // Ticks (milliseconds) since start(), wrapping; the only time base,
+  // with the HAL also behind HAL_GetTick().
+  static volatile ticks_t ms_ticks;
 
 public:
   // Default constructor
@@ -26,21 +29,26 @@ public:
   inline void
   start (void)
   {
+    static_assert(clock_tree::hclk_hz / FREQUENCY_HZ - 1 <= SysTick_LOAD_RELOAD_Msk,
+        "SysTick reload out of range");
+
     // Use SysTick as reference for the delay loops.
-    SysTick_Config (SystemCoreClock / FREQUENCY_HZ);
+    SysTick_Config (clock_tree::hclk_hz / FREQUENCY_HZ);
   }
 
   static void
   sleep (ticks_t ticks);
 
+  inline static ticks_t
+  now (void)
+  {
+    return ms_ticks;
+  }
+
   inline static void
   tick (void)
   {
-    // Decrement to zero the counter used by the delay routine.
-    if (ms_delayCount != 0u)
-      {
-	--ms_delayCount;
-      }
+    ++ms_ticks;
   }
 };
 
@@ -7,10 +7,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <type_traits>
 #include "diag/Trace.h"
+#include "cortexm/critical_section.h"
 
 #include "timer_systick.h"
 #include "blink_led.h"
+#include "gpio_config.h"
+#include "registers.h"
 
 // ----------------------------------------------------------------------------
 //
@@ -67,19 +71,44 @@ blink_led blink_leds[4] =
   /**/
   };
 
+// All leds are on the same port; configure them in one go, as
+// blink_led::power_up() would, each starting off.
+#define BLINK_LED_PIN_CONFIG(_N) \
+  { (_N), gpio::mode::output, gpio::type::push_pull, gpio::speed::fast, \
+      gpio::pull::up, 0, BLINK_ACTIVE_LOW }
+
+constexpr gpio::pin_config blink_pins[] =
+  {
+    BLINK_LED_PIN_CONFIG(BLINK_PIN_NUMBER_GREEN),
+    BLINK_LED_PIN_CONFIG(BLINK_PIN_NUMBER_ORANGE),
+    BLINK_LED_PIN_CONFIG(BLINK_PIN_NUMBER_RED),
+    BLINK_LED_PIN_CONFIG(BLINK_PIN_NUMBER_BLUE),
+  /**/
+  };
+
+constexpr gpio::port_image blink_image = gpio::make_image (blink_pins);
+
 // ----- Button definitions ---------------------------------------------------
 
 #define BUTTON_PORT_NUMBER 		(0)
 #define BUTTON_PIN_NUMBER 		(0)
 
-#define BUTTON_GPIOx(_N)           	((GPIO_TypeDef *)(GPIOA_BASE + (GPIOB_BASE-GPIOA_BASE)*(_N)))
 #define BUTTON_PIN_MASK(_N)             (1 << (_N))
-#define BUTTON_RCC_MASKx(_N)         	(RCC_AHB1ENR_GPIOAEN << (_N))
 
-void
-SYSCFG_EXTILineConfig (uint8_t EXTI_PortSourceGPIOx, uint8_t EXTI_PinSourcex);
+using button_gpio = reg::gpio<BUTTON_PORT_NUMBER>;
+using blink_gpio = reg::gpio<BLINK_PORT_NUMBER>;
+
+// The BSRR field that turns a led off.
+template<unsigned Pin>
+  using blink_off = typename std::conditional<BLINK_ACTIVE_LOW,
+      blink_gpio::bs<Pin>, blink_gpio::br<Pin>>::type;
 
-int button_pressed = 0;
+// The button interrupt priority; the critical sections in main()
+// mask it, and all lower priority interrupts.
+#define BUTTON_IRQ_PRIORITY             (8)
+
+// Set by the interrupt handler, polled by main().
+volatile int button_pressed = 0;
 
 // ----- main() ---------------------------------------------------------------
 
@@ -129,35 +158,34 @@ main (int argc, char* argv[])
 
   // --------------------------------------------------------------------------
 
-  RCC->AHB1ENR |= BUTTON_RCC_MASKx(BUTTON_PORT_NUMBER);
-
-  GPIO_InitTypeDef button_gpio_init;
+  // Enable the button and the LEDs ports, in one read-modify-write.
+  reg::rcc::ahb1enr::modify (reg::rcc::gpioen<BUTTON_PORT_NUMBER>::set (),
+                             reg::rcc::gpioen<BLINK_PORT_NUMBER>::set ());
 
-  // Configure pin in input mode
-  button_gpio_init.Pin = BUTTON_PIN_MASK(BUTTON_PIN_NUMBER);
-  button_gpio_init.Mode = GPIO_MODE_IT_RISING_FALLING;
-  button_gpio_init.Speed = GPIO_SPEED_LOW;
-  button_gpio_init.Pull = GPIO_NOPULL;
-  HAL_GPIO_Init (BUTTON_GPIOx(BUTTON_PORT_NUMBER), &button_gpio_init);
+  // Configure pin in input mode, no pull.
+  button_gpio::moder::modify (
+      button_gpio::mode<BUTTON_PIN_NUMBER>::value (0));
+  button_gpio::pupdr::modify (
+      button_gpio::pupd<BUTTON_PIN_NUMBER>::value (0));
 
-  RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
-  SYSCFG_EXTILineConfig ((uint8_t) BUTTON_PORT_NUMBER, 0);
+  reg::rcc::apb2enr::modify (reg::rcc::syscfgen::set ());
+  reg::syscfg::exticr<BUTTON_PIN_NUMBER>::modify (
+      reg::syscfg::exti<BUTTON_PIN_NUMBER>::value (BUTTON_PORT_NUMBER));
 
-  EXTI->IMR |= BUTTON_PIN_MASK(BUTTON_PIN_NUMBER);
-  EXTI->RTSR |= BUTTON_PIN_MASK(BUTTON_PIN_NUMBER);
-  EXTI->FTSR |= BUTTON_PIN_MASK(BUTTON_PIN_NUMBER);
+  reg::exti::imr::modify (reg::exti::mr<BUTTON_PIN_NUMBER>::set ());
+  reg::exti::rtsr::modify (reg::exti::tr_rising<BUTTON_PIN_NUMBER>::set ());
+  reg::exti::ftsr::modify (reg::exti::tr_falling<BUTTON_PIN_NUMBER>::set ());
 
+  NVIC_SetPriority (EXTI0_IRQn, BUTTON_IRQ_PRIORITY);
   NVIC_EnableIRQ (EXTI0_IRQn);
 
   // --------------------------------------------------------------------------
 
   uint32_t seconds = 0;
 
-  // Perform all necessary initialisations for the LEDs.
-  for (size_t i = 0; i < (sizeof(blink_leds) / sizeof(blink_leds[0])); ++i)
-    {
-      blink_leds[i].power_up ();
-    }
+  // Perform all necessary initialisations for the LEDs; one write
+  // per GPIO register, instead of blink_led::power_up() for each.
+  gpio::configure (BLINK_GPIOx(BLINK_PORT_NUMBER), blink_image);
 
   for (size_t i = 0; i < (sizeof(blink_leds) / sizeof(blink_leds[0])); ++i)
     {
@@ -200,14 +228,21 @@ main (int argc, char* argv[])
   // Blink binary.
   for (int i = 0; (i < loops) && (!button_pressed); i++)
     {
-      for (size_t l = 0; l < (sizeof(blink_leds) / sizeof(blink_leds[0])); ++l)
-	{
-	  blink_leds[l].toggle ();
-	  if (blink_leds[l].is_on ())
-	    {
-	      break;
-	    }
-	}
+      {
+	// The handler also drives the LEDs; prevent it from interfering
+	// with the read-modify-write done by toggle().
+	critical_section cs (BUTTON_IRQ_PRIORITY);
+
+	for (size_t l = 0; l < (sizeof(blink_leds) / sizeof(blink_leds[0]));
+	    ++l)
+	  {
+	    blink_leds[l].toggle ();
+	    if (blink_leds[l].is_on ())
+	      {
+		break;
+	      }
+	  }
+      }
 
       if (button_pressed)
 	break;
@@ -240,24 +275,14 @@ main (int argc, char* argv[])
 
 // ----------------------------------------------------------------------------
 
-void
-SYSCFG_EXTILineConfig (uint8_t EXTI_PortSourceGPIOx, uint8_t EXTI_PinSourcex)
-{
-  uint32_t tmp = 0x00;
-
-  tmp = ((uint32_t) 0x0F) << (0x04 * (EXTI_PinSourcex & (uint8_t) 0x03));
-  SYSCFG->EXTICR[EXTI_PinSourcex >> 0x02] &= ~tmp;
-  SYSCFG->EXTICR[EXTI_PinSourcex >> 0x02] |= (((uint32_t) EXTI_PortSourceGPIOx)
-      << (0x04 * (EXTI_PinSourcex & (uint8_t) 0x03)));
-}
-
 int led_no = 0;
 int old_val = 0;
 
 void
 HAL_GPIO_EXTI_Callback (uint16_t mask)
 {
-  int val = ((BUTTON_GPIOx(BUTTON_PORT_NUMBER)->IDR & mask) != 0);
+  (void) mask;
+  int val = (button_gpio::id<BUTTON_PIN_NUMBER>::read () != 0);
 
   if (val != old_val)
     {
@@ -265,11 +290,11 @@ HAL_GPIO_EXTI_Callback (uint16_t mask)
 	{
 	  button_pressed = 1;
 
-	  for (size_t i = 0; i < (sizeof(blink_leds) / sizeof(blink_leds[0]));
-	      ++i)
-	    {
-	      blink_leds[i].turn_off ();
-	    }
+	  // All leds off, with a single write.
+	  blink_gpio::bsrr::write (blink_off<BLINK_PIN_NUMBER_GREEN>::set (),
+				   blink_off<BLINK_PIN_NUMBER_ORANGE>::set (),
+				   blink_off<BLINK_PIN_NUMBER_RED>::set (),
+				   blink_off<BLINK_PIN_NUMBER_BLUE>::set ());
 	}
 
       if (val)
@@ -0,0 +1,187 @@
+//
+// This file is part of the µOS++ III distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CORTEXM_CRITICAL_SECTION_H_
+#define CORTEXM_CRITICAL_SECTION_H_
+
+#include <stdint.h>
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Critical sections used to protect data shared between the application
+// and the interrupt handlers.
+//
+// On ARMv7-M, only the interrupts with a priority numerically greater
+// than or equal to OS_INTEGER_CRITICAL_SECTION_INTERRUPT_PRIORITY are
+// masked (via BASEPRI), so more urgent interrupts (like a fast timer
+// or the trace drain) continue to run. Obviously these interrupts
+// must not touch the protected data.
+//
+// The value is in NVIC priority levels (0 to (1<<__NVIC_PRIO_BITS)-1).
+// The default 0 means all interrupts are masked, via PRIMASK. Please
+// note that interrupts left at the reset priority (0) cannot be masked
+// by BASEPRI.
+//
+// On ARMv6-M there is no BASEPRI, and critical sections always
+// use PRIMASK.
+//
+// Critical sections can be nested; each one saves the previous state
+// and restores it when leaving, so an inner critical section never
+// lowers the masking level set by an outer one.
+//
+// If all code that shares data runs at the same priority (for
+// example an application without interrupts, or doing all work in
+// handlers of equal priority), define
+// OS_USE_CRITICAL_SECTION_SINGLE_PRIORITY and everything
+// is compiled to nothing.
+
+#if !defined(OS_INTEGER_CRITICAL_SECTION_INTERRUPT_PRIORITY)
+#define OS_INTEGER_CRITICAL_SECTION_INTERRUPT_PRIORITY (0)
+#endif
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+  typedef uint32_t critical_section_state_t;
+
+  static inline critical_section_state_t
+  critical_section_enter_priority (uint32_t priority);
+
+  static inline critical_section_state_t
+  critical_section_enter (void);
+
+  static inline void
+  critical_section_exit (critical_section_state_t state);
+
+  // --------------------------------------------------------------------------
+
+  /**
+   * Enter a critical section, masking all interrupts with priority
+   * numerically greater than or equal to the given one.
+   * @param priority NVIC priority level; 0 masks all interrupts.
+   * @return the previous state, to be passed to critical_section_exit().
+   */
+  static inline critical_section_state_t
+  __attribute__((always_inline))
+  critical_section_enter_priority (uint32_t priority __attribute__((unused)))
+  {
+#if defined(OS_USE_CRITICAL_SECTION_SINGLE_PRIORITY)
+    return 0;
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    if (priority == 0)
+      {
+        // BASEPRI=0 means no masking; use PRIMASK.
+        critical_section_state_t state = __get_PRIMASK ();
+        __disable_irq ();
+        // Mark it as a PRIMASK state.
+        return state | 0x80000000;
+      }
+
+    critical_section_state_t state = __get_BASEPRI ();
+    // Only raises the masking level, never lowers it. Not all CMSIS
+    // versions have __set_BASEPRI_MAX(), and some lack the memory
+    // clobber, which is mandatory for a critical section.
+    asm volatile ("msr basepri_max, %0"
+        :
+        : "r" (priority << (8 - __NVIC_PRIO_BITS))
+        : "memory");
+    return state;
+#else
+    critical_section_state_t state = __get_PRIMASK ();
+    __disable_irq ();
+    return state;
+#endif
+  }
+
+  /**
+   * Enter a critical section, with the configured priority.
+   * @return the previous state, to be passed to critical_section_exit().
+   */
+  static inline critical_section_state_t
+  __attribute__((always_inline))
+  critical_section_enter (void)
+  {
+    return critical_section_enter_priority (
+        OS_INTEGER_CRITICAL_SECTION_INTERRUPT_PRIORITY);
+  }
+
+  /**
+   * Leave a critical section, restoring the state before it was entered.
+   * @param state the value returned by critical_section_enter*().
+   */
+  static inline void
+  __attribute__((always_inline))
+  critical_section_exit (critical_section_state_t state __attribute__((unused)))
+  {
+#if defined(OS_USE_CRITICAL_SECTION_SINGLE_PRIORITY)
+    ;
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    if ((state & 0x80000000) != 0)
+      {
+        __set_PRIMASK (state & ~0x80000000);
+      }
+    else
+      {
+        asm volatile ("msr basepri, %0"
+            :
+            : "r" (state)
+            : "memory");
+      }
+#else
+    __set_PRIMASK (state);
+#endif
+  }
+
+#if defined(__cplusplus)
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#if defined(__cplusplus)
+
+// RAII wrapper; the critical section lasts for the life of the object.
+//
+//   {
+//     critical_section cs;
+//     ... access the shared data ...
+//   }
+
+class critical_section
+{
+public:
+  critical_section () :
+      state_ (critical_section_enter ())
+  {
+  }
+
+  explicit
+  critical_section (uint32_t priority) :
+      state_ (critical_section_enter_priority (priority))
+  {
+  }
+
+  ~critical_section ()
+  {
+    critical_section_exit (state_);
+  }
+
+  critical_section (const critical_section&) = delete;
+
+  critical_section&
+  operator= (const critical_section&) = delete;
+
+private:
+  critical_section_state_t state_;
+};
+
+#endif // defined(__cplusplus)
+
+// ----------------------------------------------------------------------------
+
+#endif // CORTEXM_CRITICAL_SECTION_H_
@@ -0,0 +1,441 @@
+/*
+ * This file is part of the GNU ARM Eclipse distribution.
+ * Copyright (c) 2014 Liviu Ionescu.
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * An implementation of pvPortMalloc() and vPortFree() based on TLSF (Two
+ * Level Segregated Fit, M. Masmano et al.), that allocates and frees in
+ * constant time, independent of the number or the size of the free blocks.
+ *
+ * Free blocks are kept in segregated lists: the first level splits the sizes
+ * in powers of two, the second level splits each power of two in
+ * heapSL_INDEX_COUNT linear ranges.  Two levels of bitmaps tell which lists
+ * are not empty, so a suitable block is found with a couple of CLZ
+ * instructions; a block is taken from a list that guarantees it is large
+ * enough (good fit), split, and the remainder put back.  Freed blocks are
+ * merged immediately with their physical neighbours, using a header with a
+ * pointer to the previous block.
+ *
+ * Like heap_5.c, the memory can span several non contiguous regions (on the
+ * STM32F4, the SRAM and the CCM RAM), which must be defined by calling
+ * vPortDefineHeapRegions() before the first allocation; unlike heap_5.c the
+ * regions need not be in address order.
+ *
+ * See heap_1.c, heap_2.c, heap_3.c, heap_4.c and heap_5.c for alternative
+ * implementations, and the memory management pages of
+ * http://www.FreeRTOS.org for more information.
+ */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* log2 of the number of second level lists per power of two. */
+#define heapSL_INDEX_COUNT_LOG2		( 4 )
+
+/* log2 of the block size limit; 18 allows blocks up to 256 KB, more than
+the whole F4 SRAM. */
+#ifndef configHEAP6_FL_INDEX_MAX
+	#define configHEAP6_FL_INDEX_MAX	( 18 )
+#endif
+
+#define heapALIGN_SIZE_LOG2			( 3 )
+#define heapALIGN_SIZE				( 1UL << heapALIGN_SIZE_LOG2 )
+
+#define heapSL_INDEX_COUNT			( 1UL << heapSL_INDEX_COUNT_LOG2 )
+#define heapFL_INDEX_SHIFT			( heapSL_INDEX_COUNT_LOG2 + heapALIGN_SIZE_LOG2 )
+#define heapFL_INDEX_COUNT			( configHEAP6_FL_INDEX_MAX - heapFL_INDEX_SHIFT + 1 )
+#define heapSMALL_BLOCK_SIZE		( 1UL << heapFL_INDEX_SHIFT )
+
+/* The low bits of the size, always multiple of heapALIGN_SIZE, are flags. */
+#define heapBLOCK_FREE_BIT			( ( size_t ) 1 )
+#define heapBLOCK_PREV_FREE_BIT		( ( size_t ) 2 )
+#define heapBLOCK_FLAGS_MASK		( heapBLOCK_FREE_BIT | heapBLOCK_PREV_FREE_BIT )
+
+#if( portBYTE_ALIGNMENT != 8 )
+	#error heap_6.c assumes portBYTE_ALIGNMENT is 8
+#endif
+
+#if( heapFL_INDEX_COUNT > 32 )
+	#error configHEAP6_FL_INDEX_MAX too large for the 32-bit first level bitmap
+#endif
+
+/* Each block starts with this header; the user area follows the first two
+members, the other two are used only while the block is free. */
+typedef struct A_BLOCK_HEADER
+{
+	struct A_BLOCK_HEADER *pxPrevPhysBlock;	/*<< The block just before this one in memory, valid only if it is free. */
+	size_t xSize;							/*<< The size of the user area, plus the flags. */
+	struct A_BLOCK_HEADER *pxNextFree;		/*<< The next block in the same free list. */
+	struct A_BLOCK_HEADER *pxPrevFree;		/*<< The previous block in the same free list. */
+} BlockHeader_t;
+
+/* The part of the header kept in allocated blocks. */
+#define heapBLOCK_OVERHEAD			( 2 * sizeof( void * ) )
+
+/* The smallest user area; it must hold the free list pointers. */
+#define heapBLOCK_SIZE_MIN			( sizeof( BlockHeader_t ) - heapBLOCK_OVERHEAD )
+#define heapBLOCK_SIZE_MAX			( ( ( size_t ) 1 ) << configHEAP6_FL_INDEX_MAX )
+
+/*-----------------------------------------------------------*/
+
+/* The bitmaps of the non empty lists, and the heads of the lists. */
+static uint32_t ulFLBitmap = 0;
+static uint32_t ulSLBitmap[ heapFL_INDEX_COUNT ];
+static BlockHeader_t *pxBlocks[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+
+/* Keeps track of the number of free bytes remaining, but says nothing about
+fragmentation. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+
+/* Set by vPortDefineHeapRegions(). */
+static BaseType_t xHeapInitialised = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+static inline size_t prvBlockSize( const BlockHeader_t *pxBlock )
+{
+	return pxBlock->xSize & ~heapBLOCK_FLAGS_MASK;
+}
+
+static inline BlockHeader_t *prvNextPhysBlock( const BlockHeader_t *pxBlock )
+{
+	return ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + heapBLOCK_OVERHEAD + prvBlockSize( pxBlock ) );
+}
+
+/* Index of the most significant bit set; x must not be 0. */
+static inline uint32_t prvFLS( size_t x )
+{
+	return 31UL - ( uint32_t ) __builtin_clz( ( unsigned int ) x );
+}
+
+/* Index of the least significant bit set; x must not be 0. */
+static inline uint32_t prvFFS( uint32_t x )
+{
+	return ( uint32_t ) __builtin_ctz( x );
+}
+
+/* The list a block of this size belongs to. */
+static inline void prvMappingInsert( size_t xSize, uint32_t *pulFL, uint32_t *pulSL )
+{
+uint32_t ulFL, ulSL;
+
+	if( xSize < heapSMALL_BLOCK_SIZE )
+	{
+		/* Small blocks, linearly in the first list. */
+		ulFL = 0;
+		ulSL = ( uint32_t ) ( xSize / ( heapSMALL_BLOCK_SIZE / heapSL_INDEX_COUNT ) );
+	}
+	else
+	{
+		ulFL = prvFLS( xSize );
+		ulSL = ( uint32_t ) ( xSize >> ( ulFL - heapSL_INDEX_COUNT_LOG2 ) ) ^ heapSL_INDEX_COUNT;
+		ulFL -= ( heapFL_INDEX_SHIFT - 1 );
+	}
+
+	*pulFL = ulFL;
+	*pulSL = ulSL;
+}
+
+/* The first list where all blocks are at least this size. */
+static inline void prvMappingSearch( size_t xSize, uint32_t *pulFL, uint32_t *pulSL )
+{
+	if( xSize >= heapSMALL_BLOCK_SIZE )
+	{
+		xSize += ( ( ( size_t ) 1 ) << ( prvFLS( xSize ) - heapSL_INDEX_COUNT_LOG2 ) ) - 1;
+	}
+	prvMappingInsert( xSize, pulFL, pulSL );
+}
+
+static BlockHeader_t *prvSearchSuitableBlock( uint32_t *pulFL, uint32_t *pulSL )
+{
+uint32_t ulFL = *pulFL;
+uint32_t ulSLMap = ulSLBitmap[ ulFL ] & ( ~0UL << *pulSL );
+
+	if( ulSLMap == 0 )
+	{
+		/* Nothing in this first level, try the larger ones. */
+		uint32_t ulFLMap = ( ulFL + 1 < 32 ) ? ( ulFLBitmap & ( ~0UL << ( ulFL + 1 ) ) ) : 0;
+		if( ulFLMap == 0 )
+		{
+			return NULL;
+		}
+
+		ulFL = prvFFS( ulFLMap );
+		*pulFL = ulFL;
+		ulSLMap = ulSLBitmap[ ulFL ];
+	}
+
+	*pulSL = prvFFS( ulSLMap );
+	return pxBlocks[ ulFL ][ *pulSL ];
+}
+
+static void prvRemoveFreeBlock( BlockHeader_t *pxBlock, uint32_t ulFL, uint32_t ulSL )
+{
+BlockHeader_t *pxPrev = pxBlock->pxPrevFree;
+BlockHeader_t *pxNext = pxBlock->pxNextFree;
+
+	if( pxNext != NULL )
+	{
+		pxNext->pxPrevFree = pxPrev;
+	}
+	if( pxPrev != NULL )
+	{
+		pxPrev->pxNextFree = pxNext;
+	}
+
+	if( pxBlocks[ ulFL ][ ulSL ] == pxBlock )
+	{
+		pxBlocks[ ulFL ][ ulSL ] = pxNext;
+
+		if( pxNext == NULL )
+		{
+			ulSLBitmap[ ulFL ] &= ~( 1UL << ulSL );
+			if( ulSLBitmap[ ulFL ] == 0 )
+			{
+				ulFLBitmap &= ~( 1UL << ulFL );
+			}
+		}
+	}
+
+	xFreeBytesRemaining -= prvBlockSize( pxBlock );
+}
+
+static void prvInsertFreeBlock( BlockHeader_t *pxBlock )
+{
+uint32_t ulFL, ulSL;
+BlockHeader_t *pxHead;
+
+	prvMappingInsert( prvBlockSize( pxBlock ), &ulFL, &ulSL );
+
+	pxHead = pxBlocks[ ulFL ][ ulSL ];
+	pxBlock->pxNextFree = pxHead;
+	pxBlock->pxPrevFree = NULL;
+	if( pxHead != NULL )
+	{
+		pxHead->pxPrevFree = pxBlock;
+	}
+	pxBlocks[ ulFL ][ ulSL ] = pxBlock;
+
+	ulFLBitmap |= ( 1UL << ulFL );
+	ulSLBitmap[ ulFL ] |= ( 1UL << ulSL );
+
+	xFreeBytesRemaining += prvBlockSize( pxBlock );
+}
+
+static inline void prvRemoveBlock( BlockHeader_t *pxBlock )
+{
+uint32_t ulFL, ulSL;
+
+	prvMappingInsert( prvBlockSize( pxBlock ), &ulFL, &ulSL );
+	prvRemoveFreeBlock( pxBlock, ulFL, ulSL );
+}
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+BlockHeader_t *pxBlock;
+void *pvReturn = NULL;
+size_t xSize;
+uint32_t ulFL, ulSL;
+
+	/* The heap must be initialised before the first call to pvPortMalloc(). */
+	configASSERT( xHeapInitialised );
+
+	if( ( xWantedSize > 0 ) && ( xWantedSize < heapBLOCK_SIZE_MAX ) )
+	{
+		xSize = ( xWantedSize + ( heapALIGN_SIZE - 1 ) ) & ~( ( size_t ) heapALIGN_SIZE - 1 );
+		if( xSize < heapBLOCK_SIZE_MIN )
+		{
+			xSize = heapBLOCK_SIZE_MIN;
+		}
+
+		vTaskSuspendAll();
+		{
+			prvMappingSearch( xSize, &ulFL, &ulSL );
+			if( ulFL < heapFL_INDEX_COUNT )
+			{
+				pxBlock = prvSearchSuitableBlock( &ulFL, &ulSL );
+				if( pxBlock != NULL )
+				{
+					BlockHeader_t *pxNext;
+
+					configASSERT( prvBlockSize( pxBlock ) >= xSize );
+					prvRemoveFreeBlock( pxBlock, ulFL, ulSL );
+
+					pxNext = prvNextPhysBlock( pxBlock );
+					if( prvBlockSize( pxBlock ) >= xSize + sizeof( BlockHeader_t ) )
+					{
+						/* Split, and return the remainder to the free
+						lists; the next block keeps its prev free flag. */
+						BlockHeader_t *pxRemaining = ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + heapBLOCK_OVERHEAD + xSize );
+						pxRemaining->xSize = ( prvBlockSize( pxBlock ) - xSize - heapBLOCK_OVERHEAD ) | heapBLOCK_FREE_BIT;
+						pxRemaining->pxPrevPhysBlock = pxBlock;
+						pxNext->pxPrevPhysBlock = pxRemaining;
+						prvInsertFreeBlock( pxRemaining );
+
+						pxBlock->xSize = xSize | ( pxBlock->xSize & heapBLOCK_PREV_FREE_BIT );
+					}
+					else
+					{
+						pxBlock->xSize &= ~heapBLOCK_FREE_BIT;
+						pxNext->xSize &= ~heapBLOCK_PREV_FREE_BIT;
+					}
+
+					pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + heapBLOCK_OVERHEAD );
+
+					if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+					{
+						xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+					}
+				}
+			}
+
+			traceMALLOC( pvReturn, xWantedSize );
+		}
+		( void ) xTaskResumeAll();
+	}
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+BlockHeader_t *pxBlock, *pxNext;
+
+	if( pv == NULL )
+	{
+		return;
+	}
+
+	pxBlock = ( BlockHeader_t * ) ( ( ( uint8_t * ) pv ) - heapBLOCK_OVERHEAD );
+
+	/* Check the block is actually allocated. */
+	configASSERT( ( pxBlock->xSize & heapBLOCK_FREE_BIT ) == 0 );
+
+	vTaskSuspendAll();
+	{
+		traceFREE( pv, prvBlockSize( pxBlock ) );
+
+		/* Merge with the previous block, if free. */
+		if( ( pxBlock->xSize & heapBLOCK_PREV_FREE_BIT ) != 0 )
+		{
+			BlockHeader_t *pxPrev = pxBlock->pxPrevPhysBlock;
+
+			prvRemoveBlock( pxPrev );
+			pxPrev->xSize += prvBlockSize( pxBlock ) + heapBLOCK_OVERHEAD;
+			pxBlock = pxPrev;
+		}
+		else
+		{
+			pxBlock->xSize |= heapBLOCK_FREE_BIT;
+		}
+
+		/* Merge with the next block, if free; the region end markers are
+		never free, so this does not cross regions. */
+		pxNext = prvNextPhysBlock( pxBlock );
+		if( ( pxNext->xSize & heapBLOCK_FREE_BIT ) != 0 )
+		{
+			prvRemoveBlock( pxNext );
+			pxBlock->xSize += prvBlockSize( pxNext ) + heapBLOCK_OVERHEAD;
+			pxNext = prvNextPhysBlock( pxBlock );
+		}
+
+		pxNext->pxPrevPhysBlock = pxBlock;
+		pxNext->xSize |= heapBLOCK_PREV_FREE_BIT;
+
+		prvInsertFreeBlock( pxBlock );
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions )
+{
+const HeapRegion_t *pxHeapRegion;
+uint8_t *pucStart, *pucEnd;
+BlockHeader_t *pxBlock, *pxEnd;
+size_t xSize;
+
+	/* Can only call once! */
+	configASSERT( xHeapInitialised == pdFALSE );
+
+	for( pxHeapRegion = pxHeapRegions; pxHeapRegion->xSizeInBytes > 0; pxHeapRegion++ )
+	{
+		/* Ensure the heap region starts and ends on correctly aligned
+		boundaries. */
+		pucStart = ( uint8_t * ) ( ( ( size_t ) pxHeapRegion->pucStartAddress + ( heapALIGN_SIZE - 1 ) ) & ~( ( size_t ) heapALIGN_SIZE - 1 ) );
+		pucEnd = ( uint8_t * ) ( ( ( size_t ) pxHeapRegion->pucStartAddress + pxHeapRegion->xSizeInBytes ) & ~( ( size_t ) heapALIGN_SIZE - 1 ) );
+
+		if( pucEnd <= pucStart + sizeof( BlockHeader_t ) + heapBLOCK_OVERHEAD )
+		{
+			continue;
+		}
+
+		/* One free block covering the region, followed by an end marker,
+		which looks like an allocated block of size 0. */
+		xSize = ( size_t ) ( pucEnd - pucStart ) - 2 * heapBLOCK_OVERHEAD;
+		if( xSize >= heapBLOCK_SIZE_MAX )
+		{
+			/* Larger than the lists can hold; ignore the excess. */
+			xSize = heapBLOCK_SIZE_MAX - heapALIGN_SIZE;
+		}
+
+		pxBlock = ( BlockHeader_t * ) pucStart;
+		pxBlock->pxPrevPhysBlock = NULL;
+		pxBlock->xSize = xSize | heapBLOCK_FREE_BIT;
+
+		pxEnd = prvNextPhysBlock( pxBlock );
+		pxEnd->pxPrevPhysBlock = pxBlock;
+		pxEnd->xSize = heapBLOCK_PREV_FREE_BIT;
+
+		prvInsertFreeBlock( pxBlock );
+	}
+
+	xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+	xHeapInitialised = pdTRUE;
+
+	/* Check something was actually defined before it is accessed. */
+	configASSERT( xFreeBytesRemaining );
+}
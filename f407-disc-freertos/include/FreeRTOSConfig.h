@@ -86,8 +86,8 @@ your application. */
 #define configUSE_16_BIT_TICKS                  0
 #define configIDLE_SHOULD_YIELD                 1
 #define configUSE_TASK_NOTIFICATIONS            1
-#define configUSE_MUTEXES                       0
-#define configUSE_RECURSIVE_MUTEXES             0
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             1
 #define configUSE_COUNTING_SEMAPHORES           0
 #define configUSE_ALTERNATIVE_API               0 /* Deprecated! */
 #define configQUEUE_REGISTRY_SIZE               10
@@ -97,15 +97,34 @@ your application. */
 #define configENABLE_BACKWARD_COMPATIBILITY     0
 #define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5
 
+/* Memory allocation related definitions. */
+/* With static allocation there is no FreeRTOS heap; see freertos_static.h. */
+#if !defined(configSUPPORT_STATIC_ALLOCATION)
+#define configSUPPORT_STATIC_ALLOCATION         0
+#endif
+
+/* The heap_N.c used with dynamic allocation (1 to 6, see
+src/freertos_heap.c); 5 and 6 also use configHEAP_CCM_SIZE bytes
+of CCM RAM. */
+#if !defined(configHEAP_IMPLEMENTATION)
+#define configHEAP_IMPLEMENTATION               2
+#endif
+#define configHEAP_CCM_SIZE                     ( 32 * 1024 )
+
 /* Hook function related definitions. */
+#if defined(OS_USE_FREERTOS_TRACE) || defined(OS_USE_TRACE_TASK_BUFFERS)
+/* The trace records and buffers are written out from the idle hook. */
+#define configUSE_IDLE_HOOK                     1
+#else
 #define configUSE_IDLE_HOOK                     0
+#endif
 #define configUSE_TICK_HOOK                     0
 #define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_MALLOC_FAILED_HOOK            0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
-#define configUSE_TRACE_FACILITY                0
+#define configGENERATE_RUN_TIME_STATS           1
+#define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
 /* Co-routine related definitions. */
@@ -129,6 +148,11 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 
 //#define configMAX_API_CALL_INTERRUPT_PRIORITY   [dependent on processor and application]
 
+/* ARM_CM4F port only: defer saving the FPU registers on exception entry
+until the handler uses the FPU (FPCCR.LSPEN). Tasks that never used the
+FPU do not save them at all. */
+#define configUSE_FPU_LAZY_STACKING           1
+
 #if defined(USE_FULL_ASSERT)
 /* Define to trap errors during development. */
 #define configASSERT( x )     if( ( x ) == 0 ) vAssertCalled( __FILE__, __LINE__ )
@@ -151,13 +175,17 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
 #define INCLUDE_uxTaskGetStackHighWaterMark     0
 #define INCLUDE_xTaskGetIdleTaskHandle          0
-#define INCLUDE_xTimerGetTimerDaemonTaskHandle  0
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle  1
 #define INCLUDE_pcTaskGetTaskName               0
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xEventGroupSetBitFromISR        1
 #define INCLUDE_xTimerPendFunctionCall          1
 
 /* A header file that defines trace macro can be included here. */
+#include "freertos_trace.h"
+#include "freertos_stack.h"
+#include "freertos_tickless.h"
+#include "trace_rtos.h"
 
 #if defined(USE_FULL_ASSERT)
 void
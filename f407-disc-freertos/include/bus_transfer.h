@@ -0,0 +1,176 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef BUS_TRANSFER_H_
+#define BUS_TRANSFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// ----------------------------------------------------------------------------
+
+// Asynchronous SPI1 and I2C1 transfers, by DMA, with a queue of
+// transfer descriptors per bus.
+//
+// A transfer is a write of tx_length bytes followed, in the same
+// transaction, by a read of rx_length bytes: on SPI with the chip
+// select held low (the bytes received during the write, and sent
+// during the read, are dummies), on I2C with a repeated start. Either
+// length may be 0. The interrupt handlers switch from the write to the
+// read, and start the next queued transfer, so a chain of transfers
+// runs with no task involvement.
+//
+// Each request uses a caller owned bus_transfer_t, which must stay
+// valid, with its buffers, until the transfer is done. When it ends,
+// its state is updated, then the callback, if any, is invoked from the
+// interrupt handler; without a callback the submitting task is
+// notified (xTaskNotifyGive()), and bus_transfer_wait() blocks on it.
+// Transfers submitted from interrupt handlers, including the callbacks,
+// must have a callback.
+//
+// A transfer which timed out in bus_transfer_wait() is still queued,
+// and may still be running; cancel it (spi_bus_cancel(),
+// i2c_bus_cancel()) before reusing the descriptor or the buffers.
+// Cancelling the running transfer stops its DMA streams and releases
+// the chip select, or sends a STOP; the next queued transfer is then
+// started.
+//
+// An I2C bus still busy a few bit times after a STOP stops the queue;
+// the next i2c_bus_submit() or i2c_bus_cancel() call of a task waits
+// longer for it, resets the peripheral if needed, and restarts the
+// queue, never in an interrupt handler or with interrupts disabled.
+//
+// The buffers must not be in the CCM RAM, not reachable by DMA.
+//
+// STM32F4DISCOVERY pins: SPI1 on PA5/PA6/PA7 (the accelerometer, chip
+// select PE3), I2C1 on PB6/PB9 (the audio DAC).
+//
+// DMA streams: SPI1 RX/TX on DMA2 stream 2/3, I2C1 RX/TX on DMA1 stream
+// 0/7 (DMA2 stream 1 is used by crc32, DMA1 stream 6 by the USART
+// trace).
+
+#if !defined(OS_INTEGER_SPI_BUS_BAUD_DIV)
+// PCLK2 / 16 = 5.25 MHz.
+#define OS_INTEGER_SPI_BUS_BAUD_DIV             (16)
+#endif
+
+#if !defined(OS_INTEGER_SPI_BUS_MODE)
+// CPOL = 1, CPHA = 1.
+#define OS_INTEGER_SPI_BUS_MODE                 (3)
+#endif
+
+#if !defined(OS_INTEGER_I2C_BUS_SPEED_HZ)
+#define OS_INTEGER_I2C_BUS_SPEED_HZ             (100000)
+#endif
+
+#define BUS_TRANSFER_DONE                       (0)
+#define BUS_TRANSFER_ERROR                      (1)
+#define BUS_TRANSFER_PENDING                    (2)
+#define BUS_TRANSFER_CANCELLED                  (3)
+
+// The SPI device is identified by its chip select pin.
+#define BUS_SPI_CS(_PORT, _PIN)                 ((uint16_t) (((_PORT) << 4) | (_PIN)))
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  typedef struct bus_transfer_s bus_transfer_t;
+
+  typedef void
+  (*bus_callback_t) (bus_transfer_t* transfer, void* arg);
+
+  // The members are private.
+  struct bus_transfer_s
+  {
+    bus_transfer_t* next;
+    const uint8_t* tx;
+    uint8_t* rx;
+    uint16_t tx_length;
+    uint16_t rx_length;
+    // The SPI chip select, or the I2C 7-bit address.
+    uint16_t device;
+    volatile uint8_t state;
+    // Reading, after the write.
+    uint8_t reading;
+    bus_callback_t callback;
+    void* arg;
+    TaskHandle_t task;
+  };
+
+  // Configure the pins, the peripheral, the DMA streams and the
+  // interrupts.
+  void
+  spi_bus_init (void);
+
+  void
+  i2c_bus_init (void);
+
+  // Configure a chip select pin, BUS_SPI_CS(port, pin), as an output,
+  // high.
+  void
+  spi_bus_add_device (uint16_t device);
+
+  // Queue a transfer; device is BUS_SPI_CS(port, pin). With a NULL
+  // callback the calling task is notified.
+  void
+  spi_bus_submit (bus_transfer_t* transfer, uint16_t device, const void* tx,
+                  size_t tx_length, void* rx, size_t rx_length,
+                  bus_callback_t callback, void* arg);
+
+  // Queue a transfer; device is the 7-bit address.
+  void
+  i2c_bus_submit (bus_transfer_t* transfer, uint16_t device, const void* tx,
+                  size_t tx_length, void* rx, size_t rx_length,
+                  bus_callback_t callback, void* arg);
+
+  // Remove a pending transfer from the queue, with no notification;
+  // return false if it already ended.
+  bool
+  spi_bus_cancel (bus_transfer_t* transfer);
+
+  bool
+  i2c_bus_cancel (bus_transfer_t* transfer);
+
+  static inline bool
+  __attribute__((always_inline))
+  bus_transfer_done (const bus_transfer_t* transfer)
+  {
+    return transfer->state != BUS_TRANSFER_PENDING;
+  }
+
+  // Block until a transfer submitted without a callback ends, or the
+  // timeout expires; return its state.
+  int
+  bus_transfer_wait (const bus_transfer_t* transfer, TickType_t timeout);
+
+  // For the drivers.
+
+  void
+  bus_transfer_prepare (bus_transfer_t* transfer, uint16_t device,
+                        const void* tx, size_t tx_length, void* rx,
+                        size_t rx_length, bus_callback_t callback, void* arg);
+
+  void
+  bus_transfer_finish (bus_transfer_t* transfer, uint8_t state,
+                       BaseType_t* woken);
+
+  // Remove a transfer, not the head, from a queue; interrupts masked.
+  void
+  bus_transfer_unlink (bus_transfer_t* head, bus_transfer_t** tail,
+                       bus_transfer_t* transfer);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // BUS_TRANSFER_H_
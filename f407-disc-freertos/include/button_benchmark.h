@@ -0,0 +1,54 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef BUTTON_BENCHMARK_H_
+#define BUTTON_BENCHMARK_H_
+
+#include "FreeRTOS.h"
+
+// ----------------------------------------------------------------------------
+
+// Compare the ways of handling a button, on a simulated one: a
+// stimulus task toggles a variable at pseudo-random intervals and, as
+// a pin edge would, pends the EXTI1 interrupt by software. The
+// handling variants are:
+// - poll: a task reads the state every OS_INTEGER_BENCHMARK_BUTTON_POLL_TICKS,
+//   like the f407-disc-bpoll loop;
+// - irq: the EXTI handler updates the LED itself, debouncing by time,
+//   like f407-disc-birq;
+// - event group: the EXTI handler sets an event group bit and starts
+//   a debounce timer, as in button_task.cpp;
+// - notification: the same, with a direct to task notification.
+//
+// For each, the press to LED latency (min/avg/max, in microseconds),
+// the missed edges, and the CPU time used by the handler task, the
+// timer service task and the interrupt, as a percentage of the run,
+// are printed on the trace device.
+
+#if !defined(OS_INTEGER_BENCHMARK_BUTTON_EDGES)
+#define OS_INTEGER_BENCHMARK_BUTTON_EDGES       (40)
+#endif
+
+#if !defined(OS_INTEGER_BENCHMARK_BUTTON_POLL_TICKS)
+#define OS_INTEGER_BENCHMARK_BUTTON_POLL_TICKS  (30)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Create the stimulus task, at the given priority, which should be
+  // above all others; the handler tasks run one below.
+  void
+  button_benchmark_start (UBaseType_t priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // BUTTON_BENCHMARK_H_
@@ -0,0 +1,47 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef BUTTON_TASK_H_
+#define BUTTON_TASK_H_
+
+#include "FreeRTOS.h"
+
+// ----------------------------------------------------------------------------
+
+// The user button (A0, active high on both the STM32F4DISCOVERY and
+// the STM32-E407), handled by a task; written in C++ over the rtos.h
+// layer.
+//
+// The EXTI interrupt sets the pressed or released bit in an event
+// group, for the first edge, then masks itself and starts a one-shot
+// software timer; the contact bounces are over when the timer fires,
+// and it unmasks the interrupt, reporting a state change it missed.
+// So the task reacts to the first edge, with no polling, and sees one
+// event per press. It counts the presses and, on the STM32F4DISCOVERY,
+// lights the orange led (D13) for a while.
+
+#define BUTTON_PORT_NUMBER              (0)
+#define BUTTON_PIN_NUMBER               (0)
+
+#define BUTTON_DEBOUNCE_TICKS           (configTICK_RATE_HZ / 50)
+#define BUTTON_LED_ON_TICKS             (configTICK_RATE_HZ / 2)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Create the button task and its queue and timer, and enable the
+  // interrupt; call from main(), after freertos_heap_init().
+  void
+  button_task_start (UBaseType_t priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // BUTTON_TASK_H_
@@ -0,0 +1,32 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CONTEXT_SWITCH_BENCHMARK_H_
+#define CONTEXT_SWITCH_BENCHMARK_H_
+
+#include "FreeRTOS.h"
+
+// ----------------------------------------------------------------------------
+
+// Measure the FreeRTOS context switch time, with DWT CYCCNT, from
+// taskYIELD() in one task to the return in another task of the same
+// priority, for pairs of integer-only and FPU-using tasks.
+//
+// With the ARM_CM4F port and FPCCR.LSPEN set, tasks that never touched
+// the FPU should switch as fast as on the ARM_CM3 port; tasks that did
+// also save/restore s16-s31 and, lazily, the s0-s15/FPSCR frame.
+
+#if !defined(OS_INTEGER_BENCHMARK_CONTEXT_SWITCH_ITERATIONS)
+#define OS_INTEGER_BENCHMARK_CONTEXT_SWITCH_ITERATIONS  (1000)
+#endif
+
+// Create the task that runs all cases and prints the results on the
+// trace device; the worker tasks use the next higher priority.
+extern void
+context_switch_benchmark_start (UBaseType_t priority);
+
+// ----------------------------------------------------------------------------
+
+#endif // CONTEXT_SWITCH_BENCHMARK_H_
@@ -0,0 +1,89 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// ----------------------------------------------------------------------------
+
+// CRC-32 as computed by the STM32 CRC unit: polynomial 0x04C11DB7,
+// initial value 0xFFFFFFFF, not reflected, no final XOR (known as
+// CRC-32/MPEG-2). The data is taken as little endian 32-bit words,
+// each processed MSB first; the trailing 1-3 bytes are processed one
+// at a time, also MSB first.
+//
+// The unit is fed by the CPU with word writes, or, for buffers of at
+// least OS_INTEGER_CRC32_DMA_THRESHOLD bytes, by DMA (memory to
+// memory; 0 disables it). When the unit is in use (by an interrupt
+// handler or another task), or did not pass the self test in
+// crc32_init() (as under QEMU, which does not emulate it), the
+// computation falls back to a slice-by-8 table implementation, with
+// 8 KB of tables in RAM. Both give the same results. A DMA transfer
+// error also falls back to the tables, for the rest of the buffer,
+// and buffers in the CCM RAM (not reachable by DMA) are fed by the
+// CPU.
+//
+// The flash image is checked with crc32_check_image(), against the
+// value stamped after the link by scripts/image-crc.py in the
+// .image_crc section, which the linker script places at the end of
+// the image.
+
+#if !defined(OS_INTEGER_CRC32_DMA_THRESHOLD)
+#define OS_INTEGER_CRC32_DMA_THRESHOLD          (4096)
+#endif
+
+#define CRC32_INIT                              (0xFFFFFFFFu)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Enable the CRC unit and build the tables; call once, before any
+  // other function.
+  void
+  crc32_init (void);
+
+  // The CRC of a buffer.
+  uint32_t
+  crc32 (const void* buf, size_t nbyte);
+
+  // Continue a CRC over the next buffer; the result is the same as
+  // for the concatenated buffers, provided all but the last have a
+  // multiple of 4 bytes.
+  uint32_t
+  crc32_update (uint32_t crc, const void* buf, size_t nbyte);
+
+  // The table implementation only.
+  uint32_t
+  crc32_software (uint32_t crc, const void* buf, size_t nbyte);
+
+  // The CRC unit only, fed by the CPU (dma false) or by DMA; returns
+  // false if the unit is not available.
+  bool
+  crc32_hardware (uint32_t* crc, const void* buf, size_t nbyte, bool dma);
+
+  bool
+  crc32_hardware_available (void);
+
+#define CRC32_IMAGE_OK                          (0)
+#define CRC32_IMAGE_NOT_STAMPED                 (1)
+#define CRC32_IMAGE_CORRUPT                     (-1)
+
+  // Compare the CRC of the flash image with the stamped value.
+  int
+  crc32_check_image (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // CRC32_H_
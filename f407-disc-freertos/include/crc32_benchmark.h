@@ -0,0 +1,36 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CRC32_BENCHMARK_H_
+#define CRC32_BENCHMARK_H_
+
+// ----------------------------------------------------------------------------
+
+// Measure the throughput of the CRC-32 implementations: the table
+// (slice-by-8), the CRC unit fed by the CPU, and fed by DMA, for
+// buffer sizes from 64 bytes to OS_INTEGER_BENCHMARK_CRC32_SIZE, and
+// print the DWT cycles per byte and MB/s; also check that all give
+// the same result.
+
+#if !defined(OS_INTEGER_BENCHMARK_CRC32_SIZE)
+#define OS_INTEGER_BENCHMARK_CRC32_SIZE         (4096)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Call after crc32_init().
+  void
+  crc32_benchmark_run (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // CRC32_BENCHMARK_H_
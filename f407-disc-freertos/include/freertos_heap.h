@@ -0,0 +1,27 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef FREERTOS_HEAP_H_
+#define FREERTOS_HEAP_H_
+
+// ----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Define the heap regions, for the implementations that need them
+  // (heap_5, heap_6); must be called before creating any object.
+  void
+  freertos_heap_init (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // FREERTOS_HEAP_H_
@@ -0,0 +1,104 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef FREERTOS_STACK_H_
+#define FREERTOS_STACK_H_
+
+// Included at the end of FreeRTOSConfig.h, after freertos_trace.h;
+// keep it free of FreeRTOS types.
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+// Stack usage profiling, with OS_USE_FREERTOS_STACK_PROFILE defined.
+//
+// The kernel fills each new task stack with a known byte (since
+// configCHECK_FOR_STACK_OVERFLOW is 2), and traceTASK_CREATE() records
+// its depth. freertos_stack_profile_init() fills the free part of the
+// main stack too, which is used by the interrupt handlers once the
+// scheduler runs.
+//
+// A low priority task samples the high water marks of all tasks every
+// OS_INTEGER_FREERTOS_STACK_PROFILE_TICKS, keeps the last
+// OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY of them, and prints the
+// depth of each stack, the most it ever used, and a suggested depth,
+// with OS_INTEGER_FREERTOS_STACK_PROFILE_MARGIN words to spare.
+//
+// On overflow, the task name and its high water mark history are
+// written directly to the trace device; then, with a debugger
+// attached, execution stops at a breakpoint, otherwise the system is
+// reset.
+
+#if !defined(OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS)
+#define OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS         (16)
+#endif
+
+#if !defined(OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY)
+#define OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY       (8)
+#endif
+
+#if !defined(OS_INTEGER_FREERTOS_STACK_PROFILE_TICKS)
+#define OS_INTEGER_FREERTOS_STACK_PROFILE_TICKS         (10000)
+#endif
+
+// In words.
+#if !defined(OS_INTEGER_FREERTOS_STACK_PROFILE_MARGIN)
+#define OS_INTEGER_FREERTOS_STACK_PROFILE_MARGIN        (32)
+#endif
+
+#if defined(OS_USE_FREERTOS_STACK_PROFILE)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Call from main(), before the scheduler starts.
+  void
+  freertos_stack_profile_init (void);
+
+  // Create the sampling task.
+  void
+  freertos_stack_profile_start (unsigned long priority);
+
+  // Take a sample now and print the report on the trace device.
+  void
+  freertos_stack_profile_print (void);
+
+  // Called by traceTASK_CREATE(), in a critical section.
+  void
+  freertos_stack_task_create (void* task, const char* name, uint32_t depth);
+
+  // Called by vApplicationStackOverflowHook(); does not return.
+  void
+  freertos_stack_overflow (void* task, const char* name)
+  __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+// usStackDepth is the xTaskGenericCreate() parameter.
+#undef traceTASK_CREATE
+#if defined(OS_USE_FREERTOS_TRACE)
+#define traceTASK_CREATE(pxNewTCB) \
+  do { \
+    freertos_trace_task_create ((uint8_t) (pxNewTCB)->uxTCBNumber, \
+        (pxNewTCB)->pcTaskName); \
+    freertos_stack_task_create ((pxNewTCB), (pxNewTCB)->pcTaskName, \
+        usStackDepth); \
+  } while (0)
+#else
+#define traceTASK_CREATE(pxNewTCB) \
+  freertos_stack_task_create ((pxNewTCB), (pxNewTCB)->pcTaskName, \
+      usStackDepth)
+#endif
+
+#endif // defined(OS_USE_FREERTOS_STACK_PROFILE)
+
+// ----------------------------------------------------------------------------
+
+#endif // FREERTOS_STACK_H_
@@ -0,0 +1,207 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef FREERTOS_STATIC_H_
+#define FREERTOS_STATIC_H_
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "timers.h"
+#include "event_groups.h"
+
+// ----------------------------------------------------------------------------
+
+// Static allocation for FreeRTOS V8.2.1.
+//
+// The kernel in this project predates configSUPPORT_STATIC_ALLOCATION
+// (added in V9) and always calls pvPortMalloc() for the TCBs and the
+// queues. With configSUPPORT_STATIC_ALLOCATION set to 1, the heap is
+// replaced by src/freertos_static.c, which:
+// - hands the buffers given to xTaskCreateStatic()/xQueueCreateStatic()
+//   to the kernel, when it asks for them;
+// - serves the kernel own objects (the idle and timer tasks, and the
+//   timer queue) from a fixed arena of configSTATIC_KERNEL_HEAP_SIZE
+//   bytes, and only until the scheduler is started;
+// - fails any other allocation.
+//
+// All memory is thus in .bss and accounted for by the linker, and
+// there is no allocation at run time.
+//
+// The Static*_t types are sized after the V8.2.1 private structures;
+// the allocator asserts the kernel never asks for more.
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+
+#if (portUSING_MPU_WRAPPERS == 1) || (portSTACK_GROWTH > 0) \
+  || (configUSE_LIST_DATA_INTEGRITY_CHECK_BYTES == 1)
+#error "Static allocation not supported by this configuration"
+#endif
+
+typedef struct xSTATIC_LIST_ITEM
+{
+  TickType_t xDummy1;
+  void* pvDummy2[4];
+} StaticListItem_t;
+
+typedef struct xSTATIC_MINI_LIST_ITEM
+{
+  TickType_t xDummy1;
+  void* pvDummy2[2];
+} StaticMiniListItem_t;
+
+typedef struct xSTATIC_LIST
+{
+  UBaseType_t uxDummy1;
+  void* pvDummy2;
+  StaticMiniListItem_t xDummy3;
+} StaticList_t;
+
+typedef struct xSTATIC_TCB
+{
+  void* pxDummy1;
+  StaticListItem_t xDummy3[2];
+  UBaseType_t uxDummy5;
+  void* pxDummy6;
+  uint8_t ucDummy7[configMAX_TASK_NAME_LEN];
+#if (portCRITICAL_NESTING_IN_TCB == 1)
+  UBaseType_t uxDummy9;
+#endif
+#if (configUSE_TRACE_FACILITY == 1)
+  UBaseType_t uxDummy10[2];
+#endif
+#if (configUSE_MUTEXES == 1)
+  UBaseType_t uxDummy12[2];
+#endif
+#if (configUSE_APPLICATION_TASK_TAG == 1)
+  void* pxDummy14;
+#endif
+#if (configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0)
+  void* pvDummy15[configNUM_THREAD_LOCAL_STORAGE_POINTERS];
+#endif
+#if (configGENERATE_RUN_TIME_STATS == 1)
+  uint32_t ulDummy16;
+#endif
+#if (configUSE_NEWLIB_REENTRANT == 1)
+  struct _reent xDummy17;
+#endif
+#if (configUSE_TASK_NOTIFICATIONS == 1)
+  uint32_t ulDummy18;
+  uint32_t eDummy19;
+#endif
+} StaticTask_t;
+
+typedef struct xSTATIC_QUEUE
+{
+  void* pvDummy1[3];
+  union
+  {
+    void* pvDummy2;
+    UBaseType_t uxDummy2;
+  } u;
+  StaticList_t xDummy3[2];
+  UBaseType_t uxDummy4[3];
+  BaseType_t xDummy5[2];
+#if (configUSE_TRACE_FACILITY == 1)
+  UBaseType_t uxDummy6;
+  uint8_t ucDummy7;
+#endif
+#if (configUSE_QUEUE_SETS == 1)
+  void* pvDummy8;
+#endif
+} StaticQueue_t;
+
+// A mutex is a queue without storage.
+typedef StaticQueue_t StaticSemaphore_t;
+
+typedef struct xSTATIC_TIMER
+{
+  void* pvDummy1;
+  StaticListItem_t xDummy2;
+  TickType_t xDummy3;
+  UBaseType_t uxDummy4;
+  void* pvDummy5[2];
+#if (configUSE_TRACE_FACILITY == 1)
+  UBaseType_t uxDummy6;
+#endif
+} StaticTimer_t;
+
+typedef struct xSTATIC_EVENT_GROUP
+{
+  TickType_t xDummy1;
+  StaticList_t xDummy2;
+#if (configUSE_TRACE_FACILITY == 1)
+  UBaseType_t uxDummy3;
+#endif
+} StaticEventGroup_t;
+
+// In V8.2.1 the queue control block and its storage area are a single
+// allocation, so, unlike the V9 API, xQueueCreateStatic() takes one
+// buffer, of this many bytes.
+#define queueSTATIC_BUFFER_SIZE( uxQueueLength, uxItemSize ) \
+  ( sizeof( StaticQueue_t ) + ( size_t ) ( uxQueueLength ) * ( uxItemSize ) + 1 )
+
+// The arena for the idle task, the timer task and the timer queue.
+#if !defined(configSTATIC_KERNEL_HEAP_SIZE)
+#if (configUSE_TIMERS == 1)
+#define configSTATIC_KERNEL_HEAP_SIZE \
+  ( 2 * ( sizeof( StaticTask_t ) + portBYTE_ALIGNMENT ) \
+    + ( configMINIMAL_STACK_SIZE + configTIMER_TASK_STACK_DEPTH ) * sizeof( StackType_t ) \
+    + queueSTATIC_BUFFER_SIZE( configTIMER_QUEUE_LENGTH, 4 * sizeof( void* ) ) \
+    + 2 * portBYTE_ALIGNMENT )
+#else
+#define configSTATIC_KERNEL_HEAP_SIZE \
+  ( sizeof( StaticTask_t ) + configMINIMAL_STACK_SIZE * sizeof( StackType_t ) \
+    + 2 * portBYTE_ALIGNMENT )
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  TaskHandle_t
+  xTaskCreateStatic (TaskFunction_t pxTaskCode, const char* const pcName,
+                     const uint32_t ulStackDepth, void* const pvParameters,
+                     UBaseType_t uxPriority, StackType_t* const puxStackBuffer,
+                     StaticTask_t* const pxTaskBuffer);
+
+  QueueHandle_t
+  xQueueCreateStatic (const UBaseType_t uxQueueLength,
+                      const UBaseType_t uxItemSize, uint8_t* pucQueueBuffer);
+
+#if (configUSE_MUTEXES == 1)
+  SemaphoreHandle_t
+  xSemaphoreCreateMutexStatic (StaticSemaphore_t* pxMutexBuffer);
+#endif
+
+#if (configUSE_RECURSIVE_MUTEXES == 1)
+  SemaphoreHandle_t
+  xSemaphoreCreateRecursiveMutexStatic (StaticSemaphore_t* pxMutexBuffer);
+#endif
+
+#if (configUSE_TIMERS == 1)
+  TimerHandle_t
+  xTimerCreateStatic (const char* const pcTimerName,
+                      const TickType_t xTimerPeriodInTicks,
+                      const UBaseType_t uxAutoReload, void* const pvTimerID,
+                      TimerCallbackFunction_t pxCallbackFunction,
+                      StaticTimer_t* pxTimerBuffer);
+#endif
+
+  EventGroupHandle_t
+  xEventGroupCreateStatic (StaticEventGroup_t* pxEventGroupBuffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // (configSUPPORT_STATIC_ALLOCATION == 1)
+
+// ----------------------------------------------------------------------------
+
+#endif // FREERTOS_STATIC_H_
@@ -0,0 +1,52 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef FREERTOS_TICKLESS_H_
+#define FREERTOS_TICKLESS_H_
+
+// Included at the end of FreeRTOSConfig.h, so it is seen by all
+// FreeRTOS sources; keep it free of FreeRTOS types.
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+// Tickless idle. By default the port's vPortSuppressTicksAndSleep()
+// reprograms SysTick, which limits a single sleep to about 99 ms at
+// 168 MHz. With OS_USE_FREERTOS_TICKLESS_TIMER defined, the kernel tick
+// is generated by the 32-bit TIM5 instead, counting at
+// OS_INTEGER_FREERTOS_TICKLESS_TIMER_HZ, and SysTick is stopped once
+// the scheduler starts; then the idle task can sleep for as long as
+// no task needs to run.
+//
+// In both cases the HAL tick is derived from the kernel tick count
+// (see HAL_GetTick() in FreeRTOS_helper.c), so it stays correct across
+// suppressed ticks.
+
+#if !defined(OS_INTEGER_FREERTOS_TICKLESS_TIMER_HZ)
+#define OS_INTEGER_FREERTOS_TICKLESS_TIMER_HZ   (1000000)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Called with interrupts disabled, just before WFI; when trace output
+  // is still pending, it cancels the sleep (sets the expected idle
+  // ticks to 0), so the idle hook writes it out first.
+  void
+  freertos_pre_sleep_processing (uint32_t* expected_idle_ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define configPRE_SLEEP_PROCESSING( x ) \
+  freertos_pre_sleep_processing (&( x ))
+
+// ----------------------------------------------------------------------------
+
+#endif // FREERTOS_TICKLESS_H_
@@ -0,0 +1,233 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef FREERTOS_TRACE_H_
+#define FREERTOS_TRACE_H_
+
+// Included at the end of FreeRTOSConfig.h, so it is seen by all
+// FreeRTOS sources; keep it free of FreeRTOS types.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ----------------------------------------------------------------------------
+
+// Run time statistics, based on the DWT cycle counter, extended to
+// 64-bits in software. The extension is updated on each context switch
+// and on each tick (traceTASK_INCREMENT_TICK), well below the 25 s
+// wrap period of the 32-bit counter at 168 MHz; the ticks suppressed
+// by tickless idle do not update it, so with
+// OS_USE_FREERTOS_TICKLESS_TIMER an idle period longer than 25 s loses
+// a wrap.
+//
+// FreeRTOS keeps 32-bit per task counters, so the cycles are scaled
+// down by OS_INTEGER_RUN_TIME_STATS_SHIFT; with 6 the counters wrap
+// after about 27 minutes.
+//
+// freertos_run_time_stats_print() reports at most
+// OS_INTEGER_RUN_TIME_STATS_TASKS tasks.
+
+#if !defined(OS_INTEGER_RUN_TIME_STATS_SHIFT)
+#define OS_INTEGER_RUN_TIME_STATS_SHIFT         (6)
+#endif
+
+#if !defined(OS_INTEGER_RUN_TIME_STATS_TASKS)
+#define OS_INTEGER_RUN_TIME_STATS_TASKS         (16)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  void
+  freertos_run_time_stats_init (void);
+
+  uint32_t
+  freertos_run_time_stats_counter (void);
+
+  uint64_t
+  freertos_trace_cycles (void);
+
+  // Print the per task CPU usage on the trace device.
+  void
+  freertos_run_time_stats_print (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() \
+  freertos_run_time_stats_init ()
+#define portGET_RUN_TIME_COUNTER_VALUE() \
+  freertos_run_time_stats_counter ()
+#define traceTASK_INCREMENT_TICK(xTickCount) \
+  (void) freertos_trace_cycles ()
+
+// ----------------------------------------------------------------------------
+
+#if defined(OS_USE_FREERTOS_TRACE)
+
+// Binary event trace. Each event is an 8 bytes record, stored in a RAM
+// ring by the kernel trace hooks, and written out from the idle task,
+// either to an ITM stimulus port (with OS_USE_TRACE_ITM), or, via
+// semihosting, to a host file.
+//
+// Records are little endian:
+// - timestamp: DWT->CYCCNT (the host unwraps it);
+// - type: one of freertos_trace_type_t;
+// - task: the FreeRTOS TCB number of the running task (0 if none);
+// - arg: event specific (TCB number, low bits of the queue address,
+//   exception number, delay ticks).
+//
+// The task names are sent with FREERTOS_TRACE_TASK_NAME records, which
+// carry 4 characters in the timestamp field and the offset in arg.
+//
+// Each batch written out is followed by a FREERTOS_TRACE_CHECKSUM
+// record, with the crc32() of the batch in the timestamp field and
+// the number of records in arg, so the host can detect corruption.
+//
+// Use scripts/freertos-trace.py to render a per task timeline.
+
+#if !defined(OS_INTEGER_FREERTOS_TRACE_RECORDS)
+#define OS_INTEGER_FREERTOS_TRACE_RECORDS       (512)
+#endif
+
+#if !defined(OS_INTEGER_FREERTOS_TRACE_ITM_PORT)
+#define OS_INTEGER_FREERTOS_TRACE_ITM_PORT      (1)
+#endif
+
+#if !defined(OS_STRING_FREERTOS_TRACE_FILE)
+#define OS_STRING_FREERTOS_TRACE_FILE           "freertos-trace.bin"
+#endif
+
+typedef enum
+{
+  FREERTOS_TRACE_TASK_SWITCHED_IN = 1,
+  FREERTOS_TRACE_TASK_SWITCHED_OUT,
+  FREERTOS_TRACE_TASK_CREATE,
+  FREERTOS_TRACE_TASK_NAME,
+  FREERTOS_TRACE_TASK_DELETE,
+  FREERTOS_TRACE_TASK_DELAY,
+  FREERTOS_TRACE_QUEUE_SEND,
+  FREERTOS_TRACE_QUEUE_SEND_FAILED,
+  FREERTOS_TRACE_QUEUE_RECEIVE,
+  FREERTOS_TRACE_QUEUE_RECEIVE_FAILED,
+  FREERTOS_TRACE_QUEUE_SEND_FROM_ISR,
+  FREERTOS_TRACE_QUEUE_RECEIVE_FROM_ISR,
+  FREERTOS_TRACE_QUEUE_BLOCK_SEND,
+  FREERTOS_TRACE_QUEUE_BLOCK_RECEIVE,
+  FREERTOS_TRACE_ISR_ENTER,
+  FREERTOS_TRACE_ISR_EXIT,
+  FREERTOS_TRACE_OVERFLOW,
+  FREERTOS_TRACE_CHECKSUM,
+} freertos_trace_type_t;
+
+typedef struct
+{
+  uint32_t timestamp;
+  uint8_t type;
+  uint8_t task;
+  uint16_t arg;
+} freertos_trace_record_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // The TCB number of the running task, updated on switch in.
+  extern volatile uint8_t freertos_trace_current_task;
+
+  // Can be called from any context, including handlers above the
+  // FreeRTOS syscall priority.
+  void
+  freertos_trace_record (uint8_t type, uint8_t task, uint16_t arg);
+
+  void
+  freertos_trace_task_create (uint8_t task, const char* name);
+
+  void
+  freertos_trace_isr_enter (void);
+
+  void
+  freertos_trace_isr_exit (void);
+
+  // Write out the pending records; called from the idle hook.
+  void
+  freertos_trace_drain (void);
+
+  // Whether there are records not yet written out; can be called with
+  // interrupts disabled.
+  bool
+  freertos_trace_pending (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define FREERTOS_TRACE_QUEUE_ID(q) \
+  ((uint16_t) (((uint32_t) (q)) >> 2))
+
+#define traceTASK_SWITCHED_IN() \
+  do { \
+    freertos_trace_current_task = (uint8_t) pxCurrentTCB->uxTCBNumber; \
+    freertos_trace_record (FREERTOS_TRACE_TASK_SWITCHED_IN, \
+        freertos_trace_current_task, 0); \
+  } while (0)
+
+#define traceTASK_SWITCHED_OUT() \
+  freertos_trace_record (FREERTOS_TRACE_TASK_SWITCHED_OUT, \
+      (uint8_t) pxCurrentTCB->uxTCBNumber, 0)
+
+#define traceTASK_CREATE(pxNewTCB) \
+  freertos_trace_task_create ((uint8_t) (pxNewTCB)->uxTCBNumber, \
+      (pxNewTCB)->pcTaskName)
+
+#define traceTASK_DELETE(pxTaskToDelete) \
+  freertos_trace_record (FREERTOS_TRACE_TASK_DELETE, \
+      freertos_trace_current_task, (uint16_t) (pxTaskToDelete)->uxTCBNumber)
+
+#define traceTASK_DELAY() \
+  freertos_trace_record (FREERTOS_TRACE_TASK_DELAY, \
+      freertos_trace_current_task, (uint16_t) xTicksToDelay)
+
+#define traceQUEUE_SEND(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_SEND, \
+      freertos_trace_current_task, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#define traceQUEUE_SEND_FAILED(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_SEND_FAILED, \
+      freertos_trace_current_task, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#define traceQUEUE_RECEIVE(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_RECEIVE, \
+      freertos_trace_current_task, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#define traceQUEUE_RECEIVE_FAILED(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_RECEIVE_FAILED, \
+      freertos_trace_current_task, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_SEND_FROM_ISR, \
+      0, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_RECEIVE_FROM_ISR, \
+      0, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_BLOCK_SEND, \
+      freertos_trace_current_task, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
+  freertos_trace_record (FREERTOS_TRACE_QUEUE_BLOCK_RECEIVE, \
+      freertos_trace_current_task, FREERTOS_TRACE_QUEUE_ID (pxQueue))
+
+#endif // defined(OS_USE_FREERTOS_TRACE)
+
+// ----------------------------------------------------------------------------
+
+#endif // FREERTOS_TRACE_H_
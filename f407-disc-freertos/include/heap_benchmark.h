@@ -0,0 +1,38 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef HEAP_BENCHMARK_H_
+#define HEAP_BENCHMARK_H_
+
+#include "FreeRTOS.h"
+
+// ----------------------------------------------------------------------------
+
+// Stress the FreeRTOS heap with a pseudo-random, but reproducible,
+// sequence of allocations and frees of message-sized blocks, and print
+// the DWT cycles spent in pvPortMalloc() and vPortFree().
+//
+// The sequence does not depend on the heap, so the results of builds
+// with different configHEAP_IMPLEMENTATION values can be compared
+// (heap_1 cannot free, so it only allocates until full).
+
+#if !defined(OS_INTEGER_BENCHMARK_HEAP_SLOTS)
+#define OS_INTEGER_BENCHMARK_HEAP_SLOTS         (32)
+#endif
+
+#if !defined(OS_INTEGER_BENCHMARK_HEAP_STEPS)
+#define OS_INTEGER_BENCHMARK_HEAP_STEPS         (4000)
+#endif
+
+#if !defined(OS_INTEGER_BENCHMARK_HEAP_MAX_SIZE)
+#define OS_INTEGER_BENCHMARK_HEAP_MAX_SIZE      (256)
+#endif
+
+extern void
+heap_benchmark_start (UBaseType_t priority);
+
+// ----------------------------------------------------------------------------
+
+#endif // HEAP_BENCHMARK_H_
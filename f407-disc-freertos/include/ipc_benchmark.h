@@ -0,0 +1,46 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef IPC_BENCHMARK_H_
+#define IPC_BENCHMARK_H_
+
+#include "FreeRTOS.h"
+
+// ----------------------------------------------------------------------------
+
+// Producer/consumer benchmark for the ways of moving data to a task:
+// - a queue of 16 byte messages;
+// - a queue of bytes, 16 items per message;
+// - a direct to task notification, carrying one 32-bit value;
+// - an SPSC byte ring (spsc_ring.h) plus a notification when it
+//   becomes non-empty, i.e. what a stream buffer does;
+// - the SPSC ring alone, with the consumer polling.
+//
+// Each case is run with the producer a task and, via a software
+// triggered TIM7 interrupt, an ISR. The blocking consumers run at a
+// higher priority than the producer, so every message includes the
+// wake-up and the context switch; the polling consumer runs at the
+// same priority and takes the messages in batches.
+//
+// For each case, the average cycles per message (from the first send
+// to the last receive), the resulting messages per second, and the
+// min/max send to receive latency are printed on the trace device.
+
+#if !defined(OS_INTEGER_BENCHMARK_IPC_MESSAGES)
+#define OS_INTEGER_BENCHMARK_IPC_MESSAGES       (2000)
+#endif
+
+#if !defined(OS_INTEGER_BENCHMARK_IPC_RING_SIZE)
+#define OS_INTEGER_BENCHMARK_IPC_RING_SIZE      (256)
+#endif
+
+// Create the producer task, which runs all cases; the consumers use
+// the same or the next higher priority.
+extern void
+ipc_benchmark_start (UBaseType_t priority);
+
+// ----------------------------------------------------------------------------
+
+#endif // IPC_BENCHMARK_H_
@@ -0,0 +1,521 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef RTOS_H_
+#define RTOS_H_
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "timers.h"
+#include "event_groups.h"
+#include "freertos_static.h"
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// ----------------------------------------------------------------------------
+
+// Header only C++ layer over the FreeRTOS C API.
+//
+// All members are inline and call the C API directly; there are no
+// virtual functions and no allocations of its own. With
+// configSUPPORT_STATIC_ALLOCATION set to 1, each object embeds the
+// memory of its kernel object (see freertos_static.h), so defining it
+// as a static or global object accounts for all of it at link time;
+// otherwise the kernel objects come from the FreeRTOS heap.
+//
+// The objects are meant to live as long as the application, so they
+// do not delete their kernel objects. Objects constructed before
+// main() need the heap to be ready; with heap 5 or 6, which are set
+// up by freertos_heap_init(), define them in a function instead.
+
+namespace rtos
+{
+  typedef TickType_t ticks_t;
+
+  static constexpr ticks_t forever = portMAX_DELAY;
+
+  // --------------------------------------------------------------------------
+
+  namespace this_task
+  {
+    inline void
+    __attribute__((always_inline))
+    delay (ticks_t ticks)
+    {
+      vTaskDelay (ticks);
+    }
+
+    // Sleep until previous + period; previous is updated, for the
+    // next call, so the period does not drift.
+    inline void
+    __attribute__((always_inline))
+    delay_until (ticks_t& previous, ticks_t period)
+    {
+      vTaskDelayUntil (&previous, period);
+    }
+
+    inline void
+    __attribute__((always_inline))
+    yield (void)
+    {
+      taskYIELD();
+    }
+
+    // Wait for task::notify(); return the number of notifications
+    // taken, or 0 on timeout.
+    inline uint32_t
+    __attribute__((always_inline))
+    wait_notification (ticks_t ticks = forever)
+    {
+      return ulTaskNotifyTake (pdTRUE, ticks);
+    }
+  }
+
+  // --------------------------------------------------------------------------
+
+  // A task, with the stack depth (in words) known at compile time.
+  template<uint32_t StackDepth>
+    class task
+    {
+    public:
+
+      task (TaskFunction_t function, const char* name, void* parameters,
+            UBaseType_t priority)
+      {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+        handle_ = xTaskCreateStatic (function, name, StackDepth, parameters,
+                                     priority, stack_, &tcb_);
+#else
+        handle_ = NULL;
+        xTaskCreate(function, name, StackDepth, parameters, priority,
+                    &handle_);
+#endif
+      }
+
+      task (const task&) = delete;
+      task&
+      operator= (const task&) = delete;
+
+      void
+      notify (void)
+      {
+        xTaskNotifyGive(handle_);
+      }
+
+      void
+      notify_from_isr (BaseType_t* woken)
+      {
+        vTaskNotifyGiveFromISR (handle_, woken);
+      }
+
+      void
+      suspend (void)
+      {
+        vTaskSuspend (handle_);
+      }
+
+      void
+      resume (void)
+      {
+        vTaskResume (handle_);
+      }
+
+      TaskHandle_t
+      handle (void) const
+      {
+        return handle_;
+      }
+
+    private:
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+      StaticTask_t tcb_;
+      StackType_t stack_[StackDepth] __attribute__((aligned(portBYTE_ALIGNMENT)));
+#endif
+      TaskHandle_t handle_;
+    };
+
+  // --------------------------------------------------------------------------
+
+#if (configUSE_MUTEXES == 1)
+
+  // A mutex with priority inheritance; not recursive, and not usable
+  // from interrupt handlers.
+  class mutex
+  {
+  public:
+
+    mutex ()
+    {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+      handle_ = xSemaphoreCreateMutexStatic (&buffer_);
+#else
+      handle_ = xSemaphoreCreateMutex();
+#endif
+    }
+
+    mutex (const mutex&) = delete;
+    mutex&
+    operator= (const mutex&) = delete;
+
+    void
+    lock (void)
+    {
+      xSemaphoreTake(handle_, forever);
+    }
+
+    bool
+    try_lock (ticks_t ticks = 0)
+    {
+      return xSemaphoreTake(handle_, ticks) == pdTRUE;
+    }
+
+    void
+    unlock (void)
+    {
+      xSemaphoreGive(handle_);
+    }
+
+    SemaphoreHandle_t
+    native_handle (void) const
+    {
+      return handle_;
+    }
+
+  private:
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    StaticSemaphore_t buffer_;
+#endif
+    SemaphoreHandle_t handle_;
+  };
+
+#endif // (configUSE_MUTEXES == 1)
+
+  // Lock for the lifetime of the guard object.
+  template<typename Mutex>
+    class lock_guard
+    {
+    public:
+
+      explicit
+      lock_guard (Mutex& mutex) :
+          mutex_ (mutex)
+      {
+        mutex_.lock ();
+      }
+
+      ~lock_guard ()
+      {
+        mutex_.unlock ();
+      }
+
+      lock_guard (const lock_guard&) = delete;
+      lock_guard&
+      operator= (const lock_guard&) = delete;
+
+    private:
+
+      Mutex& mutex_;
+    };
+
+  // --------------------------------------------------------------------------
+
+  // A queue of up to Length objects of type T.
+  //
+  // FreeRTOS copies the items as bytes. For trivially copyable types
+  // the calls go straight to xQueueSend()/xQueueReceive(); other types
+  // are constructed (copied, moved or emplaced) in a local buffer, whose
+  // bytes, and with them the ownership, go to the queue; receive()
+  // moves the object out of the received bytes and destroys them. So T
+  // must not point into itself.
+  template<typename T, UBaseType_t Length>
+    class queue
+    {
+    public:
+
+      typedef T value_type;
+
+      queue ()
+      {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+        handle_ = xQueueCreateStatic (Length, sizeof(T), buffer_);
+#else
+        handle_ = xQueueCreate(Length, sizeof(T));
+#endif
+      }
+
+      queue (const queue&) = delete;
+      queue&
+      operator= (const queue&) = delete;
+
+      bool
+      send (const T& item, ticks_t ticks = forever)
+      {
+        if (std::is_trivially_copyable<T>::value)
+          {
+            return xQueueSend(handle_, &item, ticks) == pdTRUE;
+          }
+        return emplace_for (ticks, item);
+      }
+
+      bool
+      send (T&& item, ticks_t ticks = forever)
+      {
+        if (std::is_trivially_copyable<T>::value)
+          {
+            return xQueueSend(handle_, &item, ticks) == pdTRUE;
+          }
+        return emplace_for (ticks, std::move (item));
+      }
+
+      // Construct the item from the arguments, waiting forever.
+      template<typename ... Args>
+        bool
+        emplace (Args&&... args)
+        {
+          return emplace_for (forever, std::forward<Args>(args)...);
+        }
+
+      template<typename ... Args>
+        bool
+        emplace_for (ticks_t ticks, Args&&... args)
+        {
+          storage_t storage;
+          T* p = new (&storage) T (std::forward<Args>(args)...);
+          if (xQueueSend(handle_, p, ticks) == pdTRUE)
+            {
+              return true;
+            }
+          p->~T ();
+          return false;
+        }
+
+      bool
+      send_from_isr (const T& item, BaseType_t* woken)
+      {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "Only trivially copyable items can be sent from ISRs");
+        return xQueueSendFromISR(handle_, &item, woken) == pdTRUE;
+      }
+
+      bool
+      receive (T& item, ticks_t ticks = forever)
+      {
+        if (std::is_trivially_copyable<T>::value)
+          {
+            return xQueueReceive(handle_, &item, ticks) == pdTRUE;
+          }
+
+        storage_t storage;
+        if (xQueueReceive(handle_, &storage, ticks) != pdTRUE)
+          {
+            return false;
+          }
+        T* p = reinterpret_cast<T*> (&storage);
+        item = std::move (*p);
+        p->~T ();
+        return true;
+      }
+
+      bool
+      receive_from_isr (T& item, BaseType_t* woken)
+      {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "Only trivially copyable items can be received in ISRs");
+        return xQueueReceiveFromISR (handle_, &item, woken) == pdTRUE;
+      }
+
+      UBaseType_t
+      size (void) const
+      {
+        return uxQueueMessagesWaiting (handle_);
+      }
+
+      QueueHandle_t
+      handle (void) const
+      {
+        return handle_;
+      }
+
+    private:
+
+      typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_t;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+      uint8_t buffer_[queueSTATIC_BUFFER_SIZE(Length, sizeof(T))] __attribute__((aligned(portBYTE_ALIGNMENT)));
+#endif
+      QueueHandle_t handle_;
+    };
+
+  // --------------------------------------------------------------------------
+
+  // A set of event bits (the low 24 bits of EventBits_t) tasks can wait
+  // for. Setting bits from an ISR is deferred to the timer service
+  // task, via xTimerPendFunctionCallFromISR().
+  class event_group
+  {
+  public:
+
+    event_group ()
+    {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+      handle_ = xEventGroupCreateStatic (&buffer_);
+#else
+      handle_ = xEventGroupCreate ();
+#endif
+    }
+
+    event_group (const event_group&) = delete;
+    event_group&
+    operator= (const event_group&) = delete;
+
+    EventBits_t
+    set (EventBits_t bits)
+    {
+      return xEventGroupSetBits (handle_, bits);
+    }
+
+    bool
+    set_from_isr (EventBits_t bits, BaseType_t* woken)
+    {
+      return xEventGroupSetBitsFromISR(handle_, bits, woken) == pdPASS;
+    }
+
+    EventBits_t
+    clear (EventBits_t bits)
+    {
+      return xEventGroupClearBits (handle_, bits);
+    }
+
+    // Wait for any (or all) of the bits, and clear them on return;
+    // return the bits at the time the wait ended.
+    EventBits_t
+    wait_any (EventBits_t bits, ticks_t ticks = forever)
+    {
+      return xEventGroupWaitBits (handle_, bits, pdTRUE, pdFALSE, ticks);
+    }
+
+    EventBits_t
+    wait_all (EventBits_t bits, ticks_t ticks = forever)
+    {
+      return xEventGroupWaitBits (handle_, bits, pdTRUE, pdTRUE, ticks);
+    }
+
+    EventGroupHandle_t
+    handle (void) const
+    {
+      return handle_;
+    }
+
+  private:
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    StaticEventGroup_t buffer_;
+#endif
+    EventGroupHandle_t handle_;
+  };
+
+  // --------------------------------------------------------------------------
+
+#if (configUSE_TIMERS == 1)
+
+  // A software timer; the callback runs in the timer service task and
+  // gets the timer handle, from which timer::id() returns the pointer
+  // given to the constructor.
+  class timer
+  {
+  public:
+
+    timer (const char* name, ticks_t period, bool auto_reload,
+           TimerCallbackFunction_t callback, void* id = nullptr)
+    {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+      handle_ = xTimerCreateStatic (name, period, auto_reload ? pdTRUE : pdFALSE,
+                                    id, callback, &buffer_);
+#else
+      handle_ = xTimerCreate (name, period, auto_reload ? pdTRUE : pdFALSE,
+                              id, callback);
+#endif
+    }
+
+    timer (const timer&) = delete;
+    timer&
+    operator= (const timer&) = delete;
+
+    bool
+    start (ticks_t ticks = forever)
+    {
+      return xTimerStart(handle_, ticks) == pdPASS;
+    }
+
+    bool
+    stop (ticks_t ticks = forever)
+    {
+      return xTimerStop(handle_, ticks) == pdPASS;
+    }
+
+    // Restart the period from now.
+    bool
+    reset (ticks_t ticks = forever)
+    {
+      return xTimerReset(handle_, ticks) == pdPASS;
+    }
+
+    bool
+    change_period (ticks_t period, ticks_t ticks = forever)
+    {
+      return xTimerChangePeriod(handle_, period, ticks) == pdPASS;
+    }
+
+    bool
+    reset_from_isr (BaseType_t* woken)
+    {
+      return xTimerResetFromISR(handle_, woken) == pdPASS;
+    }
+
+    bool
+    start_from_isr (BaseType_t* woken)
+    {
+      return xTimerStartFromISR(handle_, woken) == pdPASS;
+    }
+
+    bool
+    is_active (void) const
+    {
+      return xTimerIsTimerActive (handle_) != pdFALSE;
+    }
+
+    static void*
+    id (TimerHandle_t handle)
+    {
+      return pvTimerGetTimerID (handle);
+    }
+
+    TimerHandle_t
+    handle (void) const
+    {
+      return handle_;
+    }
+
+  private:
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    StaticTimer_t buffer_;
+#endif
+    TimerHandle_t handle_;
+  };
+
+#endif // (configUSE_TIMERS == 1)
+
+} // namespace rtos
+
+// ----------------------------------------------------------------------------
+
+#endif // RTOS_H_
@@ -0,0 +1,38 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef SENSOR_TASK_H_
+#define SENSOR_TASK_H_
+
+#include "FreeRTOS.h"
+
+// ----------------------------------------------------------------------------
+
+// Sample use of the bus transfer engine (bus_transfer.h), enabled by
+// OS_USE_SENSOR_TASK: the task reads the chip ID of the CS43L22 audio
+// DAC over I2C, then samples the LIS3DSH accelerometer over SPI every
+// OS_INTEGER_SENSOR_PERIOD_MS, and prints the values once a second.
+// Each register read is one write-then-read transfer, and the task
+// blocks, not spins, while it runs.
+
+#if !defined(OS_INTEGER_SENSOR_PERIOD_MS)
+#define OS_INTEGER_SENSOR_PERIOD_MS             (100)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  void
+  sensor_task_start (UBaseType_t priority);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // SENSOR_TASK_H_
@@ -0,0 +1,119 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Lock-free byte ring for exactly one producer and one consumer, either
+// of which may be a task or an ISR.
+//
+// The head is written only by the producer and the tail only by the
+// consumer; both run freely and are reduced modulo the size, which
+// must be a power of two, when indexing. The data is copied before
+// the index is published, with a DMB in between, so no critical
+// section is needed.
+
+typedef struct
+{
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  uint32_t mask;
+  uint8_t* buffer;
+} spsc_ring_t;
+
+static inline void
+__attribute__((always_inline))
+spsc_ring_init (spsc_ring_t* ring, uint8_t* buffer, uint32_t size)
+{
+  ring->head = 0;
+  ring->tail = 0;
+  ring->mask = size - 1;
+  ring->buffer = buffer;
+}
+
+static inline uint32_t
+__attribute__((always_inline))
+spsc_ring_count (const spsc_ring_t* ring)
+{
+  return ring->head - ring->tail;
+}
+
+static inline uint32_t
+__attribute__((always_inline))
+spsc_ring_space (const spsc_ring_t* ring)
+{
+  return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+// Copy up to len bytes into the ring; return the number copied.
+static inline uint32_t
+spsc_ring_write (spsc_ring_t* ring, const void* data, uint32_t len)
+{
+  uint32_t head = ring->head;
+  uint32_t space = ring->mask + 1 - (head - ring->tail);
+  if (len > space)
+    {
+      len = space;
+    }
+
+  uint32_t offset = head & ring->mask;
+  uint32_t first = ring->mask + 1 - offset;
+  if (first > len)
+    {
+      first = len;
+    }
+  memcpy (ring->buffer + offset, data, first);
+  memcpy (ring->buffer, (const uint8_t*) data + first, len - first);
+
+  __DMB ();
+  ring->head = head + len;
+  return len;
+}
+
+// Copy up to len bytes out of the ring, leaving them in; return the
+// number copied. Consumer side only.
+static inline uint32_t
+spsc_ring_peek (const spsc_ring_t* ring, void* data, uint32_t len)
+{
+  uint32_t tail = ring->tail;
+  uint32_t count = ring->head - tail;
+  if (len > count)
+    {
+      len = count;
+    }
+  __DMB ();
+
+  uint32_t offset = tail & ring->mask;
+  uint32_t first = ring->mask + 1 - offset;
+  if (first > len)
+    {
+      first = len;
+    }
+  memcpy (data, ring->buffer + offset, first);
+  memcpy ((uint8_t*) data + first, ring->buffer, len - first);
+
+  return len;
+}
+
+// Copy up to len bytes out of the ring; return the number copied.
+static inline uint32_t
+spsc_ring_read (spsc_ring_t* ring, void* data, uint32_t len)
+{
+  len = spsc_ring_peek (ring, data, len);
+
+  __DMB ();
+  ring->tail += len;
+  return len;
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // SPSC_RING_H_
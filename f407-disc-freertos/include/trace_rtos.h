@@ -0,0 +1,152 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef TRACE_RTOS_H_
+#define TRACE_RTOS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ----------------------------------------------------------------------------
+
+// Thread safe trace output, selected by one of:
+//
+// - OS_USE_TRACE_TASK_BUFFERS: each task writes into a lock-free ring
+//   of its own (claimed on its first write, from a pool of
+//   OS_INTEGER_TRACE_TASK_BUFFERS, and given back when the task is
+//   deleted, by traceTASK_DELETE()), and the idle task merges the rings,
+//   in the order the writes were made, to the trace device. Writing
+//   takes no lock and never blocks; when a ring is full the output is
+//   dropped, and the count reported. Interrupt handlers, and tasks
+//   left without a ring, share one more ring, written with interrupts
+//   disabled.
+//
+// - OS_USE_TRACE_MUTEX: the writes go directly to the device, under a
+//   recursive, priority inheriting, mutex, so the output is immediate
+//   and a low priority task holding the device does not block a high
+//   priority one for longer than its own write. trace_lock() and
+//   trace_unlock() keep several writes together. Writes from interrupt
+//   handlers are not serialised.
+//
+// Before trace_rtos_init() and before the scheduler starts, the writes
+// go directly to the device.
+
+#if defined(OS_USE_TRACE_TASK_BUFFERS) && defined(OS_USE_TRACE_MUTEX)
+#error "Define only one of OS_USE_TRACE_TASK_BUFFERS and OS_USE_TRACE_MUTEX"
+#endif
+
+#if !defined(OS_INTEGER_TRACE_TASK_BUFFERS)
+#define OS_INTEGER_TRACE_TASK_BUFFERS           (8)
+#endif
+
+// Power of 2.
+#if !defined(OS_INTEGER_TRACE_TASK_BUFFER_SIZE)
+#define OS_INTEGER_TRACE_TASK_BUFFER_SIZE       (256)
+#endif
+
+// The task's thread local storage pointer that caches its ring.
+#if !defined(OS_INTEGER_TRACE_TLS_INDEX)
+#define OS_INTEGER_TRACE_TLS_INDEX              (0)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(TRACE) \
+  && (defined(OS_USE_TRACE_TASK_BUFFERS) || defined(OS_USE_TRACE_MUTEX))
+
+  // Call from main(), before creating the tasks.
+  void
+  trace_rtos_init (void);
+
+#if defined(OS_USE_TRACE_TASK_BUFFERS)
+
+  // Write out the buffered output; called from the idle task only.
+  void
+  trace_rtos_drain (void);
+
+  // Whether there is buffered output not yet written out; can be
+  // called with interrupts disabled.
+  bool
+  trace_rtos_pending (void);
+
+  // Called by traceTASK_DELETE(), in a critical section.
+  void
+  trace_rtos_task_delete (void* task);
+
+#endif
+
+  void
+  trace_lock (void);
+
+  void
+  trace_unlock (void);
+
+#else
+
+  inline void
+  __attribute__((always_inline))
+  trace_rtos_init (void)
+  {
+  }
+
+  inline void
+  __attribute__((always_inline))
+  trace_rtos_drain (void)
+  {
+  }
+
+  inline bool
+  __attribute__((always_inline))
+  trace_rtos_pending (void)
+  {
+    return false;
+  }
+
+  inline void
+  __attribute__((always_inline))
+  trace_lock (void)
+  {
+  }
+
+  inline void
+  __attribute__((always_inline))
+  trace_unlock (void)
+  {
+  }
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(TRACE) && defined(OS_USE_TRACE_TASK_BUFFERS)
+
+// Included at the end of FreeRTOSConfig.h; chained with the
+// freertos_trace.h hook, included first, so it is not redefined later.
+#include "freertos_trace.h"
+
+#undef traceTASK_DELETE
+#if defined(OS_USE_FREERTOS_TRACE)
+#define traceTASK_DELETE(pxTaskToDelete) \
+  do { \
+    freertos_trace_record (FREERTOS_TRACE_TASK_DELETE, \
+        freertos_trace_current_task, \
+        (uint16_t) (pxTaskToDelete)->uxTCBNumber); \
+    trace_rtos_task_delete (pxTaskToDelete); \
+  } while (0)
+#else
+#define traceTASK_DELETE(pxTaskToDelete) \
+  trace_rtos_task_delete (pxTaskToDelete)
+#endif
+
+#endif // defined(TRACE) && defined(OS_USE_TRACE_TASK_BUFFERS)
+
+// ----------------------------------------------------------------------------
+
+#endif // TRACE_RTOS_H_
@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+#
+# This file is part of the GNU ARM Eclipse distribution.
+# Copyright (c) 2014 Liviu Ionescu.
+#
+# Render the binary FreeRTOS trace (see include/freertos_trace.h) as a
+# per task timeline and CPU usage summary.
+#
+# The input is either the file written via semihosting, or, with --itm,
+# a raw SWO capture, from which the software packets of one stimulus
+# port are extracted.
+#
+# Each batch written by the target is followed by a CHECKSUM record,
+# with the CRC-32 of the batch; corrupted batches are reported.
+#
+# Usage:
+#   freertos-trace.py freertos-trace.bin [--clock 168000000] [--width 100]
+#   freertos-trace.py swo.bin --itm [--port 1] [--chrome trace.json]
+#
+
+import argparse
+import json
+import struct
+import sys
+
+TYPES = {
+    1: 'SWITCHED_IN',
+    2: 'SWITCHED_OUT',
+    3: 'TASK_CREATE',
+    4: 'TASK_NAME',
+    5: 'TASK_DELETE',
+    6: 'TASK_DELAY',
+    7: 'QUEUE_SEND',
+    8: 'QUEUE_SEND_FAILED',
+    9: 'QUEUE_RECEIVE',
+    10: 'QUEUE_RECEIVE_FAILED',
+    11: 'QUEUE_SEND_FROM_ISR',
+    12: 'QUEUE_RECEIVE_FROM_ISR',
+    13: 'QUEUE_BLOCK_SEND',
+    14: 'QUEUE_BLOCK_RECEIVE',
+    15: 'ISR_ENTER',
+    16: 'ISR_EXIT',
+    17: 'OVERFLOW',
+    18: 'CHECKSUM',
+}
+
+SWITCHED_IN, SWITCHED_OUT, TASK_NAME, ISR_ENTER, ISR_EXIT, OVERFLOW, \
+    CHECKSUM = 1, 2, 4, 15, 16, 17, 18
+
+
+def crc32_stm32(data, crc=0xFFFFFFFF):
+    """The CRC computed by the STM32 CRC unit (and crc32() on the
+    target): polynomial 0x04C11DB7, not reflected, over little endian
+    words."""
+    for offset in range(0, len(data) - 3, 4):
+        crc ^= struct.unpack_from('<I', data, offset)[0]
+        for _ in range(32):
+            if crc & 0x80000000:
+                crc = ((crc << 1) ^ 0x04C11DB7) & 0xFFFFFFFF
+            else:
+                crc = (crc << 1) & 0xFFFFFFFF
+    return crc
+
+
+def verify(data):
+    """Check the batches against their CHECKSUM records; return the
+    number of batches and the offsets of the corrupted ones."""
+    batches = 0
+    errors = []
+    for offset in range(0, len(data) - 7, 8):
+        timestamp, rtype, task, arg = struct.unpack_from('<IBBH', data,
+                                                         offset)
+        if rtype != CHECKSUM:
+            continue
+        batches += 1
+        start = offset - 8 * arg
+        if start < 0 or crc32_stm32(data[start:offset]) != timestamp:
+            errors.append(offset)
+    return batches, errors
+
+
+def itm_extract(data, port):
+    """Return the payload of the software packets sent to one port."""
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        header = data[i]
+        i += 1
+        size = header & 0x03
+        if size == 0:
+            # Protocol packets: sync, overflow, timestamps, extension.
+            if header in (0x00, 0x70):
+                continue
+            if header & 0x80:
+                while i < n and data[i] & 0x80:
+                    i += 1
+                i += 1
+            continue
+        length = {1: 1, 2: 2, 3: 4}[size]
+        if (header & 0x04) == 0 and (header >> 3) == port:
+            out += data[i:i + length]
+        i += length
+    return bytes(out)
+
+
+def parse(data):
+    """Yield (timestamp, type, task, arg), with the timestamp unwrapped
+    to 64-bits; name records are returned with their raw field."""
+    high = 0
+    last = None
+    for offset in range(0, len(data) - 7, 8):
+        timestamp, rtype, task, arg = struct.unpack_from('<IBBH', data,
+                                                         offset)
+        if rtype == CHECKSUM:
+            continue
+        if rtype == TASK_NAME:
+            yield timestamp, rtype, task, arg
+            continue
+        if last is not None and timestamp < last:
+            high += 1 << 32
+        last = timestamp
+        yield high + timestamp, rtype, task, arg
+
+
+def build(records):
+    names = {}
+    segments = []  # (task, start, end)
+    isrs = []  # (irq, start, end)
+    overflows = []
+    running = None
+    isr_stack = []
+    first = last = None
+
+    for timestamp, rtype, task, arg in records:
+        if rtype == TASK_NAME:
+            chars = struct.pack('<I', timestamp).split(b'\0')[0]
+            names[task] = names.get(task, '')[:arg] + chars.decode(
+                'ascii', 'replace')
+            continue
+
+        if first is None:
+            first = timestamp
+        last = timestamp
+
+        if rtype == SWITCHED_IN:
+            running = (task, timestamp)
+        elif rtype == SWITCHED_OUT:
+            if running is not None and running[0] == task:
+                segments.append((task, running[1], timestamp))
+            running = None
+        elif rtype == ISR_ENTER:
+            isr_stack.append((arg, timestamp))
+        elif rtype == ISR_EXIT:
+            if isr_stack:
+                irq, start = isr_stack.pop()
+                isrs.append((irq, start, timestamp))
+        elif rtype == OVERFLOW:
+            overflows.append((timestamp, arg))
+
+    if running is not None and last is not None:
+        segments.append((running[0], running[1], last))
+
+    return names, segments, isrs, overflows, first, last
+
+
+def render_text(names, segments, isrs, overflows, first, last, clock,
+                width):
+    span = max(last - first, 1)
+    tasks = sorted(set(s[0] for s in segments))
+
+    print('Duration: %.3f ms, %d task(s), %d switch(es)'
+          % (span * 1000.0 / clock, len(tasks), len(segments)))
+    for timestamp, count in overflows:
+        print('Overflow at %.3f ms, %d record(s) lost'
+              % ((timestamp - first) * 1000.0 / clock, count))
+    print()
+
+    busy = {}
+    for task, start, end in segments:
+        busy[task] = busy.get(task, 0) + (end - start)
+
+    label = max([len(names.get(t, str(t))) for t in tasks] + [4])
+    for task in tasks:
+        line = [' '] * width
+        for t, start, end in segments:
+            if t != task:
+                continue
+            a = (start - first) * width // span
+            b = max((end - first) * width // span, a + 1)
+            for col in range(a, min(b, width)):
+                line[col] = '#'
+        print('%-*s |%s| %5.1f%%' % (label, names.get(task, str(task)),
+                                     ''.join(line),
+                                     busy[task] * 100.0 / span))
+
+    if isrs:
+        line = [' '] * width
+        for irq, start, end in isrs:
+            col = min((start - first) * width // span, width - 1)
+            line[col] = '|'
+        isr_time = sum(end - start for _, start, end in isrs)
+        print('%-*s |%s| %5.1f%%' % (label, 'ISRs', ''.join(line),
+                                     isr_time * 100.0 / span))
+
+
+def render_chrome(path, names, segments, isrs, first, clock):
+    events = []
+    us = 1e6 / clock
+    for task, start, end in segments:
+        events.append({
+            'name': names.get(task, str(task)),
+            'ph': 'X',
+            'pid': 1,
+            'tid': task,
+            'ts': (start - first) * us,
+            'dur': (end - start) * us,
+        })
+    for irq, start, end in isrs:
+        events.append({
+            'name': 'IRQ %d' % irq,
+            'ph': 'X',
+            'pid': 1,
+            'tid': 0,
+            'ts': (start - first) * us,
+            'dur': (end - start) * us,
+        })
+    for task, name in names.items():
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': 1,
+                       'tid': task, 'args': {'name': name}})
+    with open(path, 'w') as f:
+        json.dump({'traceEvents': events}, f)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Render a FreeRTOS binary trace as a task timeline.')
+    parser.add_argument('file', help='semihosting trace file or SWO capture')
+    parser.add_argument('--itm', action='store_true',
+                        help='the input is a raw SWO (ITM) capture')
+    parser.add_argument('--port', type=int, default=1,
+                        help='ITM stimulus port (default 1)')
+    parser.add_argument('--clock', type=int, default=168000000,
+                        help='DWT CYCCNT frequency in Hz')
+    parser.add_argument('--width', type=int, default=100,
+                        help='timeline width in columns')
+    parser.add_argument('--chrome', metavar='JSON',
+                        help='also write a chrome://tracing file')
+    parser.add_argument('--dump', action='store_true',
+                        help='print the decoded records')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        data = f.read()
+    if args.itm:
+        data = itm_extract(data, args.port)
+
+    batches, errors = verify(data)
+    for offset in errors:
+        print('Checksum error in the batch ending at offset %d' % offset)
+    if batches == 0:
+        print('No checksums.')
+
+    records = list(parse(data))
+    if args.dump:
+        for timestamp, rtype, task, arg in records:
+            print('%12d %-24s %3d 0x%04x'
+                  % (timestamp, TYPES.get(rtype, str(rtype)), task, arg))
+
+    names, segments, isrs, overflows, first, last = build(records)
+    if first is None:
+        print('No records.')
+        return 1
+
+    render_text(names, segments, isrs, overflows, first, last, args.clock,
+                args.width)
+    if args.chrome:
+        render_chrome(args.chrome, names, segments, isrs, first, args.clock)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
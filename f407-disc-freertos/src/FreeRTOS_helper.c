@@ -7,12 +7,18 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "freertos_trace.h"
+#include "trace_rtos.h"
+#include "freertos_stack.h"
 
 #if defined(USE_HAL_DRIVER)
 #if defined(STM32F407xx)
 #include "stm32f4xx_hal.h"
 #else
 extern void HAL_IncTick(void);
+extern uint32_t HAL_GetTick(void);
+extern void HAL_Delay(uint32_t Delay);
+#include "cmsis_device.h"
 #endif
 #endif
 
@@ -24,37 +30,159 @@ extern void HAL_IncTick(void);
 
 /**
  * This handler has dual use, first by HAL which uses it for
- * timings, and then by FreeRTOS, for scheduling. The extra test
- * for schedule state is mandatory, otherwise the TickHandler
- * hang if called before starting the scheduler.
+ * timings, and then by FreeRTOS, for scheduling. Once the
+ * scheduler is started, the HAL tick is no longer incremented
+ * here, but derived from the kernel tick count, which is also
+ * correct after tickless idle periods.
  */
 void __attribute__ ((section(".after_vectors")))
 SysTick_Handler (void)
 {
-#if defined(USE_HAL_DRIVER)
-  HAL_IncTick ();
+#if defined(OS_USE_FREERTOS_TRACE)
+  freertos_trace_isr_enter ();
 #endif
 
-  if (xTaskGetSchedulerState () != taskSCHEDULER_NOT_STARTED)
+  if (xTaskGetSchedulerState () == taskSCHEDULER_NOT_STARTED)
+    {
+#if defined(USE_HAL_DRIVER)
+      HAL_IncTick ();
+#endif
+    }
+#if !defined(OS_USE_FREERTOS_TICKLESS_TIMER)
+  else
     {
       xPortSysTickHandler ();
     }
+#endif
+
+#if defined(OS_USE_FREERTOS_TRACE)
+  freertos_trace_isr_exit ();
+#endif
+}
+
+#if defined(USE_HAL_DRIVER)
+
+// The milliseconds counted by SysTick before the scheduler started.
+static volatile uint32_t hal_ticks;
+
+/**
+ * Replaces the HAL weak definition; called by SysTick_Handler()
+ * only while the scheduler is not started.
+ */
+void
+HAL_IncTick (void)
+{
+  hal_ticks++;
+}
+
+/**
+ * Replaces the HAL weak definition; afterwards, the HAL tick
+ * continues from the kernel tick count, in milliseconds.
+ */
+uint32_t
+HAL_GetTick (void)
+{
+  if (xTaskGetSchedulerState () == taskSCHEDULER_NOT_STARTED)
+    {
+      return hal_ticks;
+    }
+
+  // Also safe in interrupt handlers.
+  TickType_t ticks = xTaskGetTickCountFromISR ();
+  if (configTICK_RATE_HZ == 1000)
+    {
+      return hal_ticks + ticks;
+    }
+  return hal_ticks + (uint32_t) ((uint64_t) ticks * 1000 / configTICK_RATE_HZ);
+}
+
+/**
+ * Replaces the HAL weak definition, which busy waits. Once the
+ * scheduler is running, a task calling it is blocked, and the time
+ * goes to the other tasks or to the (tickless) idle; before the
+ * scheduler starts, the core sleeps between the ticks.
+ *
+ * With the scheduler suspended, or in an interrupt handler, the
+ * kernel tick count does not advance, so it busy waits on the DWT
+ * cycle counter instead.
+ */
+void
+HAL_Delay (uint32_t Delay)
+{
+  BaseType_t state = xTaskGetSchedulerState ();
+  if (state == taskSCHEDULER_RUNNING && __get_IPSR () == 0)
+    {
+      // Rounded up, plus the tick already started.
+      vTaskDelay (
+          (TickType_t) (((uint64_t) Delay * configTICK_RATE_HZ + 999) / 1000)
+              + 1);
+      return;
+    }
+
+  if (state != taskSCHEDULER_NOT_STARTED || __get_IPSR () != 0)
+    {
+      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+      DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+      // One millisecond at a time, so the 32-bit counter never wraps
+      // within a wait.
+      uint32_t cycles = SystemCoreClock / 1000;
+      for (; Delay != 0; --Delay)
+        {
+          uint32_t begin = DWT->CYCCNT;
+          while ((DWT->CYCCNT - begin) < cycles)
+            ;
+        }
+      return;
+    }
+
+  uint32_t start = HAL_GetTick ();
+  while ((HAL_GetTick () - start) < Delay)
+    {
+      __WFI ();
+    }
+}
+
+#endif
+
+#if (configUSE_IDLE_HOOK == 1)
+
+/**
+ * Called on each iteration of the idle task; write out the
+ * trace records and the trace output buffered so far.
+ */
+void
+vApplicationIdleHook (void)
+{
+#if defined(OS_USE_FREERTOS_TRACE)
+  freertos_trace_drain ();
+#endif
+#if defined(OS_USE_TRACE_TASK_BUFFERS)
+  trace_rtos_drain ();
+#endif
 }
 
+#endif
+
 /**
  *  This function will get called if a task overflows its stack.   If the
  * parameters are corrupt then inspect pxCurrentTCB to find which was the
- * offending task.
+ * offending task. With the stack profile, the task name and its stack
+ * history are printed, and the system is reset.
  */
 void
 vApplicationStackOverflowHook (TaskHandle_t pxTask, char *pcTaskName)
 {
+#if defined(OS_USE_FREERTOS_STACK_PROFILE)
+  freertos_stack_overflow (pxTask, pcTaskName);
+#else
 
   (void) pxTask;
   (void) pcTaskName;
 
   for (;;)
     ;
+#endif
 }
 
 #if defined(USE_FULL_ASSERT)
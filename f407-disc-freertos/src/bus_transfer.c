@@ -0,0 +1,94 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "bus_transfer.h"
+
+// ----------------------------------------------------------------------------
+
+void
+bus_transfer_prepare (bus_transfer_t* transfer, uint16_t device,
+                      const void* tx, size_t tx_length, void* rx,
+                      size_t rx_length, bus_callback_t callback, void* arg)
+{
+  configASSERT(tx_length <= 0xFFFF && rx_length <= 0xFFFF);
+
+  transfer->next = NULL;
+  transfer->tx = tx;
+  transfer->rx = rx;
+  transfer->tx_length = (uint16_t) tx_length;
+  transfer->rx_length = (uint16_t) rx_length;
+  transfer->device = device;
+  transfer->reading = (tx_length == 0);
+  transfer->callback = callback;
+  transfer->arg = arg;
+  transfer->task = NULL;
+  if (callback == NULL
+      && xTaskGetSchedulerState () != taskSCHEDULER_NOT_STARTED)
+    {
+      transfer->task = xTaskGetCurrentTaskHandle ();
+    }
+  transfer->state = BUS_TRANSFER_PENDING;
+}
+
+void
+bus_transfer_finish (bus_transfer_t* transfer, uint8_t state,
+                     BaseType_t* woken)
+{
+  transfer->state = state;
+  if (transfer->callback != NULL)
+    {
+      transfer->callback (transfer, transfer->arg);
+    }
+  else if (transfer->task != NULL)
+    {
+      vTaskNotifyGiveFromISR (transfer->task, woken);
+    }
+}
+
+int
+bus_transfer_wait (const bus_transfer_t* transfer, TickType_t timeout)
+{
+  if (transfer->task == NULL)
+    {
+      // Submitted before the scheduler started.
+      while (transfer->state == BUS_TRANSFER_PENDING)
+        ;
+      return transfer->state;
+    }
+
+  TimeOut_t start;
+  vTaskSetTimeOutState (&start);
+
+  // Other notifications may wake the task early; check the state.
+  while (transfer->state == BUS_TRANSFER_PENDING)
+    {
+      if (xTaskCheckForTimeOut (&start, &timeout) == pdTRUE)
+        {
+          break;
+        }
+      ulTaskNotifyTake (pdTRUE, timeout);
+    }
+  return transfer->state;
+}
+
+void
+bus_transfer_unlink (bus_transfer_t* head, bus_transfer_t** tail,
+                     bus_transfer_t* transfer)
+{
+  for (bus_transfer_t* p = head; p != NULL; p = p->next)
+    {
+      if (p->next == transfer)
+        {
+          p->next = transfer->next;
+          if (*tail == transfer)
+            {
+              *tail = p;
+            }
+          return;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,403 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "button_benchmark.h"
+#include "button_task.h"
+#include "BlinkLed.h"
+#include "rtos.h"
+#include "diag/Trace.h"
+
+#if defined(OS_BENCHMARK_BUTTON)
+
+#if (configGENERATE_RUN_TIME_STATS == 0)
+#error "The button benchmark needs configGENERATE_RUN_TIME_STATS"
+#endif
+
+// ----------------------------------------------------------------------------
+
+#if !defined(BOARD_OLIMEX_STM32_E407)
+// The red led.
+#define BENCHMARK_LED_PORT_NUMBER       (3)
+#define BENCHMARK_LED_PIN_NUMBER        (14)
+#endif
+
+// EXTI1 has no pin configured; it is pended by software only.
+#define BENCHMARK_EXTI_LINE             (1u << 1)
+
+#define PRESSED_BIT                     (1u << 0)
+#define RELEASED_BIT                    (1u << 1)
+#define STOP_BIT                        (1u << 2)
+
+namespace
+{
+  enum mode_t
+  {
+    MODE_POLL, MODE_IRQ, MODE_EVENT_GROUP, MODE_NOTIFICATION
+  };
+
+  const char* const mode_names[] =
+    { "poll", "irq", "event group", "notification" };
+
+  volatile mode_t mode;
+  volatile uint32_t running;
+
+  // The simulated pin, and the state last acted upon.
+  volatile uint32_t pin;
+  volatile uint32_t reported;
+
+  // Set by the stimulus, cleared by the first LED update after it.
+  volatile uint32_t stimulus_stamp;
+  volatile uint32_t stimulus_pending;
+
+  volatile uint32_t isr_cycles;
+  uint32_t irq_accepted_stamp;
+
+  struct
+  {
+    uint32_t min;
+    uint32_t max;
+    uint32_t count;
+    uint64_t sum;
+  } latency;
+
+  TaskHandle_t handler_handle;
+  rtos::event_group* events;
+  rtos::timer* debounce_timer;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  StackType_t handler_stack[configMINIMAL_STACK_SIZE];
+  StaticTask_t handler_buffer;
+  StackType_t stimulus_stack[configMINIMAL_STACK_SIZE];
+  StaticTask_t stimulus_buffer;
+#endif
+
+  uint32_t
+  xorshift32 (uint32_t* state)
+  {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+  }
+
+  void
+  led_write (uint32_t on)
+  {
+#if defined(BENCHMARK_LED_PORT_NUMBER)
+    BLINK_GPIOx(BENCHMARK_LED_PORT_NUMBER)->BSRR =
+        on ? BLINK_PIN_MASK(BENCHMARK_LED_PIN_NUMBER) :
+            (BLINK_PIN_MASK(BENCHMARK_LED_PIN_NUMBER) << 16);
+#else
+    (void) on;
+#endif
+
+    if (stimulus_pending)
+      {
+        uint32_t delta = DWT->CYCCNT - stimulus_stamp;
+        stimulus_pending = 0;
+
+        if (delta < latency.min)
+          {
+            latency.min = delta;
+          }
+        if (delta > latency.max)
+          {
+            latency.max = delta;
+          }
+        latency.sum += delta;
+        latency.count++;
+      }
+  }
+
+  // Runs in the timer service task; the same as in button_task.cpp.
+  void
+  debounce_callback (TimerHandle_t handle __attribute__((unused)))
+  {
+    uint32_t state = pin;
+    if (state != reported)
+      {
+        reported = state;
+        if (mode == MODE_EVENT_GROUP)
+          {
+            events->set (state ? PRESSED_BIT : RELEASED_BIT);
+          }
+        else
+          {
+            xTaskNotify(handler_handle, state ? PRESSED_BIT : RELEASED_BIT,
+                        eSetBits);
+          }
+      }
+
+    EXTI->PR = BENCHMARK_EXTI_LINE;
+    EXTI->IMR |= BENCHMARK_EXTI_LINE;
+  }
+
+  void
+  handler_task_function (void* parms __attribute__((unused)))
+  {
+    while (running)
+      {
+        if (mode == MODE_POLL)
+          {
+            vTaskDelay (OS_INTEGER_BENCHMARK_BUTTON_POLL_TICKS);
+            uint32_t state = pin;
+            if (state != reported)
+              {
+                reported = state;
+                led_write (state);
+              }
+          }
+        else
+          {
+            uint32_t bits;
+            if (mode == MODE_EVENT_GROUP)
+              {
+                bits = events->wait_any (PRESSED_BIT | RELEASED_BIT | STOP_BIT);
+              }
+            else
+              {
+                xTaskNotifyWait (0, 0xFFFFFFFF, &bits, portMAX_DELAY);
+              }
+
+            if (bits & (PRESSED_BIT | RELEASED_BIT))
+              {
+                led_write ((bits & PRESSED_BIT) != 0);
+              }
+          }
+      }
+
+    handler_handle = NULL;
+    vTaskDelete (NULL);
+  }
+
+  uint32_t
+  run_time (TaskHandle_t handle)
+  {
+    static TaskStatus_t status[16];
+
+    UBaseType_t count = uxTaskGetSystemState (
+        status, sizeof(status) / sizeof(status[0]), NULL);
+    for (UBaseType_t i = 0; i < count; ++i)
+      {
+        if (status[i].xHandle == handle)
+          {
+            return status[i].ulRunTimeCounter;
+          }
+      }
+    return 0;
+  }
+
+  void
+  run_mode (mode_t m, UBaseType_t priority)
+  {
+    uint32_t seed = 0x2545F491;
+
+    mode = m;
+    running = 1;
+    pin = 0;
+    reported = 0;
+    stimulus_pending = 0;
+    isr_cycles = 0;
+    irq_accepted_stamp = DWT->CYCCNT;
+    latency.min = 0xFFFFFFFF;
+    latency.max = 0;
+    latency.count = 0;
+    latency.sum = 0;
+
+    if (m != MODE_IRQ)
+      {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+        handler_handle = xTaskCreateStatic (handler_task_function, "bhandler",
+                                            configMINIMAL_STACK_SIZE, NULL,
+                                            priority - 1, handler_stack,
+                                            &handler_buffer);
+#else
+        xTaskCreate(handler_task_function, "bhandler",
+                    configMINIMAL_STACK_SIZE, NULL, priority - 1,
+                    &handler_handle);
+#endif
+      }
+
+    TaskHandle_t daemon = xTimerGetTimerDaemonTaskHandle ();
+    uint32_t daemon_begin = run_time (daemon);
+    uint32_t begin = DWT->CYCCNT;
+
+    for (uint32_t i = 0; i < OS_INTEGER_BENCHMARK_BUTTON_EDGES; ++i)
+      {
+        // Longer than the poll period and the debounce time, so no
+        // edge can be missed by design.
+        vTaskDelay (
+            50 * configTICK_RATE_HZ / 1000
+                + xorshift32 (&seed) % (50 * configTICK_RATE_HZ / 1000));
+
+        pin = !pin;
+        stimulus_stamp = DWT->CYCCNT;
+        stimulus_pending = 1;
+        if (m != MODE_POLL)
+          {
+            EXTI->SWIER = BENCHMARK_EXTI_LINE;
+          }
+      }
+    vTaskDelay (2 * OS_INTEGER_BENCHMARK_BUTTON_POLL_TICKS);
+
+    uint32_t elapsed = DWT->CYCCNT - begin;
+    uint64_t busy = isr_cycles;
+    busy += (uint64_t) (run_time (daemon) - daemon_begin)
+        << OS_INTEGER_RUN_TIME_STATS_SHIFT;
+    if (handler_handle != NULL)
+      {
+        busy += (uint64_t) run_time (handler_handle)
+            << OS_INTEGER_RUN_TIME_STATS_SHIFT;
+      }
+
+    running = 0;
+    if (m == MODE_EVENT_GROUP)
+      {
+        events->set (STOP_BIT);
+      }
+    else if (m == MODE_NOTIFICATION)
+      {
+        xTaskNotify(handler_handle, STOP_BIT, eSetBits);
+      }
+    // Let the handler exit and the idle task free it.
+    vTaskDelay (OS_INTEGER_BENCHMARK_BUTTON_POLL_TICKS + 2);
+
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t per10k = (uint32_t) (busy * 10000 / elapsed);
+    if (latency.count == 0)
+      {
+        trace_printf ("%-12s no events\n", mode_names[m]);
+      }
+    else
+      {
+        trace_printf ("%-12s latency %u/%u/%u us, %u missed, cpu %u.%02u%%\n",
+                      mode_names[m], latency.min / cycles_per_us,
+                      (uint32_t) (latency.sum / latency.count) / cycles_per_us,
+                      latency.max / cycles_per_us,
+                      OS_INTEGER_BENCHMARK_BUTTON_EDGES - latency.count,
+                      per10k / 100, per10k % 100);
+      }
+  }
+
+  void
+  stimulus_task_function (void* parms)
+  {
+    UBaseType_t priority = (UBaseType_t) parms;
+
+    static rtos::event_group benchmark_events;
+    static rtos::timer benchmark_debounce_timer ("bdebounce",
+                                                 BUTTON_DEBOUNCE_TICKS, false,
+                                                 debounce_callback);
+    events = &benchmark_events;
+    debounce_timer = &benchmark_debounce_timer;
+
+#if defined(BENCHMARK_LED_PORT_NUMBER)
+    RCC->AHB1ENR |= BLINK_RCC_MASKx(BENCHMARK_LED_PORT_NUMBER);
+
+    GPIO_InitTypeDef GPIO_InitStructure;
+    GPIO_InitStructure.Pin = BLINK_PIN_MASK(BENCHMARK_LED_PIN_NUMBER);
+    GPIO_InitStructure.Mode = GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStructure.Speed = GPIO_SPEED_FAST;
+    GPIO_InitStructure.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init (BLINK_GPIOx(BENCHMARK_LED_PORT_NUMBER), &GPIO_InitStructure);
+#endif
+
+    EXTI->PR = BENCHMARK_EXTI_LINE;
+    EXTI->IMR |= BENCHMARK_EXTI_LINE;
+    NVIC_SetPriority (
+        EXTI1_IRQn,
+        (configMAX_SYSCALL_INTERRUPT_PRIORITY >> (8 - __NVIC_PRIO_BITS)) + 1);
+    NVIC_EnableIRQ (EXTI1_IRQn);
+
+    trace_printf ("Button, %u edges, poll every %u ticks\n",
+                  OS_INTEGER_BENCHMARK_BUTTON_EDGES,
+                  OS_INTEGER_BENCHMARK_BUTTON_POLL_TICKS);
+
+    run_mode (MODE_POLL, priority);
+    run_mode (MODE_IRQ, priority);
+    run_mode (MODE_EVENT_GROUP, priority);
+    run_mode (MODE_NOTIFICATION, priority);
+
+    NVIC_DisableIRQ (EXTI1_IRQn);
+    EXTI->IMR &= ~BENCHMARK_EXTI_LINE;
+
+    vTaskDelete (NULL);
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+extern "C" void
+EXTI1_IRQHandler (void);
+
+void
+EXTI1_IRQHandler (void)
+{
+  uint32_t begin = DWT->CYCCNT;
+  BaseType_t woken = pdFALSE;
+
+  if (mode == MODE_IRQ)
+    {
+      EXTI->PR = BENCHMARK_EXTI_LINE;
+
+      // Debounce by time, as f407-disc-birq does.
+      if (begin - irq_accepted_stamp
+          >= (SystemCoreClock / configTICK_RATE_HZ) * BUTTON_DEBOUNCE_TICKS)
+        {
+          uint32_t state = pin;
+          if (state != reported)
+            {
+              irq_accepted_stamp = begin;
+              reported = state;
+              led_write (state);
+            }
+        }
+    }
+  else
+    {
+      EXTI->IMR &= ~BENCHMARK_EXTI_LINE;
+      EXTI->PR = BENCHMARK_EXTI_LINE;
+
+      uint32_t state = pin;
+      if (state != reported)
+        {
+          reported = state;
+          if (mode == MODE_EVENT_GROUP)
+            {
+              events->set_from_isr (state ? PRESSED_BIT : RELEASED_BIT,
+                                    &woken);
+            }
+          else
+            {
+              xTaskNotifyFromISR(handler_handle,
+                                 state ? PRESSED_BIT : RELEASED_BIT, eSetBits,
+                                 &woken);
+            }
+        }
+      debounce_timer->start_from_isr (&woken);
+    }
+
+  isr_cycles += DWT->CYCCNT - begin;
+  portYIELD_FROM_ISR(woken);
+}
+
+void
+button_benchmark_start (UBaseType_t priority)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (stimulus_task_function, "bstimulus",
+                     configMINIMAL_STACK_SIZE, (void*) priority, priority,
+                     stimulus_stack, &stimulus_buffer);
+#else
+  xTaskCreate(stimulus_task_function, "bstimulus", configMINIMAL_STACK_SIZE,
+              (void*) priority, priority, NULL);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(OS_BENCHMARK_BUTTON)
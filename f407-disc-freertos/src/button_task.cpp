@@ -0,0 +1,167 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "button_task.h"
+#include "BlinkLed.h"
+#include "rtos.h"
+#include "diag/Trace.h"
+
+// ----------------------------------------------------------------------------
+
+#if !defined(BOARD_OLIMEX_STM32_E407)
+#define BUTTON_LED_PORT_NUMBER          (3)
+#define BUTTON_LED_PIN_NUMBER           (13)
+#endif
+
+#define BUTTON_PRESSED_BIT              (1u << 0)
+#define BUTTON_RELEASED_BIT             (1u << 1)
+
+namespace
+{
+  // Constructed by button_task_start(), after the heap is ready.
+  rtos::event_group* events;
+  rtos::timer* debounce_timer;
+  rtos::timer* led_timer;
+
+  // The state last reported to the task.
+  volatile uint32_t reported;
+
+  inline uint32_t
+  __attribute__((always_inline))
+  button_read (void)
+  {
+    return (BLINK_GPIOx(BUTTON_PORT_NUMBER)->IDR
+        & BLINK_PIN_MASK(BUTTON_PIN_NUMBER)) != 0;
+  }
+
+  void
+  led_set (bool on)
+  {
+#if defined(BUTTON_LED_PORT_NUMBER)
+    HAL_GPIO_WritePin (BLINK_GPIOx(BUTTON_LED_PORT_NUMBER),
+                       BLINK_PIN_MASK(BUTTON_LED_PIN_NUMBER),
+                       on ? GPIO_PIN_SET : GPIO_PIN_RESET);
+#else
+    (void) on;
+#endif
+  }
+
+  void
+  led_off_callback (TimerHandle_t handle __attribute__((unused)))
+  {
+    led_set (false);
+  }
+
+  // Runs in the timer service task, BUTTON_DEBOUNCE_TICKS after the
+  // first edge.
+  void
+  debounce_callback (TimerHandle_t handle __attribute__((unused)))
+  {
+    uint32_t state = button_read ();
+    if (state != reported)
+      {
+        reported = state;
+        events->set (state ? BUTTON_PRESSED_BIT : BUTTON_RELEASED_BIT);
+      }
+
+    EXTI->PR = BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+    EXTI->IMR |= BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+  }
+
+  void
+  button_task_function (void* parms __attribute__((unused)))
+  {
+    uint32_t count = 0;
+
+    for (;;)
+      {
+        EventBits_t bits = events->wait_any (
+            BUTTON_PRESSED_BIT | BUTTON_RELEASED_BIT);
+
+        if (bits & BUTTON_PRESSED_BIT)
+          {
+            ++count;
+            led_set (true);
+            led_timer->reset ();
+            trace_printf ("Button %u\n", count);
+          }
+      }
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+void
+button_task_start (UBaseType_t priority)
+{
+  static rtos::event_group button_events;
+  static rtos::timer button_debounce_timer ("debounce", BUTTON_DEBOUNCE_TICKS,
+                                            false, debounce_callback);
+  static rtos::timer button_led_timer ("led", BUTTON_LED_ON_TICKS, false,
+                                       led_off_callback);
+  static rtos::task<configMINIMAL_STACK_SIZE> task (button_task_function,
+                                                    "button", NULL, priority);
+
+  events = &button_events;
+  debounce_timer = &button_debounce_timer;
+  led_timer = &button_led_timer;
+
+  GPIO_InitTypeDef GPIO_InitStructure;
+
+#if defined(BUTTON_LED_PORT_NUMBER)
+  RCC->AHB1ENR |= BLINK_RCC_MASKx(BUTTON_LED_PORT_NUMBER);
+
+  GPIO_InitStructure.Pin = BLINK_PIN_MASK(BUTTON_LED_PIN_NUMBER);
+  GPIO_InitStructure.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStructure.Speed = GPIO_SPEED_FAST;
+  GPIO_InitStructure.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init (BLINK_GPIOx(BUTTON_LED_PORT_NUMBER), &GPIO_InitStructure);
+  led_set (false);
+#endif
+
+  RCC->AHB1ENR |= BLINK_RCC_MASKx(BUTTON_PORT_NUMBER);
+
+  // Both edges, so the task sees the release too.
+  GPIO_InitStructure.Pin = BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+  GPIO_InitStructure.Mode = GPIO_MODE_IT_RISING_FALLING;
+  GPIO_InitStructure.Speed = GPIO_SPEED_FAST;
+  GPIO_InitStructure.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init (BLINK_GPIOx(BUTTON_PORT_NUMBER), &GPIO_InitStructure);
+
+  reported = button_read ();
+
+  // Below configMAX_SYSCALL_INTERRUPT_PRIORITY, so it may use the
+  // FromISR() API.
+  NVIC_SetPriority (
+      EXTI0_IRQn,
+      (configMAX_SYSCALL_INTERRUPT_PRIORITY >> (8 - __NVIC_PRIO_BITS)) + 1);
+  NVIC_EnableIRQ (EXTI0_IRQn);
+}
+
+extern "C" void
+EXTI0_IRQHandler (void);
+
+void
+EXTI0_IRQHandler (void)
+{
+  BaseType_t woken = pdFALSE;
+
+  // Ignore the bounces until the debounce timer fires.
+  EXTI->IMR &= ~BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+  EXTI->PR = BLINK_PIN_MASK(BUTTON_PIN_NUMBER);
+
+  uint32_t state = button_read ();
+  if (state != reported)
+    {
+      reported = state;
+      events->set_from_isr (state ? BUTTON_PRESSED_BIT : BUTTON_RELEASED_BIT,
+                            &woken);
+    }
+  debounce_timer->start_from_isr (&woken);
+
+  portYIELD_FROM_ISR(woken);
+}
+
+// ----------------------------------------------------------------------------
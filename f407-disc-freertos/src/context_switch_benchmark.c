@@ -0,0 +1,167 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "context_switch_benchmark.h"
+#include "freertos_static.h"
+#include "task.h"
+#include "diag/Trace.h"
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+#define WORKER_USES_FPU         (0x100)
+
+typedef struct
+{
+  uint32_t min;
+  uint32_t max;
+  uint32_t count;
+  uint64_t sum;
+} switch_stats_t;
+
+static switch_stats_t stats;
+
+// The cycle counter just before the last yield, and the worker that
+// took it; a sample is recorded only when another worker resumes.
+static volatile uint32_t yield_stamp;
+static volatile uint32_t yield_owner;
+
+// Keeps the floating point code from being optimised out.
+static volatile float fpu_sink;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+// Reused by all cases; the workers of the previous case were already
+// deleted by the idle task when the next one starts.
+static StackType_t worker_stacks[2][configMINIMAL_STACK_SIZE];
+static StaticTask_t worker_buffers[2];
+static StackType_t benchmark_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t benchmark_buffer;
+#endif
+
+// ----------------------------------------------------------------------------
+
+static void
+worker_task_function (void* parms)
+{
+  uint32_t id = (uint32_t) parms;
+  float acc = (float) (id & 0xFF);
+
+  while (stats.count < OS_INTEGER_BENCHMARK_CONTEXT_SWITCH_ITERATIONS)
+    {
+      if (id & WORKER_USES_FPU)
+        {
+          // Keep some live FPU state across the switch, so the task
+          // has CONTROL.FPCA set when it yields.
+          acc = acc * 1.0001f + 0.5f;
+          fpu_sink = acc;
+        }
+
+      uint32_t now = DWT->CYCCNT;
+      if (yield_owner != 0 && yield_owner != id)
+        {
+          uint32_t delta = now - yield_stamp;
+          if (delta < stats.min)
+            {
+              stats.min = delta;
+            }
+          if (delta > stats.max)
+            {
+              stats.max = delta;
+            }
+          stats.sum += delta;
+          stats.count++;
+        }
+
+      yield_owner = id;
+      yield_stamp = DWT->CYCCNT;
+      taskYIELD();
+    }
+
+  vTaskDelete (NULL);
+}
+
+static void
+run_case (const char* name, uint32_t id1, uint32_t id2,
+          UBaseType_t priority)
+{
+  stats.min = 0xFFFFFFFF;
+  stats.max = 0;
+  stats.count = 0;
+  stats.sum = 0;
+  yield_owner = 0;
+
+  // Both workers must exist before the first one starts yielding;
+  // once the scheduler is resumed, this task is preempted until both
+  // workers are done and deleted.
+  vTaskSuspendAll ();
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (worker_task_function, "cs1", configMINIMAL_STACK_SIZE,
+                     (void*) id1, priority, worker_stacks[0],
+                     &worker_buffers[0]);
+  xTaskCreateStatic (worker_task_function, "cs2", configMINIMAL_STACK_SIZE,
+                     (void*) id2, priority, worker_stacks[1],
+                     &worker_buffers[1]);
+#else
+  xTaskCreate(worker_task_function, "cs1", configMINIMAL_STACK_SIZE,
+              (void*) id1, priority, NULL);
+  xTaskCreate(worker_task_function, "cs2", configMINIMAL_STACK_SIZE,
+              (void*) id2, priority, NULL);
+#endif
+  xTaskResumeAll ();
+
+  if (stats.count == 0)
+    {
+      trace_printf ("%s: no samples\n", name);
+    }
+  else
+    {
+      trace_printf ("%s: min %u, avg %u, max %u cycles\n", name, stats.min,
+                    (uint32_t) (stats.sum / stats.count), stats.max);
+    }
+
+  // Let the idle task free the worker stacks.
+  vTaskDelay (2);
+}
+
+static void
+context_switch_benchmark_task_function (void* parms)
+{
+  UBaseType_t priority = (UBaseType_t) parms;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#if (__FPU_USED == 1)
+  trace_printf ("Context switch, hard float, FPCCR.ASPEN=%u LSPEN=%u\n",
+                (FPU->FPCCR & FPU_FPCCR_ASPEN_Msk) != 0,
+                (FPU->FPCCR & FPU_FPCCR_LSPEN_Msk) != 0);
+#else
+  trace_printf ("Context switch, soft float\n");
+#endif
+
+  run_case ("int/int", 1, 2, priority);
+  run_case ("int/fpu", 1, 2 | WORKER_USES_FPU, priority);
+  run_case ("fpu/fpu", 1 | WORKER_USES_FPU, 2 | WORKER_USES_FPU, priority);
+
+  vTaskDelete (NULL);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+context_switch_benchmark_start (UBaseType_t priority)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (context_switch_benchmark_task_function, "csbench",
+                     configMINIMAL_STACK_SIZE, (void*) (priority + 1),
+                     priority, benchmark_stack, &benchmark_buffer);
+#else
+  xTaskCreate(context_switch_benchmark_task_function, "csbench",
+              configMINIMAL_STACK_SIZE, (void*) (priority + 1), priority,
+              NULL);
+#endif
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,337 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "crc32.h"
+#include "cmsis_device.h"
+
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+
+#define CRC32_POLYNOMIAL        (0x04C11DB7u)
+
+// The CRC of the word 0x12345678, a single word.
+#define CRC32_CHECK_WORD        (0x12345678u)
+#define CRC32_CHECK_VALUE       (0xDF8A8A2Bu)
+
+// The DMA transfers 65535 words at most.
+#define CRC32_DMA_MAX_WORDS     (0xFFFFu)
+
+#if defined(RCC_AHB1ENR_CRCEN)
+
+// STM32F4: memory to memory is done by DMA2 only.
+#define CRC32_CLOCKS_ENABLE() \
+  (RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN | RCC_AHB1ENR_DMA2EN)
+#define CRC32_DMA_STREAM        (DMA2_Stream1)
+// The CCM RAM is not reachable by DMA.
+#define CRC32_DMA_REACHABLE(_P, _N) \
+  (((uint32_t) (_P) + (_N) <= CCMDATARAM_BASE) \
+      || ((uint32_t) (_P) > CCMDATARAM_END))
+#define CRC32_DMA_FLAGS \
+  (DMA_LISR_TCIF1 | DMA_LISR_HTIF1 | DMA_LISR_TEIF1 | DMA_LISR_DMEIF1 \
+      | DMA_LISR_FEIF1)
+
+#else
+
+// STM32F1.
+#define CRC32_CLOCKS_ENABLE() \
+  (RCC->AHBENR |= RCC_AHBENR_CRCEN | RCC_AHBENR_DMA1EN)
+#define CRC32_DMA_CHANNEL       (DMA1_Channel1)
+#define CRC32_DMA_REACHABLE(_P, _N)     (true)
+
+#endif
+
+static uint32_t table[8][256];
+
+static bool hardware_ok;
+static volatile bool hardware_busy;
+
+// Provided by the linker script.
+extern const uint32_t __vectors_start;
+extern const uint32_t __image_crc;
+
+// ----------------------------------------------------------------------------
+
+static bool
+hardware_acquire (void)
+{
+  bool ok = false;
+
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (hardware_ok && !hardware_busy)
+    {
+      hardware_busy = true;
+      ok = true;
+    }
+
+  __set_PRIMASK (primask);
+  return ok;
+}
+
+static void
+hardware_release (void)
+{
+  hardware_busy = false;
+}
+
+#if defined(CRC32_DMA_STREAM)
+
+// Return false on a transfer error.
+static bool
+dma_feed (const uint32_t* words, uint32_t count)
+{
+  DMA_Stream_TypeDef* stream = CRC32_DMA_STREAM;
+
+  // In memory to memory mode the "peripheral" is the source; the
+  // destination is the fixed CRC data register.
+  stream->CR = 0;
+  stream->PAR = (uint32_t) words;
+  stream->M0AR = (uint32_t) &CRC->DR;
+  stream->NDTR = count;
+  stream->FCR = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH;
+  DMA2->LIFCR = CRC32_DMA_FLAGS;
+  stream->CR = DMA_SxCR_DIR_1 | DMA_SxCR_PINC | DMA_SxCR_PSIZE_1
+      | DMA_SxCR_MSIZE_1 | DMA_SxCR_EN;
+
+  uint32_t flags;
+  while (((flags = DMA2->LISR) & (DMA_LISR_TCIF1 | DMA_LISR_TEIF1)) == 0)
+    ;
+  DMA2->LIFCR = CRC32_DMA_FLAGS;
+  stream->CR = 0;
+
+  return (flags & DMA_LISR_TEIF1) == 0;
+}
+
+#else
+
+// Return false on a transfer error.
+static bool
+dma_feed (const uint32_t* words, uint32_t count)
+{
+  DMA_Channel_TypeDef* channel = CRC32_DMA_CHANNEL;
+
+  // Read from memory, write to the fixed CRC data register.
+  channel->CCR = 0;
+  channel->CMAR = (uint32_t) words;
+  channel->CPAR = (uint32_t) &CRC->DR;
+  channel->CNDTR = count;
+  DMA1->IFCR = DMA_IFCR_CGIF1;
+  channel->CCR = DMA_CCR1_MEM2MEM | DMA_CCR1_DIR | DMA_CCR1_MINC
+      | DMA_CCR1_PSIZE_1 | DMA_CCR1_MSIZE_1 | DMA_CCR1_EN;
+
+  uint32_t flags;
+  while (((flags = DMA1->ISR) & (DMA_ISR_TCIF1 | DMA_ISR_TEIF1)) == 0)
+    ;
+  DMA1->IFCR = DMA_IFCR_CGIF1;
+  channel->CCR = 0;
+
+  return (flags & DMA_ISR_TEIF1) == 0;
+}
+
+#endif
+
+// Feed whole words; the unit must be acquired.
+static uint32_t
+hardware_words (uint32_t crc, const uint32_t* words, size_t count, bool dma)
+{
+  if (count == 0)
+    {
+      return crc;
+    }
+
+  // The unit always restarts from 0xFFFFFFFF; to continue from crc,
+  // fold the difference into the first word.
+  CRC->CR = CRC_CR_RESET;
+  CRC->DR = words[0] ^ crc ^ CRC32_INIT;
+  ++words;
+  --count;
+
+  if (dma)
+    {
+      while (count > 0)
+        {
+          uint32_t n = (count > CRC32_DMA_MAX_WORDS) ? CRC32_DMA_MAX_WORDS :
+              (uint32_t) count;
+          // The CRC so far, to redo the chunk if the transfer fails.
+          uint32_t before = CRC->DR;
+          if (!dma_feed (words, n))
+            {
+              return crc32_software (before, words, count * 4);
+            }
+          words += n;
+          count -= n;
+        }
+    }
+  else
+    {
+      for (; count >= 4; count -= 4, words += 4)
+        {
+          CRC->DR = words[0];
+          CRC->DR = words[1];
+          CRC->DR = words[2];
+          CRC->DR = words[3];
+        }
+      for (; count > 0; --count)
+        {
+          CRC->DR = *words++;
+        }
+    }
+
+  return CRC->DR;
+}
+
+static inline uint32_t
+__attribute__((always_inline))
+software_byte (uint32_t crc, uint8_t byte)
+{
+  return (crc << 8) ^ table[0][(crc >> 24) ^ byte];
+}
+
+// ----------------------------------------------------------------------------
+
+void
+crc32_init (void)
+{
+  for (uint32_t i = 0; i < 256; ++i)
+    {
+      uint32_t c = i << 24;
+      for (int bit = 0; bit < 8; ++bit)
+        {
+          c = (c & 0x80000000u) ? ((c << 1) ^ CRC32_POLYNOMIAL) : (c << 1);
+        }
+      table[0][i] = c;
+    }
+  for (uint32_t i = 0; i < 256; ++i)
+    {
+      for (int k = 1; k < 8; ++k)
+        {
+          uint32_t c = table[k - 1][i];
+          table[k][i] = (c << 8) ^ table[0][c >> 24];
+        }
+    }
+
+  CRC32_CLOCKS_ENABLE();
+
+  CRC->CR = CRC_CR_RESET;
+  CRC->DR = CRC32_CHECK_WORD;
+  hardware_ok = (CRC->DR == CRC32_CHECK_VALUE);
+}
+
+bool
+crc32_hardware_available (void)
+{
+  return hardware_ok;
+}
+
+// The buffer may be unaligned; memcpy() is a single load where
+// unaligned accesses are allowed (ARMv7-M), bytes otherwise.
+static inline uint32_t
+__attribute__((always_inline))
+load_word (const uint8_t* p)
+{
+  uint32_t word;
+  memcpy (&word, p, sizeof(word));
+  return word;
+}
+
+uint32_t
+crc32_software (uint32_t crc, const void* buf, size_t nbyte)
+{
+  const uint8_t* bytes = buf;
+
+  // Slice-by-8; the big endian view of each group of 4 bytes is the
+  // little endian word itself.
+  for (; nbyte >= 8; nbyte -= 8, bytes += 8)
+    {
+      uint32_t one = load_word (bytes) ^ crc;
+      uint32_t two = load_word (bytes + 4);
+      crc = table[7][one >> 24] ^ table[6][(one >> 16) & 0xFF]
+          ^ table[5][(one >> 8) & 0xFF] ^ table[4][one & 0xFF]
+          ^ table[3][two >> 24] ^ table[2][(two >> 16) & 0xFF]
+          ^ table[1][(two >> 8) & 0xFF] ^ table[0][two & 0xFF];
+    }
+  if (nbyte >= 4)
+    {
+      uint32_t one = load_word (bytes) ^ crc;
+      crc = table[3][one >> 24] ^ table[2][(one >> 16) & 0xFF]
+          ^ table[1][(one >> 8) & 0xFF] ^ table[0][one & 0xFF];
+      nbyte -= 4;
+      bytes += 4;
+    }
+
+  while (nbyte-- > 0)
+    {
+      crc = software_byte (crc, *bytes++);
+    }
+  return crc;
+}
+
+bool
+crc32_hardware (uint32_t* crc, const void* buf, size_t nbyte, bool dma)
+{
+  if (!hardware_acquire ())
+    {
+      return false;
+    }
+
+  const uint8_t* bytes = buf;
+  size_t words = nbyte / 4;
+  if (dma && !CRC32_DMA_REACHABLE(bytes, nbyte))
+    {
+      dma = false;
+    }
+  uint32_t c = hardware_words (*crc, (const uint32_t*) bytes, words, dma);
+  hardware_release ();
+
+  for (bytes += words * 4, nbyte -= words * 4; nbyte > 0; --nbyte)
+    {
+      c = software_byte (c, *bytes++);
+    }
+  *crc = c;
+  return true;
+}
+
+uint32_t
+crc32_update (uint32_t crc, const void* buf, size_t nbyte)
+{
+  // The unit is fed from aligned buffers only.
+  if (((uint32_t) buf & 3) == 0
+      && crc32_hardware (
+          &crc, buf, nbyte,
+          (OS_INTEGER_CRC32_DMA_THRESHOLD != 0)
+              && (nbyte >= OS_INTEGER_CRC32_DMA_THRESHOLD)))
+    {
+      return crc;
+    }
+
+  return crc32_software (crc, buf, nbyte);
+}
+
+uint32_t
+crc32 (const void* buf, size_t nbyte)
+{
+  return crc32_update (CRC32_INIT, buf, nbyte);
+}
+
+int
+crc32_check_image (void)
+{
+  if (__image_crc == 0xFFFFFFFFu)
+    {
+      return CRC32_IMAGE_NOT_STAMPED;
+    }
+
+  const uint8_t* begin = (const uint8_t*) &__vectors_start;
+  const uint8_t* end = (const uint8_t*) &__image_crc;
+  if (crc32 (begin, (size_t) (end - begin)) != __image_crc)
+    {
+      return CRC32_IMAGE_CORRUPT;
+    }
+  return CRC32_IMAGE_OK;
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,73 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+// The FreeRTOS heap implementation is selected here, not by excluding
+// files from the build, so it can follow the configuration.
+
+#include "FreeRTOS.h"
+#include "freertos_heap.h"
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+
+// No heap; see src/freertos_static.c.
+
+void
+freertos_heap_init (void)
+{
+  ;
+}
+
+#elif (configHEAP_IMPLEMENTATION == 1)
+#include "../freertos/portable/MemMang/heap_1.c"
+#elif (configHEAP_IMPLEMENTATION == 2)
+#include "../freertos/portable/MemMang/heap_2.c"
+#elif (configHEAP_IMPLEMENTATION == 3)
+#include "../freertos/portable/MemMang/heap_3.c"
+#elif (configHEAP_IMPLEMENTATION == 4)
+#include "../freertos/portable/MemMang/heap_4.c"
+#elif (configHEAP_IMPLEMENTATION == 5)
+#include "../freertos/portable/MemMang/heap_5.c"
+#elif (configHEAP_IMPLEMENTATION == 6)
+#include "../freertos/portable/MemMang/heap_6.c"
+#else
+#error "Unsupported configHEAP_IMPLEMENTATION"
+#endif
+
+#if (configSUPPORT_STATIC_ALLOCATION == 0)
+
+#if (configHEAP_IMPLEMENTATION == 5) || (configHEAP_IMPLEMENTATION == 6)
+
+// The heap spans the CCM RAM (64 KB at 0x10000000, not reachable by DMA)
+// and part of the SRAM. heap_5 wants the regions in address order.
+static uint8_t heap_ccm[configHEAP_CCM_SIZE] __attribute__((section(".bss.CCMRAM"), aligned(8)));
+static uint8_t heap_sram[configTOTAL_HEAP_SIZE] __attribute__((aligned(8)));
+
+static const HeapRegion_t heap_regions[] =
+  {
+    { heap_ccm, sizeof(heap_ccm) },
+    { heap_sram, sizeof(heap_sram) },
+    { NULL, 0 } };
+
+void
+freertos_heap_init (void)
+{
+  vPortDefineHeapRegions (heap_regions);
+}
+
+#else
+
+void
+freertos_heap_init (void)
+{
+  ;
+}
+
+#endif
+
+#endif // (configSUPPORT_STATIC_ALLOCATION == 0)
+
+// ----------------------------------------------------------------------------
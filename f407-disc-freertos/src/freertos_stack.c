@@ -0,0 +1,312 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "freertos_stack.h"
+#include "freertos_static.h"
+#include "diag/Trace.h"
+#include "cmsis_device.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(OS_USE_FREERTOS_STACK_PROFILE)
+
+#if (configCHECK_FOR_STACK_OVERFLOW < 2) || (configUSE_TRACE_FACILITY == 0)
+#error "The stack profile needs configCHECK_FOR_STACK_OVERFLOW 2 and configUSE_TRACE_FACILITY"
+#endif
+
+// ----------------------------------------------------------------------------
+
+// The same as tskSTACK_FILL_BYTE, in tasks.c.
+#define STACK_FILL_WORD         (0xa5a5a5a5u)
+
+// Rounding of the suggested depth, in words.
+#define STACK_ROUND             (8)
+
+// The overflow report goes out even with the buffered trace, whose
+// buffers are written only by the idle task.
+#if defined(TRACE) \
+  && (defined(OS_USE_TRACE_TASK_BUFFERS) || defined(OS_USE_TRACE_MUTEX))
+#define stack_trace_write trace_write_device
+#else
+#define stack_trace_write trace_write
+#endif
+
+typedef struct
+{
+  void* handle;
+  uint16_t depth;
+  uint16_t samples;
+  uint8_t alive;
+  uint8_t next;
+  // Free words at the last samples, in a ring.
+  uint16_t free[OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY];
+  char name[configMAX_TASK_NAME_LEN];
+} stack_profile_t;
+
+static stack_profile_t profiles[OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS];
+
+// Provided by the linker script.
+extern uint32_t _Main_Stack_Limit;
+extern uint32_t __stack;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StackType_t profile_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t profile_buffer;
+#endif
+
+// ----------------------------------------------------------------------------
+
+static stack_profile_t*
+find_profile (void* handle)
+{
+  for (uint32_t i = 0; i < OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS; ++i)
+    {
+      if (profiles[i].handle == handle)
+        {
+          return &profiles[i];
+        }
+    }
+  return NULL;
+}
+
+void
+freertos_stack_task_create (void* task, const char* name, uint32_t depth)
+{
+  // The same task control block, reused after a delete, or a free
+  // entry, or one of a deleted task.
+  stack_profile_t* profile = find_profile (task);
+  if (profile == NULL)
+    {
+      profile = find_profile (NULL);
+    }
+  for (uint32_t i = 0;
+      (profile == NULL) && (i < OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS); ++i)
+    {
+      if (profiles[i].samples != 0 && !profiles[i].alive)
+        {
+          profile = &profiles[i];
+        }
+    }
+  if (profile == NULL)
+    {
+      return;
+    }
+
+  memset (profile, 0, sizeof(*profile));
+  profile->handle = task;
+  profile->depth = (uint16_t) depth;
+  profile->alive = 1;
+  strncpy (profile->name, name, sizeof(profile->name) - 1);
+}
+
+void
+freertos_stack_profile_init (void)
+{
+  // Fill from the limit up to a little below the current frame.
+  uint32_t* p = &_Main_Stack_Limit;
+  uint32_t* end = (uint32_t*) (__get_MSP () - 64);
+  while (p < end)
+    {
+      *p++ = STACK_FILL_WORD;
+    }
+}
+
+// In bytes.
+static uint32_t
+main_stack_used (void)
+{
+  const uint32_t* p = &_Main_Stack_Limit;
+  while (p < &__stack && *p == STACK_FILL_WORD)
+    {
+      ++p;
+    }
+  return (uint32_t) ((const uint8_t*) &__stack - (const uint8_t*) p);
+}
+
+static uint32_t
+suggested_depth (uint32_t used)
+{
+  return (used + OS_INTEGER_FREERTOS_STACK_PROFILE_MARGIN + STACK_ROUND - 1)
+      & ~(STACK_ROUND - 1);
+}
+
+static void
+sample (void)
+{
+  static TaskStatus_t status[OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS];
+
+  UBaseType_t count = uxTaskGetSystemState (
+      status, OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS, NULL);
+  if (count == 0)
+    {
+      trace_printf ("stack: more than %u tasks\n",
+                    OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS);
+      return;
+    }
+
+  for (uint32_t i = 0; i < OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS; ++i)
+    {
+      profiles[i].alive = 0;
+    }
+
+  for (UBaseType_t i = 0; i < count; ++i)
+    {
+      stack_profile_t* profile = find_profile (status[i].xHandle);
+      if (profile == NULL)
+        {
+          continue;
+        }
+
+      taskENTER_CRITICAL();
+      profile->alive = 1;
+      profile->free[profile->next] = status[i].usStackHighWaterMark;
+      profile->next = (uint8_t) ((profile->next + 1)
+          % OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY);
+      if (profile->samples < 0xFFFF)
+        {
+          profile->samples++;
+        }
+      taskEXIT_CRITICAL();
+    }
+}
+
+void
+freertos_stack_profile_print (void)
+{
+  sample ();
+
+  uint32_t total = 0;
+  uint32_t total_suggested = 0;
+
+  trace_printf ("%-16s %6s %6s %8s\n", "stack (words)", "depth", "used",
+                "suggest");
+  for (uint32_t i = 0; i < OS_INTEGER_FREERTOS_STACK_PROFILE_TASKS; ++i)
+    {
+      const stack_profile_t* profile = &profiles[i];
+      if (profile->samples == 0)
+        {
+          continue;
+        }
+
+      // The high water mark only decreases; the last sample is the
+      // lowest.
+      uint32_t last = (profile->next + OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY
+          - 1) % OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY;
+      uint32_t used = profile->depth - profile->free[last];
+      uint32_t suggested = suggested_depth (used);
+
+      trace_printf ("%-16s %6u %6u %8u%s\n", profile->name, profile->depth,
+                    used, suggested, profile->alive ? "" : " (deleted)");
+      if (profile->alive)
+        {
+          total += profile->depth;
+          total_suggested += suggested;
+        }
+    }
+
+  uint32_t main_size = (uint32_t) ((uint8_t*) &__stack
+      - (uint8_t*) &_Main_Stack_Limit) / sizeof(StackType_t);
+  uint32_t main_used = main_stack_used () / sizeof(StackType_t);
+  trace_printf ("%-16s %6u %6u %8u\n", "(main, isr)", main_size, main_used,
+                suggested_depth (main_used));
+
+  trace_printf ("%-16s %6u %6s %8u bytes\n", "(tasks)",
+                total * sizeof(StackType_t), "",
+                total_suggested * sizeof(StackType_t));
+}
+
+static void
+profile_task_function (void* parms __attribute__((unused)))
+{
+  for (;;)
+    {
+      vTaskDelay (OS_INTEGER_FREERTOS_STACK_PROFILE_TICKS);
+      freertos_stack_profile_print ();
+    }
+}
+
+void
+freertos_stack_profile_start (unsigned long priority)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (profile_task_function, "stack",
+                     configMINIMAL_STACK_SIZE, NULL, priority, profile_stack,
+                     &profile_buffer);
+#else
+  xTaskCreate(profile_task_function, "stack", configMINIMAL_STACK_SIZE, NULL,
+              priority, NULL);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+static void
+overflow_printf (const char* format, ...)
+{
+  char buf[64];
+
+  va_list ap;
+  va_start(ap, format);
+  int ret = vsnprintf (buf, sizeof(buf), format, ap);
+  va_end(ap);
+
+  if (ret > 0)
+    {
+      stack_trace_write (buf,
+                         (size_t) ret < sizeof(buf) ? (size_t) ret :
+                             sizeof(buf) - 1);
+    }
+}
+
+void
+freertos_stack_overflow (void* task, const char* name)
+{
+  // The parameters may be corrupt; the profile has its own copies.
+  const stack_profile_t* profile = find_profile (task);
+  if (profile != NULL)
+    {
+      name = profile->name;
+    }
+
+  overflow_printf ("Stack overflow in task '%s'\n", name);
+
+  if (profile != NULL)
+    {
+      uint32_t n = profile->samples;
+      if (n > OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY)
+        {
+          n = OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY;
+        }
+
+      overflow_printf ("depth %u words, free at the last %u samples:",
+                       profile->depth, (unsigned) n);
+      // Oldest first.
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          uint32_t k = (profile->next + OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY
+              - n + i) % OS_INTEGER_FREERTOS_STACK_PROFILE_HISTORY;
+          overflow_printf (" %u", profile->free[k]);
+        }
+      overflow_printf ("\n");
+    }
+
+  if (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk)
+    {
+      __BKPT (0);
+    }
+  NVIC_SystemReset ();
+  for (;;)
+    ;
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(OS_USE_FREERTOS_STACK_PROFILE)
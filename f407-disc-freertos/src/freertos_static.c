@@ -0,0 +1,255 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#include "freertos_static.h"
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+
+// ----------------------------------------------------------------------------
+
+// The buffer given by the static create functions, handed to the kernel
+// on the next pvPortMalloc() call.
+static void* pending_buffer;
+static size_t pending_size;
+
+static uint8_t kernel_heap[configSTATIC_KERNEL_HEAP_SIZE] __attribute__((aligned(portBYTE_ALIGNMENT)));
+static size_t kernel_heap_used;
+
+// ----------------------------------------------------------------------------
+
+static void
+malloc_failed (void)
+{
+#if (configUSE_MALLOC_FAILED_HOOK == 1)
+  extern void
+  vApplicationMallocFailedHook (void);
+
+  vApplicationMallocFailedHook ();
+#endif
+  configASSERT(0);
+}
+
+void*
+pvPortMalloc (size_t xWantedSize)
+{
+  void* p = NULL;
+
+  vTaskSuspendAll ();
+    {
+      if (pending_buffer != NULL)
+        {
+          // The kernel must not ask for more than the Static*_t types
+          // reserve; if it does, they are out of sync with the kernel.
+          configASSERT(xWantedSize <= pending_size);
+          if (xWantedSize <= pending_size)
+            {
+              p = pending_buffer;
+            }
+          pending_buffer = NULL;
+        }
+      else if (xTaskGetSchedulerState () == taskSCHEDULER_NOT_STARTED)
+        {
+          // The kernel own objects, created by vTaskStartScheduler().
+          size_t size = (xWantedSize + portBYTE_ALIGNMENT - 1)
+              & ~((size_t) portBYTE_ALIGNMENT - 1);
+          if (kernel_heap_used + size <= sizeof(kernel_heap))
+            {
+              p = &kernel_heap[kernel_heap_used];
+              kernel_heap_used += size;
+            }
+        }
+    }
+  (void) xTaskResumeAll ();
+
+  if (p == NULL)
+    {
+      malloc_failed ();
+    }
+  return p;
+}
+
+void
+vPortFree (void* pv)
+{
+  // All memory is static; deleted tasks leave their buffers to the
+  // application, for reuse.
+  (void) pv;
+}
+
+size_t
+xPortGetFreeHeapSize (void)
+{
+  // What is left in the kernel arena; use it to trim
+  // configSTATIC_KERNEL_HEAP_SIZE.
+  return sizeof(kernel_heap) - kernel_heap_used;
+}
+
+void
+vPortInitialiseBlocks (void)
+{
+  ;
+}
+
+// ----------------------------------------------------------------------------
+
+TaskHandle_t
+xTaskCreateStatic (TaskFunction_t pxTaskCode, const char* const pcName,
+                   const uint32_t ulStackDepth, void* const pvParameters,
+                   UBaseType_t uxPriority, StackType_t* const puxStackBuffer,
+                   StaticTask_t* const pxTaskBuffer)
+{
+  TaskHandle_t handle = NULL;
+
+  // V8.2.1 keeps the stack depth in 16-bits.
+  configASSERT(ulStackDepth <= 0xFFFF);
+  configASSERT(puxStackBuffer != NULL && pxTaskBuffer != NULL);
+
+  // The scheduler is suspended so no other task can take the pending
+  // buffer; the stack is passed directly, only the TCB is allocated.
+  vTaskSuspendAll ();
+    {
+      pending_buffer = pxTaskBuffer;
+      pending_size = sizeof(StaticTask_t);
+
+      if (xTaskGenericCreate (pxTaskCode, pcName, (uint16_t) ulStackDepth,
+                              pvParameters, uxPriority, &handle,
+                              puxStackBuffer, NULL) != pdPASS)
+        {
+          handle = NULL;
+        }
+      pending_buffer = NULL;
+    }
+  (void) xTaskResumeAll ();
+
+  return handle;
+}
+
+QueueHandle_t
+xQueueCreateStatic (const UBaseType_t uxQueueLength,
+                    const UBaseType_t uxItemSize, uint8_t* pucQueueBuffer)
+{
+  QueueHandle_t handle;
+
+  configASSERT(pucQueueBuffer != NULL);
+
+  vTaskSuspendAll ();
+    {
+      pending_buffer = pucQueueBuffer;
+      pending_size = queueSTATIC_BUFFER_SIZE(uxQueueLength, uxItemSize);
+
+      handle = xQueueCreate(uxQueueLength, uxItemSize);
+      pending_buffer = NULL;
+    }
+  (void) xTaskResumeAll ();
+
+  return handle;
+}
+
+#if (configUSE_MUTEXES == 1)
+
+SemaphoreHandle_t
+xSemaphoreCreateMutexStatic (StaticSemaphore_t* pxMutexBuffer)
+{
+  SemaphoreHandle_t handle;
+
+  configASSERT(pxMutexBuffer != NULL);
+
+  vTaskSuspendAll ();
+    {
+      pending_buffer = pxMutexBuffer;
+      pending_size = sizeof(StaticSemaphore_t);
+
+      handle = xSemaphoreCreateMutex();
+      pending_buffer = NULL;
+    }
+  (void) xTaskResumeAll ();
+
+  return handle;
+}
+
+#endif
+
+#if (configUSE_RECURSIVE_MUTEXES == 1)
+
+SemaphoreHandle_t
+xSemaphoreCreateRecursiveMutexStatic (StaticSemaphore_t* pxMutexBuffer)
+{
+  SemaphoreHandle_t handle;
+
+  configASSERT(pxMutexBuffer != NULL);
+
+  vTaskSuspendAll ();
+    {
+      pending_buffer = pxMutexBuffer;
+      pending_size = sizeof(StaticSemaphore_t);
+
+      handle = xSemaphoreCreateRecursiveMutex();
+      pending_buffer = NULL;
+    }
+  (void) xTaskResumeAll ();
+
+  return handle;
+}
+
+#endif
+
+#if (configUSE_TIMERS == 1)
+
+TimerHandle_t
+xTimerCreateStatic (const char* const pcTimerName,
+                    const TickType_t xTimerPeriodInTicks,
+                    const UBaseType_t uxAutoReload, void* const pvTimerID,
+                    TimerCallbackFunction_t pxCallbackFunction,
+                    StaticTimer_t* pxTimerBuffer)
+{
+  TimerHandle_t handle;
+
+  configASSERT(pxTimerBuffer != NULL);
+
+  // The timer is allocated first; the timer queue, if this is the
+  // first timer, is then served from the kernel arena.
+  vTaskSuspendAll ();
+    {
+      pending_buffer = pxTimerBuffer;
+      pending_size = sizeof(StaticTimer_t);
+
+      handle = xTimerCreate (pcTimerName, xTimerPeriodInTicks, uxAutoReload,
+                             pvTimerID, pxCallbackFunction);
+      pending_buffer = NULL;
+    }
+  (void) xTaskResumeAll ();
+
+  return handle;
+}
+
+#endif
+
+EventGroupHandle_t
+xEventGroupCreateStatic (StaticEventGroup_t* pxEventGroupBuffer)
+{
+  EventGroupHandle_t handle;
+
+  configASSERT(pxEventGroupBuffer != NULL);
+
+  vTaskSuspendAll ();
+    {
+      pending_buffer = pxEventGroupBuffer;
+      pending_size = sizeof(StaticEventGroup_t);
+
+      handle = xEventGroupCreate ();
+      pending_buffer = NULL;
+    }
+  (void) xTaskResumeAll ();
+
+  return handle;
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // (configSUPPORT_STATIC_ALLOCATION == 1)
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,187 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "trace_rtos.h"
+#include "cmsis_device.h"
+
+#if (configUSE_TICKLESS_IDLE == 1)
+
+// ----------------------------------------------------------------------------
+
+// Interrupts are disabled here, so the output is not written out; the
+// idle hook does it. If some is still pending, skip this sleep and let
+// the idle task run the hook again.
+void
+freertos_pre_sleep_processing (uint32_t* expected_idle_ticks)
+{
+  bool pending = false;
+#if defined(OS_USE_FREERTOS_TRACE)
+  pending = pending || freertos_trace_pending ();
+#endif
+#if defined(OS_USE_TRACE_TASK_BUFFERS)
+  pending = pending || trace_rtos_pending ();
+#endif
+  if (pending)
+    {
+      *expected_idle_ticks = 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+#if defined(OS_USE_FREERTOS_TICKLESS_TIMER)
+
+#define TIMER_COUNTS_PER_TICK \
+  (OS_INTEGER_FREERTOS_TICKLESS_TIMER_HZ / configTICK_RATE_HZ)
+
+_Static_assert(
+    (OS_INTEGER_FREERTOS_TICKLESS_TIMER_HZ % configTICK_RATE_HZ) == 0,
+    "The tickless timer frequency must be a multiple of the tick rate");
+
+// Keep the 32-bit timer from wrapping during a sleep.
+#define TIMER_MAX_SUPPRESSED_TICKS \
+  (0xFFFFFFFFu / TIMER_COUNTS_PER_TICK - 1)
+
+// Counts needed to reprogram the auto-reload before the counter
+// passes it; closer to the end of the tick period, the period is
+// left to complete and counted as elapsed.
+#define TIMER_REPROGRAM_MARGIN          (8)
+
+// Replaces the port's SysTick setup; called by vTaskStartScheduler().
+void
+vPortSetupTimerInterrupt (void)
+{
+  // From now on the kernel tick is the HAL tick, see HAL_GetTick().
+  SysTick->CTRL = 0;
+
+  RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;
+  (void) RCC->APB1ENR;
+
+  // The APB1 timers run at twice PCLK1 when APB1 is divided.
+  uint32_t timer_clock = HAL_RCC_GetPCLK1Freq ();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+    {
+      timer_clock *= 2;
+    }
+
+  TIM5->CR1 = 0;
+  TIM5->PSC = timer_clock / OS_INTEGER_FREERTOS_TICKLESS_TIMER_HZ - 1;
+  TIM5->ARR = TIMER_COUNTS_PER_TICK - 1;
+  // Load the prescaler, without an interrupt.
+  TIM5->EGR = TIM_EGR_UG;
+  TIM5->SR = 0;
+  TIM5->DIER = TIM_DIER_UIE;
+  TIM5->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+  // The same priority SysTick would have.
+  NVIC_SetPriority (TIM5_IRQn,
+                    configKERNEL_INTERRUPT_PRIORITY >> (8 - __NVIC_PRIO_BITS));
+  NVIC_EnableIRQ (TIM5_IRQn);
+}
+
+void
+TIM5_IRQHandler (void)
+{
+#if defined(OS_USE_FREERTOS_TRACE)
+  freertos_trace_isr_enter ();
+#endif
+
+  TIM5->SR = ~TIM_SR_UIF;
+  xPortSysTickHandler ();
+
+#if defined(OS_USE_FREERTOS_TRACE)
+  freertos_trace_isr_exit ();
+#endif
+}
+
+// Replaces the port's SysTick based implementation. The timer is never
+// stopped; the current tick period is stretched to end after the
+// expected idle time, by writing the auto-reload with preload disabled,
+// and, after the wake-up, shortened back to end at the next tick
+// boundary, so no time is lost in the process.
+void
+vPortSuppressTicksAndSleep (TickType_t xExpectedIdleTime)
+{
+  TickType_t xModifiableIdleTime;
+  uint32_t elapsed;
+
+  if (xExpectedIdleTime > TIMER_MAX_SUPPRESSED_TICKS)
+    {
+      xExpectedIdleTime = TIMER_MAX_SUPPRESSED_TICKS;
+    }
+
+  // Not taskENTER_CRITICAL(), which would also mask the interrupts
+  // that should end the sleep.
+  __disable_irq ();
+
+  if (eTaskConfirmSleepModeStatus () == eAbortSleep)
+    {
+      __enable_irq ();
+      return;
+    }
+
+  TIM5->CR1 &= ~TIM_CR1_ARPE;
+  TIM5->ARR = xExpectedIdleTime * TIMER_COUNTS_PER_TICK - 1;
+
+  if ((TIM5->SR & TIM_SR_UIF) != 0)
+    {
+      // The tick period ended meanwhile; its interrupt is pending.
+      TIM5->ARR = TIMER_COUNTS_PER_TICK - 1;
+      TIM5->CR1 |= TIM_CR1_ARPE;
+      __enable_irq ();
+      return;
+    }
+
+  xModifiableIdleTime = xExpectedIdleTime;
+  configPRE_SLEEP_PROCESSING(xModifiableIdleTime);
+  if (xModifiableIdleTime > 0)
+    {
+      __DSB ();
+      __WFI ();
+      __ISB ();
+    }
+  configPOST_SLEEP_PROCESSING(xExpectedIdleTime);
+
+  uint32_t count = TIM5->CNT;
+  if ((TIM5->SR & TIM_SR_UIF) != 0)
+    {
+      // The whole idle time passed; the pending interrupt counts the
+      // last tick, and the counter already started the next period.
+      if (count > TIMER_COUNTS_PER_TICK - TIMER_REPROGRAM_MARGIN)
+        {
+          TIM5->CNT = 0;
+        }
+      TIM5->ARR = TIMER_COUNTS_PER_TICK - 1;
+      elapsed = xExpectedIdleTime - 1;
+    }
+  else
+    {
+      // Woken early by another interrupt; end the current period at
+      // the next tick boundary.
+      elapsed = count / TIMER_COUNTS_PER_TICK;
+      if (count - elapsed * TIMER_COUNTS_PER_TICK
+          > TIMER_COUNTS_PER_TICK - TIMER_REPROGRAM_MARGIN)
+        {
+          ++elapsed;
+        }
+      TIM5->ARR = (elapsed + 1) * TIMER_COUNTS_PER_TICK - 1;
+    }
+
+  // The following periods are single ticks again.
+  TIM5->CR1 |= TIM_CR1_ARPE;
+  TIM5->ARR = TIMER_COUNTS_PER_TICK - 1;
+
+  vTaskStepTick (elapsed);
+
+  __enable_irq ();
+}
+
+#endif // defined(OS_USE_FREERTOS_TICKLESS_TIMER)
+
+// ----------------------------------------------------------------------------
+
+#endif // (configUSE_TICKLESS_IDLE == 1)
@@ -0,0 +1,296 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "freertos_trace.h"
+#include "crc32.h"
+#include "diag/Trace.h"
+#include "cmsis_device.h"
+
+#if defined(OS_USE_FREERTOS_TRACE) && !defined(OS_USE_TRACE_ITM)
+#include "arm/semihosting.h"
+#endif
+
+// ----------------------------------------------------------------------------
+
+// The high word of the 64-bit cycle counter and the last seen low word.
+static uint32_t cycles_high;
+static uint32_t cycles_last;
+
+void
+freertos_run_time_stats_init (void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  cycles_high = 0;
+  cycles_last = DWT->CYCCNT;
+}
+
+uint64_t
+freertos_trace_cycles (void)
+{
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  uint32_t now = DWT->CYCCNT;
+  if (now < cycles_last)
+    {
+      ++cycles_high;
+    }
+  cycles_last = now;
+  uint64_t cycles = ((uint64_t) cycles_high << 32) | now;
+
+  __set_PRIMASK (primask);
+  return cycles;
+}
+
+uint32_t
+freertos_run_time_stats_counter (void)
+{
+  return (uint32_t) (freertos_trace_cycles ()
+      >> OS_INTEGER_RUN_TIME_STATS_SHIFT);
+}
+
+void
+freertos_run_time_stats_print (void)
+{
+  static TaskStatus_t status[OS_INTEGER_RUN_TIME_STATS_TASKS];
+  uint32_t total;
+
+  // uxTaskGetSystemState() fills nothing if the array is too small.
+  UBaseType_t count = 0;
+  if (uxTaskGetNumberOfTasks () <= OS_INTEGER_RUN_TIME_STATS_TASKS)
+    {
+      count = uxTaskGetSystemState (status, OS_INTEGER_RUN_TIME_STATS_TASKS,
+                                    &total);
+    }
+  if (count == 0)
+    {
+      trace_printf ("run time stats: more than %u tasks\n",
+                    OS_INTEGER_RUN_TIME_STATS_TASKS);
+      return;
+    }
+
+  // Percent with one decimal.
+  total /= 1000;
+  if (total == 0)
+    {
+      return;
+    }
+
+  for (UBaseType_t i = 0; i < count; ++i)
+    {
+      uint32_t permille = status[i].ulRunTimeCounter / total;
+      trace_printf ("%-16s %10u %3u.%u%%\n", status[i].pcTaskName,
+                    status[i].ulRunTimeCounter, permille / 10, permille % 10);
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+#if defined(OS_USE_FREERTOS_TRACE)
+
+_Static_assert(
+    (OS_INTEGER_FREERTOS_TRACE_RECORDS & (OS_INTEGER_FREERTOS_TRACE_RECORDS - 1)) == 0,
+    "OS_INTEGER_FREERTOS_TRACE_RECORDS must be a power of 2");
+
+_Static_assert(sizeof(freertos_trace_record_t) == 8,
+    "freertos_trace_record_t must be 8 bytes");
+
+#define TRACE_MASK (OS_INTEGER_FREERTOS_TRACE_RECORDS - 1)
+
+static freertos_trace_record_t ring[OS_INTEGER_FREERTOS_TRACE_RECORDS];
+static volatile uint32_t ring_head;
+static volatile uint32_t ring_tail;
+static uint32_t dropped;
+
+volatile uint8_t freertos_trace_current_task;
+
+// Must be called with interrupts disabled.
+static inline void
+__attribute__((always_inline))
+ring_put (uint32_t timestamp, uint8_t type, uint8_t task, uint16_t arg)
+{
+  uint32_t head = ring_head;
+  if (head - ring_tail >= OS_INTEGER_FREERTOS_TRACE_RECORDS)
+    {
+      ++dropped;
+      return;
+    }
+
+  freertos_trace_record_t* r = &ring[head & TRACE_MASK];
+  r->timestamp = timestamp;
+  r->type = type;
+  r->task = task;
+  r->arg = arg;
+  ring_head = head + 1;
+}
+
+void
+freertos_trace_record (uint8_t type, uint8_t task, uint16_t arg)
+{
+  // A few cycles with PRIMASK set; this works from any priority,
+  // unlike the FreeRTOS critical sections.
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (dropped != 0
+      && (ring_head - ring_tail) <= OS_INTEGER_FREERTOS_TRACE_RECORDS - 2)
+    {
+      // Tell the host how many records were lost, before resuming.
+      ring_put (DWT->CYCCNT, FREERTOS_TRACE_OVERFLOW, task,
+                (uint16_t) (dropped > 0xFFFF ? 0xFFFF : dropped));
+      dropped = 0;
+    }
+  ring_put (DWT->CYCCNT, type, task, arg);
+
+  __set_PRIMASK (primask);
+}
+
+void
+freertos_trace_task_create (uint8_t task, const char* name)
+{
+  freertos_trace_record (FREERTOS_TRACE_TASK_CREATE,
+                         freertos_trace_current_task, task);
+
+  // The name follows, 4 characters per record, with the offset in arg.
+  for (uint32_t offset = 0; offset < configMAX_TASK_NAME_LEN; offset += 4)
+    {
+      uint32_t chars = 0;
+      uint32_t i;
+      for (i = 0; i < 4 && name[offset + i] != '\0'; ++i)
+        {
+          chars |= ((uint32_t) (uint8_t) name[offset + i]) << (8 * i);
+        }
+
+      uint32_t primask = __get_PRIMASK ();
+      __disable_irq ();
+      ring_put (chars, FREERTOS_TRACE_TASK_NAME, task, (uint16_t) offset);
+      __set_PRIMASK (primask);
+
+      if (i < 4)
+        {
+          break;
+        }
+    }
+}
+
+void
+freertos_trace_isr_enter (void)
+{
+  freertos_trace_record (FREERTOS_TRACE_ISR_ENTER, freertos_trace_current_task,
+                         (uint16_t) (__get_IPSR () & 0x1FF));
+}
+
+void
+freertos_trace_isr_exit (void)
+{
+  freertos_trace_record (FREERTOS_TRACE_ISR_EXIT, freertos_trace_current_task,
+                         (uint16_t) (__get_IPSR () & 0x1FF));
+}
+
+// ----------------------------------------------------------------------------
+
+#if defined(OS_USE_TRACE_ITM)
+
+static void
+drain_write (const freertos_trace_record_t* records, uint32_t count)
+{
+  if (((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0)
+      || ((ITM->TER & (1UL << OS_INTEGER_FREERTOS_TRACE_ITM_PORT)) == 0))
+    {
+      return;
+    }
+
+  const uint32_t* words = (const uint32_t*) records;
+  for (uint32_t i = 0; i < count * 2; ++i)
+    {
+      while (ITM->PORT[OS_INTEGER_FREERTOS_TRACE_ITM_PORT].u32 == 0)
+        ;
+      ITM->PORT[OS_INTEGER_FREERTOS_TRACE_ITM_PORT].u32 = words[i];
+    }
+}
+
+#else
+
+static void
+drain_write (const freertos_trace_record_t* records, uint32_t count)
+{
+  static int handle;
+  void* block[3];
+
+  if (handle == 0)
+    {
+      block[0] = OS_STRING_FREERTOS_TRACE_FILE;
+      block[1] = (void*) 5; // mode "wb"
+      block[2] = (void*) (sizeof(OS_STRING_FREERTOS_TRACE_FILE) - 1);
+
+      int ret = call_host (SEMIHOSTING_SYS_OPEN, (void*) block);
+      if (ret == -1)
+        {
+          handle = -1;
+        }
+      else
+        {
+          handle = ret;
+        }
+    }
+
+  if (handle == -1)
+    {
+      return;
+    }
+
+  block[0] = (void*) handle;
+  block[1] = (void*) records;
+  block[2] = (void*) (count * sizeof(freertos_trace_record_t));
+  call_host (SEMIHOSTING_SYS_WRITE, (void*) block);
+}
+
+#endif // defined(OS_USE_TRACE_ITM)
+
+void
+freertos_trace_drain (void)
+{
+  uint32_t tail = ring_tail;
+  uint32_t head = ring_head;
+
+  while (tail != head)
+    {
+      // Write the contiguous part, up to the end of the ring.
+      uint32_t index = tail & TRACE_MASK;
+      uint32_t count = head - tail;
+      if (count > OS_INTEGER_FREERTOS_TRACE_RECORDS - index)
+        {
+          count = OS_INTEGER_FREERTOS_TRACE_RECORDS - index;
+        }
+
+      drain_write (&ring[index], count);
+
+      // Not in the ring, so it is never dropped or overwritten.
+      freertos_trace_record_t checksum =
+        { crc32 (&ring[index], count * sizeof(freertos_trace_record_t)),
+            FREERTOS_TRACE_CHECKSUM, 0, (uint16_t) count };
+      drain_write (&checksum, 1);
+
+      tail += count;
+      ring_tail = tail;
+      head = ring_head;
+    }
+}
+
+bool
+freertos_trace_pending (void)
+{
+  return ring_head != ring_tail;
+}
+
+#endif // defined(OS_USE_FREERTOS_TRACE)
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,166 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "heap_benchmark.h"
+#include "task.h"
+#include "diag/Trace.h"
+#include "cmsis_device.h"
+
+#if defined(OS_BENCHMARK_HEAP)
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+#error "The heap benchmark needs a heap"
+#endif
+
+// ----------------------------------------------------------------------------
+
+typedef struct
+{
+  uint32_t min;
+  uint32_t max;
+  uint32_t count;
+  uint64_t sum;
+} op_stats_t;
+
+static void
+op_stats_init (op_stats_t* stats)
+{
+  stats->min = 0xFFFFFFFF;
+  stats->max = 0;
+  stats->count = 0;
+  stats->sum = 0;
+}
+
+static void
+op_stats_add (op_stats_t* stats, uint32_t cycles)
+{
+  if (cycles < stats->min)
+    {
+      stats->min = cycles;
+    }
+  if (cycles > stats->max)
+    {
+      stats->max = cycles;
+    }
+  stats->sum += cycles;
+  stats->count++;
+}
+
+static void
+op_stats_print (const char* name, const op_stats_t* stats)
+{
+  if (stats->count == 0)
+    {
+      trace_printf ("  %s: none\n", name);
+      return;
+    }
+  trace_printf ("  %s: %u calls, min %u, avg %u, max %u cycles\n", name,
+                stats->count, stats->min,
+                (uint32_t) (stats->sum / stats->count), stats->max);
+}
+
+static uint32_t
+xorshift32 (uint32_t* state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// ----------------------------------------------------------------------------
+
+static void
+heap_benchmark_task_function (void* parms __attribute__((unused)))
+{
+  static void* slots[OS_INTEGER_BENCHMARK_HEAP_SLOTS];
+  op_stats_t malloc_stats;
+  op_stats_t free_stats;
+  uint32_t failures = 0;
+  uint32_t seed = 0x2545F491;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  op_stats_init (&malloc_stats);
+  op_stats_init (&free_stats);
+
+  for (uint32_t step = 0; step < OS_INTEGER_BENCHMARK_HEAP_STEPS; ++step)
+    {
+      uint32_t k = xorshift32 (&seed) % OS_INTEGER_BENCHMARK_HEAP_SLOTS;
+      uint32_t r = xorshift32 (&seed);
+
+      if (slots[k] != NULL)
+        {
+#if (configHEAP_IMPLEMENTATION != 1)
+          uint32_t begin = DWT->CYCCNT;
+          vPortFree (slots[k]);
+          op_stats_add (&free_stats, DWT->CYCCNT - begin);
+          slots[k] = NULL;
+#endif
+        }
+      else
+        {
+          // Mostly small messages, with an occasional large buffer.
+          size_t size = 8 + (r % (OS_INTEGER_BENCHMARK_HEAP_MAX_SIZE - 7));
+          if ((r >> 24) < 16)
+            {
+              size *= 4;
+            }
+
+          uint32_t begin = DWT->CYCCNT;
+          void* p = pvPortMalloc (size);
+          op_stats_add (&malloc_stats, DWT->CYCCNT - begin);
+
+          if (p == NULL)
+            {
+              ++failures;
+            }
+          else
+            {
+              slots[k] = p;
+            }
+        }
+    }
+
+  trace_printf ("heap_%d, %u steps, %u failed allocations\n",
+                configHEAP_IMPLEMENTATION, OS_INTEGER_BENCHMARK_HEAP_STEPS,
+                failures);
+  op_stats_print ("malloc", &malloc_stats);
+  op_stats_print ("free", &free_stats);
+
+#if (configHEAP_IMPLEMENTATION != 3)
+  trace_printf ("  free heap %u bytes", xPortGetFreeHeapSize ());
+#if (configHEAP_IMPLEMENTATION >= 4)
+  trace_printf (", minimum ever %u bytes", xPortGetMinimumEverFreeHeapSize ());
+#endif
+  trace_printf ("\n");
+#endif
+
+#if (configHEAP_IMPLEMENTATION != 1)
+  for (uint32_t k = 0; k < OS_INTEGER_BENCHMARK_HEAP_SLOTS; ++k)
+    {
+      vPortFree (slots[k]);
+      slots[k] = NULL;
+    }
+#endif
+
+  vTaskDelete (NULL);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+heap_benchmark_start (UBaseType_t priority)
+{
+  xTaskCreate(heap_benchmark_task_function, "heapbench",
+              configMINIMAL_STACK_SIZE, NULL, priority, NULL);
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(OS_BENCHMARK_HEAP)
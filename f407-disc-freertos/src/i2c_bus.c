@@ -0,0 +1,474 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "bus_transfer.h"
+#include "cmsis_device.h"
+#include "stm32f4xx_hal.h"
+
+// ----------------------------------------------------------------------------
+
+// The I2C1 master, with the DMA end of transfer and the event
+// interrupts driving the state machine:
+//
+// - SB: send the address, with the direction bit;
+// - ADDR: before clearing it, enable or disable the ACK; for a one byte
+//   read the NACK and the STOP must be set around the ADDR clear;
+// - BTF, writing: the last byte is out; repeated START for the read,
+//   or STOP;
+// - RX DMA complete: the last byte is in; the hardware sent the NACK
+//   (CR2 LAST); STOP.
+//
+// Any error (NACK, bus error, lost arbitration) ends the transfer with
+// a STOP.
+
+// DMA1, channel 1.
+#define I2C_RX_STREAM           (DMA1_Stream0)
+#define I2C_TX_STREAM           (DMA1_Stream7)
+#define I2C_DMA_CHANNEL         (1u << 25)
+
+#define I2C_RX_FLAGS \
+  (DMA_LISR_TCIF0 | DMA_LISR_HTIF0 | DMA_LISR_TEIF0 | DMA_LISR_DMEIF0 \
+      | DMA_LISR_FEIF0)
+#define I2C_TX_FLAGS \
+  (DMA_HISR_TCIF7 | DMA_HISR_HTIF7 | DMA_HISR_TEIF7 | DMA_HISR_DMEIF7 \
+      | DMA_HISR_FEIF7)
+
+#define I2C_ERROR_FLAGS \
+  (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT)
+
+// A STOP takes a few bit times, 10 us at 100 kHz. In the interrupt
+// handlers and with the interrupts disabled, the wait for it is
+// bounded to I2C_STOP_BITS bit times, a few more at most (an
+// iteration reads two APB1 registers, 4 cycles or more); if the bus is
+// still busy, the queue stops, and a task waits longer,
+// I2C_RELEASE_LOOPS, well over 100 us, then resets the peripheral
+// (recover()).
+#define I2C_STOP_BITS           (2)
+#define I2C_STOP_LOOPS \
+  (SystemCoreClock / OS_INTEGER_I2C_BUS_SPEED_HZ * I2C_STOP_BITS / 4)
+#define I2C_RELEASE_LOOPS       (SystemCoreClock / 10000)
+
+// The bus states; out of I2C_BUS_READY, the head is queued, not
+// started.
+#define I2C_BUS_READY           (0)
+#define I2C_BUS_STUCK           (1)
+#define I2C_BUS_RECOVERING      (2)
+
+// The transfer in progress is the head.
+static bus_transfer_t* volatile queue_head;
+static bus_transfer_t* queue_tail;
+static volatile uint8_t bus_state;
+
+static void
+configure (void);
+
+// ----------------------------------------------------------------------------
+
+void
+i2c_bus_init (void)
+{
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN | RCC_AHB1ENR_DMA1EN;
+  RCC->APB1ENR |= RCC_APB1ENR_I2C1EN;
+
+  GPIO_InitTypeDef GPIO_InitStructure;
+
+  // SCL, SDA; the board has the pull-ups.
+  GPIO_InitStructure.Pin = GPIO_PIN_6 | GPIO_PIN_9;
+  GPIO_InitStructure.Mode = GPIO_MODE_AF_OD;
+  GPIO_InitStructure.Speed = GPIO_SPEED_FAST;
+  GPIO_InitStructure.Pull = GPIO_NOPULL;
+  GPIO_InitStructure.Alternate = GPIO_AF4_I2C1;
+  HAL_GPIO_Init (GPIOB, &GPIO_InitStructure);
+
+  I2C_RX_STREAM->CR = 0;
+  I2C_TX_STREAM->CR = 0;
+  DMA1->LIFCR = I2C_RX_FLAGS;
+  DMA1->HIFCR = I2C_TX_FLAGS;
+
+  configure ();
+
+  // Below configMAX_SYSCALL_INTERRUPT_PRIORITY, so they may use the
+  // FromISR() API; the TX stream interrupts only on errors.
+  uint32_t priority = (configMAX_SYSCALL_INTERRUPT_PRIORITY
+      >> (8 - __NVIC_PRIO_BITS)) + 1;
+  NVIC_SetPriority (I2C1_EV_IRQn, priority);
+  NVIC_SetPriority (I2C1_ER_IRQn, priority);
+  NVIC_SetPriority (DMA1_Stream0_IRQn, priority);
+  NVIC_SetPriority (DMA1_Stream7_IRQn, priority);
+  NVIC_EnableIRQ (I2C1_EV_IRQn);
+  NVIC_EnableIRQ (I2C1_ER_IRQn);
+  NVIC_EnableIRQ (DMA1_Stream0_IRQn);
+  NVIC_EnableIRQ (DMA1_Stream7_IRQn);
+}
+
+// Reset the peripheral and set the timing; also used to recover a
+// bus which does not return to idle.
+static void
+configure (void)
+{
+  I2C1->CR1 = I2C_CR1_SWRST;
+  I2C1->CR1 = 0;
+
+  uint32_t pclk1 = HAL_RCC_GetPCLK1Freq ();
+  uint32_t mhz = pclk1 / 1000000;
+
+  I2C1->CR2 = mhz | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN | I2C_CR2_DMAEN
+      | I2C_CR2_LAST;
+
+#if OS_INTEGER_I2C_BUS_SPEED_HZ <= 100000
+  // Standard mode, 1000 ns maximum rise time.
+  uint32_t ccr = pclk1 / (2 * OS_INTEGER_I2C_BUS_SPEED_HZ);
+  I2C1->CCR = (ccr < 4) ? 4 : ccr;
+  I2C1->TRISE = mhz + 1;
+#elif OS_INTEGER_I2C_BUS_SPEED_HZ <= 400000
+  // Fast mode, duty 2, 300 ns maximum rise time.
+  uint32_t ccr = pclk1 / (3 * OS_INTEGER_I2C_BUS_SPEED_HZ);
+  I2C1->CCR = I2C_CCR_FS | ((ccr < 1) ? 1 : ccr);
+  I2C1->TRISE = mhz * 300 / 1000 + 1;
+#else
+#error "OS_INTEGER_I2C_BUS_SPEED_HZ above 400 kHz"
+#endif
+
+  I2C1->CR1 = I2C_CR1_PE;
+}
+
+// Wait, at most loops iterations, for the STOP to be out and the bus
+// idle.
+static bool
+bus_released (uint32_t loops)
+{
+  for (uint32_t i = 0; i < loops; ++i)
+    {
+      if ((I2C1->CR1 & I2C_CR1_STOP) == 0
+          && (I2C1->SR2 & I2C_SR2_BUSY) == 0)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+static void
+start_phase (bus_transfer_t* t)
+{
+  if (t->reading)
+    {
+      DMA1->LIFCR = I2C_RX_FLAGS;
+      I2C_RX_STREAM->PAR = (uint32_t) &I2C1->DR;
+      I2C_RX_STREAM->M0AR = (uint32_t) t->rx;
+      I2C_RX_STREAM->NDTR = t->rx_length;
+      I2C_RX_STREAM->CR = I2C_DMA_CHANNEL | DMA_SxCR_PL_1 | DMA_SxCR_MINC
+          | DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_EN;
+    }
+  else
+    {
+      // The end of the write is seen by BTF, not by the DMA.
+      DMA1->HIFCR = I2C_TX_FLAGS;
+      I2C_TX_STREAM->PAR = (uint32_t) &I2C1->DR;
+      I2C_TX_STREAM->M0AR = (uint32_t) t->tx;
+      I2C_TX_STREAM->NDTR = t->tx_length;
+      I2C_TX_STREAM->CR = I2C_DMA_CHANNEL | DMA_SxCR_DIR_0 | DMA_SxCR_MINC
+          | DMA_SxCR_TEIE | DMA_SxCR_EN;
+    }
+
+  I2C1->CR1 |= I2C_CR1_START;
+}
+
+// Interrupts masked.
+static void
+start (bus_transfer_t* t)
+{
+  if (bus_state != I2C_BUS_READY)
+    {
+      // Started by recover().
+      return;
+    }
+
+  // The STOP of the previous transfer takes a bit time on the bus;
+  // START is ignored until it is out.
+  if (!bus_released (I2C_STOP_LOOPS))
+    {
+      bus_state = I2C_BUS_STUCK;
+      return;
+    }
+
+  start_phase (t);
+}
+
+// Called by the tasks, outside the critical sections. If a STOP did not
+// release the bus (bus held, or not emulated), wait longer for it,
+// reset the peripheral if it is still busy, and start the head of the
+// queue.
+static void
+recover (void)
+{
+  if (bus_state != I2C_BUS_STUCK || __get_IPSR () != 0)
+    {
+      return;
+    }
+
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+  bool claimed = (bus_state == I2C_BUS_STUCK);
+  if (claimed)
+    {
+      bus_state = I2C_BUS_RECOVERING;
+    }
+  __set_PRIMASK (primask);
+
+  if (!claimed)
+    {
+      return;
+    }
+
+  // No transfer runs, the peripheral raises no interrupts.
+  if (!bus_released (I2C_RELEASE_LOOPS))
+    {
+      configure ();
+    }
+
+  primask = __get_PRIMASK ();
+  __disable_irq ();
+  bus_state = I2C_BUS_READY;
+  if (queue_head != NULL)
+    {
+      start (queue_head);
+    }
+  __set_PRIMASK (primask);
+}
+
+static void
+stop_streams (void)
+{
+  I2C_RX_STREAM->CR = 0;
+  I2C_TX_STREAM->CR = 0;
+  while ((I2C_RX_STREAM->CR | I2C_TX_STREAM->CR) & DMA_SxCR_EN)
+    ;
+  DMA1->LIFCR = I2C_RX_FLAGS;
+  DMA1->HIFCR = I2C_TX_FLAGS;
+}
+
+// Called from the interrupt handlers, for the transfer at the head.
+static void
+complete (bus_transfer_t* t, uint8_t state)
+{
+  stop_streams ();
+
+  // Start the next transfer before the notification, the callback
+  // may queue more.
+  queue_head = t->next;
+  if (queue_head != NULL)
+    {
+      start (queue_head);
+    }
+
+  BaseType_t woken = pdFALSE;
+  bus_transfer_finish (t, state, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void
+i2c_bus_submit (bus_transfer_t* transfer, uint16_t device, const void* tx,
+                size_t tx_length, void* rx, size_t rx_length,
+                bus_callback_t callback, void* arg)
+{
+  bus_transfer_prepare (transfer, device, tx, tx_length, rx, rx_length,
+                        callback, arg);
+  if (tx_length == 0 && rx_length == 0)
+    {
+      BaseType_t woken = pdFALSE;
+      bus_transfer_finish (transfer, BUS_TRANSFER_DONE, &woken);
+      return;
+    }
+
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (queue_head == NULL)
+    {
+      queue_head = transfer;
+      queue_tail = transfer;
+      start (transfer);
+    }
+  else
+    {
+      queue_tail->next = transfer;
+      queue_tail = transfer;
+    }
+
+  __set_PRIMASK (primask);
+
+  recover ();
+}
+
+bool
+i2c_bus_cancel (bus_transfer_t* transfer)
+{
+  bool cancelled = false;
+
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (transfer->state == BUS_TRANSFER_PENDING)
+    {
+      if (transfer == queue_head)
+        {
+          // Out of I2C_BUS_READY, the head was not started.
+          if (bus_state == I2C_BUS_READY)
+            {
+              stop_streams ();
+              if (I2C1->SR2 & I2C_SR2_MSL)
+                {
+                  I2C1->CR1 |= I2C_CR1_STOP;
+                }
+              // A START still waiting for the bus; a STOP which does
+              // not complete stops the queue (start()).
+              I2C1->CR1 &= ~I2C_CR1_START;
+              NVIC_ClearPendingIRQ (I2C1_EV_IRQn);
+              NVIC_ClearPendingIRQ (I2C1_ER_IRQn);
+              NVIC_ClearPendingIRQ (DMA1_Stream0_IRQn);
+              NVIC_ClearPendingIRQ (DMA1_Stream7_IRQn);
+            }
+
+          queue_head = transfer->next;
+          if (queue_head != NULL)
+            {
+              start (queue_head);
+            }
+        }
+      else
+        {
+          bus_transfer_unlink (queue_head, &queue_tail, transfer);
+        }
+      transfer->state = BUS_TRANSFER_CANCELLED;
+      cancelled = true;
+    }
+
+  __set_PRIMASK (primask);
+
+  recover ();
+  return cancelled;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+I2C1_EV_IRQHandler (void);
+
+void
+I2C1_ER_IRQHandler (void);
+
+void
+DMA1_Stream0_IRQHandler (void);
+
+void
+DMA1_Stream7_IRQHandler (void);
+
+void
+I2C1_EV_IRQHandler (void)
+{
+  bus_transfer_t* t = queue_head;
+  uint32_t sr1 = I2C1->SR1;
+
+  if (t == NULL)
+    {
+      return;
+    }
+
+  if (sr1 & I2C_SR1_SB)
+    {
+      I2C1->DR = (uint8_t) ((t->device << 1) | t->reading);
+    }
+  else if (sr1 & I2C_SR1_ADDR)
+    {
+      // Reading SR1, then SR2, clears ADDR.
+      if (t->reading && t->rx_length == 1)
+        {
+          I2C1->CR1 &= ~I2C_CR1_ACK;
+          (void) I2C1->SR2;
+          I2C1->CR1 |= I2C_CR1_STOP;
+        }
+      else
+        {
+          if (t->reading)
+            {
+              I2C1->CR1 |= I2C_CR1_ACK;
+            }
+          (void) I2C1->SR2;
+        }
+    }
+  else if ((sr1 & I2C_SR1_BTF) && !t->reading)
+    {
+      if (t->rx_length != 0)
+        {
+          // Repeated start, it also clears BTF.
+          t->reading = 1;
+          start_phase (t);
+        }
+      else
+        {
+          I2C1->CR1 |= I2C_CR1_STOP;
+          complete (t, BUS_TRANSFER_DONE);
+        }
+    }
+  // While reading, BTF is only set until the DMA reads DR.
+}
+
+void
+I2C1_ER_IRQHandler (void)
+{
+  uint32_t errors = I2C1->SR1 & I2C_ERROR_FLAGS;
+  I2C1->SR1 = ~errors & 0xFFFF;
+
+  bus_transfer_t* t = queue_head;
+  if (t == NULL || errors == 0)
+    {
+      return;
+    }
+
+  I2C1->CR1 |= I2C_CR1_STOP;
+  complete (t, BUS_TRANSFER_ERROR);
+}
+
+void
+DMA1_Stream0_IRQHandler (void)
+{
+  uint32_t flags = DMA1->LISR & I2C_RX_FLAGS;
+  DMA1->LIFCR = flags;
+
+  bus_transfer_t* t = queue_head;
+  if (t == NULL || (flags & (DMA_LISR_TCIF0 | DMA_LISR_TEIF0)) == 0)
+    {
+      return;
+    }
+
+  // For one byte the STOP was set at ADDR.
+  if (t->rx_length != 1 || (flags & DMA_LISR_TEIF0))
+    {
+      I2C1->CR1 |= I2C_CR1_STOP;
+    }
+
+  complete (
+      t, (flags & DMA_LISR_TEIF0) ? BUS_TRANSFER_ERROR : BUS_TRANSFER_DONE);
+}
+
+// Only the errors; the end of the write is seen by BTF.
+void
+DMA1_Stream7_IRQHandler (void)
+{
+  uint32_t flags = DMA1->HISR & DMA_HISR_TEIF7;
+  DMA1->HIFCR = flags;
+
+  bus_transfer_t* t = queue_head;
+  if (t == NULL || flags == 0)
+    {
+      return;
+    }
+
+  I2C1->CR1 |= I2C_CR1_STOP;
+  complete (t, BUS_TRANSFER_ERROR);
+}
+
+// ----------------------------------------------------------------------------
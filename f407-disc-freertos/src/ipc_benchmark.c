@@ -0,0 +1,400 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "ipc_benchmark.h"
+#include "freertos_static.h"
+#include "spsc_ring.h"
+#include "task.h"
+#include "queue.h"
+#include "diag/Trace.h"
+#include "cmsis_device.h"
+
+#if defined(OS_BENCHMARK_IPC)
+
+// ----------------------------------------------------------------------------
+
+#define MESSAGE_QUEUE_LENGTH    (8)
+#define BYTE_QUEUE_LENGTH       (64)
+
+// An unused peripheral interrupt, pended by software.
+#define IPC_IRQn                TIM7_IRQn
+
+typedef struct
+{
+  uint32_t seq;
+  uint32_t stamp;
+  uint32_t payload[2];
+} ipc_message_t;
+
+typedef struct
+{
+  const char* name;
+  void
+  (*send) (const ipc_message_t* msg);
+  void
+  (*send_from_isr) (const ipc_message_t* msg, BaseType_t* woken);
+  void
+  (*receive) (ipc_message_t* msg);
+  // The consumer polls, at the producer priority.
+  uint32_t polled;
+  // Only the stamp is transferred.
+  uint32_t stamp_only;
+} ipc_case_t;
+
+typedef struct
+{
+  uint32_t min;
+  uint32_t max;
+  uint32_t errors;
+  uint32_t end;
+} ipc_stats_t;
+
+static const ipc_case_t* volatile current_case;
+static ipc_stats_t stats;
+
+static TaskHandle_t volatile producer_handle;
+static TaskHandle_t volatile consumer_handle;
+
+static QueueHandle_t message_queue;
+static QueueHandle_t byte_queue;
+
+static spsc_ring_t ring;
+static uint8_t ring_buffer[OS_INTEGER_BENCHMARK_IPC_RING_SIZE];
+
+// The message the ISR sends; written by the producer before pending
+// the interrupt.
+static ipc_message_t isr_message;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static uint8_t message_queue_buffer[queueSTATIC_BUFFER_SIZE(
+    MESSAGE_QUEUE_LENGTH, sizeof(ipc_message_t))];
+static uint8_t byte_queue_buffer[queueSTATIC_BUFFER_SIZE(BYTE_QUEUE_LENGTH,
+                                                         1)];
+static StackType_t consumer_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t consumer_buffer;
+static StackType_t producer_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t producer_buffer;
+#endif
+
+// ----- Queue of messages ----------------------------------------------------
+
+static void
+queue_send (const ipc_message_t* msg)
+{
+  xQueueSend(message_queue, msg, portMAX_DELAY);
+}
+
+static void
+queue_send_from_isr (const ipc_message_t* msg, BaseType_t* woken)
+{
+  xQueueSendFromISR(message_queue, msg, woken);
+}
+
+static void
+queue_receive (ipc_message_t* msg)
+{
+  xQueueReceive(message_queue, msg, portMAX_DELAY);
+}
+
+// ----- Queue of bytes -------------------------------------------------------
+
+static void
+byte_queue_send (const ipc_message_t* msg)
+{
+  const uint8_t* p = (const uint8_t*) msg;
+  for (uint32_t i = 0; i < sizeof(ipc_message_t); ++i)
+    {
+      xQueueSend(byte_queue, p + i, portMAX_DELAY);
+    }
+}
+
+static void
+byte_queue_send_from_isr (const ipc_message_t* msg, BaseType_t* woken)
+{
+  const uint8_t* p = (const uint8_t*) msg;
+  for (uint32_t i = 0; i < sizeof(ipc_message_t); ++i)
+    {
+      xQueueSendFromISR(byte_queue, p + i, woken);
+    }
+}
+
+static void
+byte_queue_receive (ipc_message_t* msg)
+{
+  uint8_t* p = (uint8_t*) msg;
+  for (uint32_t i = 0; i < sizeof(ipc_message_t); ++i)
+    {
+      xQueueReceive(byte_queue, p + i, portMAX_DELAY);
+    }
+}
+
+// ----- Task notification ----------------------------------------------------
+
+static void
+notify_send (const ipc_message_t* msg)
+{
+  xTaskNotify(consumer_handle, msg->stamp, eSetValueWithOverwrite);
+}
+
+static void
+notify_send_from_isr (const ipc_message_t* msg, BaseType_t* woken)
+{
+  xTaskNotifyFromISR(consumer_handle, msg->stamp, eSetValueWithOverwrite,
+                     woken);
+}
+
+static void
+notify_receive (ipc_message_t* msg)
+{
+  xTaskNotifyWait (0, 0, &msg->stamp, portMAX_DELAY);
+}
+
+// ----- Ring plus notification -----------------------------------------------
+
+// The consumer is notified only when the ring goes from empty to
+// non-empty; it drains the ring before blocking again.
+
+static void
+ring_notify_send (const ipc_message_t* msg)
+{
+  uint32_t was_empty = (spsc_ring_count (&ring) == 0);
+  spsc_ring_write (&ring, msg, sizeof(ipc_message_t));
+  if (was_empty)
+    {
+      xTaskNotifyGive(consumer_handle);
+    }
+}
+
+static void
+ring_notify_send_from_isr (const ipc_message_t* msg, BaseType_t* woken)
+{
+  uint32_t was_empty = (spsc_ring_count (&ring) == 0);
+  spsc_ring_write (&ring, msg, sizeof(ipc_message_t));
+  if (was_empty)
+    {
+      vTaskNotifyGiveFromISR (consumer_handle, woken);
+    }
+}
+
+static void
+ring_notify_receive (ipc_message_t* msg)
+{
+  while (spsc_ring_count (&ring) < sizeof(ipc_message_t))
+    {
+      ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+    }
+  spsc_ring_read (&ring, msg, sizeof(ipc_message_t));
+}
+
+// ----- Polled ring ----------------------------------------------------------
+
+// The producer waits for space before sending, see producer_run().
+
+static void
+ring_send (const ipc_message_t* msg)
+{
+  spsc_ring_write (&ring, msg, sizeof(ipc_message_t));
+}
+
+static void
+ring_send_from_isr (const ipc_message_t* msg,
+                    BaseType_t* woken __attribute__((unused)))
+{
+  spsc_ring_write (&ring, msg, sizeof(ipc_message_t));
+}
+
+static void
+ring_receive (ipc_message_t* msg)
+{
+  while (spsc_ring_count (&ring) < sizeof(ipc_message_t))
+    {
+      taskYIELD();
+    }
+  spsc_ring_read (&ring, msg, sizeof(ipc_message_t));
+}
+
+// ----------------------------------------------------------------------------
+
+static const ipc_case_t cases[] =
+  {
+    { "queue, 16 B", queue_send, queue_send_from_isr, queue_receive, 0, 0 },
+    { "queue, bytes", byte_queue_send, byte_queue_send_from_isr,
+        byte_queue_receive, 0, 0 },
+    { "notification", notify_send, notify_send_from_isr, notify_receive, 0,
+        1 },
+    { "ring+notify", ring_notify_send, ring_notify_send_from_isr,
+        ring_notify_receive, 0, 0 },
+    { "ring, polled", ring_send, ring_send_from_isr, ring_receive, 1, 0 } };
+
+void
+TIM7_IRQHandler (void)
+{
+  BaseType_t woken = pdFALSE;
+
+  current_case->send_from_isr (&isr_message, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+static void
+consumer_task_function (void* parms __attribute__((unused)))
+{
+  const ipc_case_t* c = current_case;
+  ipc_message_t msg;
+
+  consumer_handle = xTaskGetCurrentTaskHandle ();
+
+  for (uint32_t seq = 0; seq < OS_INTEGER_BENCHMARK_IPC_MESSAGES; ++seq)
+    {
+      c->receive (&msg);
+
+      uint32_t latency = DWT->CYCCNT - msg.stamp;
+      if (latency < stats.min)
+        {
+          stats.min = latency;
+        }
+      if (latency > stats.max)
+        {
+          stats.max = latency;
+        }
+      if (!c->stamp_only && (msg.seq != seq || msg.payload[0] != ~seq))
+        {
+          stats.errors++;
+        }
+    }
+
+  stats.end = DWT->CYCCNT;
+  xTaskNotifyGive(producer_handle);
+
+  vTaskDelete (NULL);
+}
+
+static void
+run_case (const ipc_case_t* c, uint32_t from_isr, UBaseType_t priority)
+{
+  stats.min = 0xFFFFFFFF;
+  stats.max = 0;
+  stats.errors = 0;
+  current_case = c;
+  consumer_handle = NULL;
+  spsc_ring_init (&ring, ring_buffer, sizeof(ring_buffer));
+
+  UBaseType_t consumer_priority = c->polled ? priority : priority + 1;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (consumer_task_function, "ipcc", configMINIMAL_STACK_SIZE,
+                     NULL, consumer_priority, consumer_stack,
+                     &consumer_buffer);
+#else
+  xTaskCreate(consumer_task_function, "ipcc", configMINIMAL_STACK_SIZE, NULL,
+              consumer_priority, NULL);
+#endif
+  // Let the consumer start and block, or, if polled, store its handle.
+  while (consumer_handle == NULL)
+    {
+      taskYIELD();
+    }
+
+  uint32_t begin = DWT->CYCCNT;
+  for (uint32_t seq = 0; seq < OS_INTEGER_BENCHMARK_IPC_MESSAGES; ++seq)
+    {
+      if (c->polled)
+        {
+          while (spsc_ring_space (&ring) < sizeof(ipc_message_t))
+            {
+              taskYIELD();
+            }
+        }
+
+      if (from_isr)
+        {
+          isr_message.seq = seq;
+          isr_message.payload[0] = ~seq;
+          isr_message.payload[1] = 0;
+          isr_message.stamp = DWT->CYCCNT;
+          NVIC_SetPendingIRQ (IPC_IRQn);
+        }
+      else
+        {
+          ipc_message_t msg;
+          msg.seq = seq;
+          msg.payload[0] = ~seq;
+          msg.payload[1] = 0;
+          msg.stamp = DWT->CYCCNT;
+          c->send (&msg);
+        }
+    }
+
+  ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+
+  uint32_t per_message = (stats.end - begin)
+      / OS_INTEGER_BENCHMARK_IPC_MESSAGES;
+  trace_printf ("%-13s %-4s %5u cycles/msg, %7u msg/s, latency %u..%u,"
+                " %u errors\n",
+                c->name, from_isr ? "isr" : "task", per_message,
+                SystemCoreClock / per_message, stats.min, stats.max,
+                stats.errors);
+
+  // Let the idle task free the consumer stack.
+  vTaskDelay (2);
+}
+
+static void
+ipc_benchmark_task_function (void* parms)
+{
+  UBaseType_t priority = (UBaseType_t) parms;
+
+  producer_handle = xTaskGetCurrentTaskHandle ();
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  message_queue = xQueueCreateStatic (MESSAGE_QUEUE_LENGTH,
+                                      sizeof(ipc_message_t),
+                                      message_queue_buffer);
+  byte_queue = xQueueCreateStatic (BYTE_QUEUE_LENGTH, 1, byte_queue_buffer);
+#else
+  message_queue = xQueueCreate(MESSAGE_QUEUE_LENGTH, sizeof(ipc_message_t));
+  byte_queue = xQueueCreate(BYTE_QUEUE_LENGTH, 1);
+#endif
+
+  // Below configMAX_SYSCALL_INTERRUPT_PRIORITY, so it may use the
+  // FromISR() API.
+  NVIC_SetPriority (
+      IPC_IRQn,
+      (configMAX_SYSCALL_INTERRUPT_PRIORITY >> (8 - __NVIC_PRIO_BITS)) + 1);
+  NVIC_EnableIRQ (IPC_IRQn);
+
+  trace_printf ("IPC, %u messages of %u bytes\n",
+                OS_INTEGER_BENCHMARK_IPC_MESSAGES, sizeof(ipc_message_t));
+
+  for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+      run_case (&cases[i], 0, priority);
+      run_case (&cases[i], 1, priority);
+    }
+
+  NVIC_DisableIRQ (IPC_IRQn);
+
+  vTaskDelete (NULL);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+ipc_benchmark_start (UBaseType_t priority)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (ipc_benchmark_task_function, "ipcp",
+                     configMINIMAL_STACK_SIZE, (void*) priority, priority,
+                     producer_stack, &producer_buffer);
+#else
+  xTaskCreate(ipc_benchmark_task_function, "ipcp", configMINIMAL_STACK_SIZE,
+              (void*) priority, priority, NULL);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(OS_BENCHMARK_IPC)
@@ -14,6 +14,18 @@
 
 //#include "Timer.h"
 #include "BlinkLed.h"
+#include "button_task.h"
+#include "button_benchmark.h"
+#include "context_switch_benchmark.h"
+#include "freertos_static.h"
+#include "freertos_heap.h"
+#include "freertos_stack.h"
+#include "trace_rtos.h"
+#include "heap_benchmark.h"
+#include "ipc_benchmark.h"
+#include "crc32.h"
+#include "crc32_benchmark.h"
+#include "sensor_task.h"
 
 // ----------------------------------------------------------------------------
 //
@@ -59,9 +71,21 @@ ledTaskFunction (void* parms __attribute__((unused)))
 
       // Count seconds on the trace device.
       trace_printf ("Second %u\n", seconds);
+
+#if (configGENERATE_RUN_TIME_STATS == 1)
+      if ((seconds % 10) == 0)
+        {
+          freertos_run_time_stats_print ();
+        }
+#endif
     }
 
 }
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StackType_t ledTaskStack[256];
+static StaticTask_t ledTaskBuffer;
+#endif
+
 // ----- main() ---------------------------------------------------------------
 
 // Sample pragmas to cope with warnings. Please note the related line at
@@ -81,7 +105,61 @@ main (int argc, char* argv[])
   // at high speed.
   trace_printf ("System clock: %u Hz\n", SystemCoreClock);
 
+  crc32_init ();
+
+  // Check the flash image against the CRC stamped after the link.
+  int image = crc32_check_image ();
+  if (image == CRC32_IMAGE_NOT_STAMPED)
+    {
+      trace_puts ("Image CRC not stamped.");
+    }
+  else if (image != CRC32_IMAGE_OK)
+    {
+      trace_puts ("Image CRC mismatch, stopped.");
+      for (;;)
+        ;
+    }
+
+#if defined(OS_BENCHMARK_CRC32)
+  crc32_benchmark_run ();
+#endif
+
+  freertos_heap_init ();
+  trace_rtos_init ();
+
+#if defined(OS_USE_FREERTOS_STACK_PROFILE)
+  freertos_stack_profile_init ();
+  freertos_stack_profile_start (1);
+#endif
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (ledTaskFunction, "led", 256, NULL, 1, ledTaskStack,
+                     &ledTaskBuffer);
+#else
   xTaskCreate(ledTaskFunction, "led", 256, NULL, 1, NULL);
+#endif
+
+  button_task_start (2);
+
+#if defined(OS_USE_SENSOR_TASK)
+  sensor_task_start (2);
+#endif
+
+#if defined(OS_BENCHMARK_CONTEXT_SWITCH)
+  context_switch_benchmark_start (1);
+#endif
+
+#if defined(OS_BENCHMARK_HEAP)
+  heap_benchmark_start (2);
+#endif
+
+#if defined(OS_BENCHMARK_IPC)
+  ipc_benchmark_start (2);
+#endif
+
+#if defined(OS_BENCHMARK_BUTTON)
+  button_benchmark_start (configMAX_PRIORITIES - 1);
+#endif
 
   vTaskStartScheduler ();
 
@@ -0,0 +1,165 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "sensor_task.h"
+#include "bus_transfer.h"
+#include "task.h"
+#include "diag/Trace.h"
+#include "stm32f4xx_hal.h"
+
+#if defined(OS_USE_SENSOR_TASK)
+
+// ----------------------------------------------------------------------------
+
+// LIS3DSH, on SPI1, chip select PE3.
+#define ACCEL_CS                BUS_SPI_CS(4, 3)
+#define ACCEL_READ              (0x80)
+#define ACCEL_WHO_AM_I          (0x0F)
+#define ACCEL_CTRL_REG4         (0x20)
+#define ACCEL_OUT_X_L           (0x28)
+#define ACCEL_ID                (0x3F)
+// 100 Hz, X, Y, Z enabled.
+#define ACCEL_CTRL_REG4_VALUE   (0x67)
+
+// CS43L22, on I2C1, reset on PD4.
+#define AUDIO_ADDRESS           (0x4A)
+#define AUDIO_ID                (0x01)
+
+// Generous for a few bytes; a transfer still pending then is stuck
+// (bus held, or not emulated) and is cancelled.
+#define SENSOR_TIMEOUT_TICKS    (pdMS_TO_TICKS(10))
+
+// Static, the task stacks are in the CCM RAM. One descriptor per bus,
+// so a descriptor is never queued on both.
+static bus_transfer_t spi_transfer;
+static bus_transfer_t i2c_transfer;
+static uint8_t tx[2];
+static uint8_t rx[6];
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StackType_t sensor_stack[configMINIMAL_STACK_SIZE * 2];
+static StaticTask_t sensor_buffer;
+#endif
+
+// ----------------------------------------------------------------------------
+
+static int
+accel_wait (void)
+{
+  int state = bus_transfer_wait (&spi_transfer, SENSOR_TIMEOUT_TICKS);
+  if (state == BUS_TRANSFER_PENDING && spi_bus_cancel (&spi_transfer))
+    {
+      return BUS_TRANSFER_CANCELLED;
+    }
+  return spi_transfer.state;
+}
+
+static int
+accel_read (uint8_t reg, size_t length)
+{
+  tx[0] = reg | ACCEL_READ;
+  spi_bus_submit (&spi_transfer, ACCEL_CS, tx, 1, rx, length, NULL, NULL);
+  return accel_wait ();
+}
+
+static int
+accel_write (uint8_t reg, uint8_t value)
+{
+  tx[0] = reg;
+  tx[1] = value;
+  spi_bus_submit (&spi_transfer, ACCEL_CS, tx, 2, NULL, 0, NULL, NULL);
+  return accel_wait ();
+}
+
+static void
+audio_reset_release (void)
+{
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+
+  GPIO_InitTypeDef GPIO_InitStructure;
+
+  GPIO_InitStructure.Pin = GPIO_PIN_4;
+  GPIO_InitStructure.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStructure.Speed = GPIO_SPEED_FAST;
+  GPIO_InitStructure.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init (GPIOD, &GPIO_InitStructure);
+
+  HAL_GPIO_WritePin (GPIOD, GPIO_PIN_4, GPIO_PIN_SET);
+}
+
+static void
+sensor_task_function (void* parms __attribute__((unused)))
+{
+  spi_bus_init ();
+  spi_bus_add_device (ACCEL_CS);
+  i2c_bus_init ();
+
+  audio_reset_release ();
+  vTaskDelay (pdMS_TO_TICKS(1));
+
+  tx[0] = AUDIO_ID;
+  i2c_bus_submit (&i2c_transfer, AUDIO_ADDRESS, tx, 1, rx, 1, NULL, NULL);
+  if (bus_transfer_wait (&i2c_transfer, SENSOR_TIMEOUT_TICKS)
+      == BUS_TRANSFER_PENDING)
+    {
+      i2c_bus_cancel (&i2c_transfer);
+    }
+  if (i2c_transfer.state == BUS_TRANSFER_DONE)
+    {
+      trace_printf ("CS43L22 ID 0x%02X\n", rx[0]);
+    }
+  else
+    {
+      trace_puts ("CS43L22 not responding.");
+    }
+
+  if (accel_read (ACCEL_WHO_AM_I, 1) != BUS_TRANSFER_DONE
+      || rx[0] != ACCEL_ID)
+    {
+      trace_puts ("LIS3DSH not found.");
+      vTaskDelete (NULL);
+    }
+
+  accel_write (ACCEL_CTRL_REG4, ACCEL_CTRL_REG4_VALUE);
+
+  TickType_t wake = xTaskGetTickCount ();
+  uint32_t count = 0;
+
+  for (;;)
+    {
+      vTaskDelayUntil (&wake, pdMS_TO_TICKS(OS_INTEGER_SENSOR_PERIOD_MS));
+
+      // X, Y, Z, low byte first; the address auto-increments.
+      if (accel_read (ACCEL_OUT_X_L, 6) != BUS_TRANSFER_DONE)
+        {
+          continue;
+        }
+
+      if (++count % (1000 / OS_INTEGER_SENSOR_PERIOD_MS) == 0)
+        {
+          trace_printf ("Accel %d %d %d\n",
+                        (int16_t) (rx[0] | (rx[1] << 8)),
+                        (int16_t) (rx[2] | (rx[3] << 8)),
+                        (int16_t) (rx[4] | (rx[5] << 8)));
+        }
+    }
+}
+
+void
+sensor_task_start (UBaseType_t priority)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic (sensor_task_function, "sensor",
+                     configMINIMAL_STACK_SIZE * 2, NULL, priority,
+                     sensor_stack, &sensor_buffer);
+#else
+  xTaskCreate(sensor_task_function, "sensor", configMINIMAL_STACK_SIZE * 2,
+              NULL, priority, NULL);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(OS_USE_SENSOR_TASK)
@@ -0,0 +1,320 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "bus_transfer.h"
+#include "cmsis_device.h"
+#include "stm32f4xx_hal.h"
+
+// ----------------------------------------------------------------------------
+
+#if (OS_INTEGER_SPI_BUS_BAUD_DIV != 2) && (OS_INTEGER_SPI_BUS_BAUD_DIV != 4) \
+  && (OS_INTEGER_SPI_BUS_BAUD_DIV != 8) && (OS_INTEGER_SPI_BUS_BAUD_DIV != 16) \
+  && (OS_INTEGER_SPI_BUS_BAUD_DIV != 32) && (OS_INTEGER_SPI_BUS_BAUD_DIV != 64) \
+  && (OS_INTEGER_SPI_BUS_BAUD_DIV != 128) && (OS_INTEGER_SPI_BUS_BAUD_DIV != 256)
+#error "OS_INTEGER_SPI_BUS_BAUD_DIV must be a power of 2, 2 to 256"
+#endif
+
+#define SPI_BUS_BR \
+  (OS_INTEGER_SPI_BUS_BAUD_DIV == 2 ? 0 : OS_INTEGER_SPI_BUS_BAUD_DIV == 4 ? 1 \
+      : OS_INTEGER_SPI_BUS_BAUD_DIV == 8 ? 2 \
+      : OS_INTEGER_SPI_BUS_BAUD_DIV == 16 ? 3 \
+      : OS_INTEGER_SPI_BUS_BAUD_DIV == 32 ? 4 \
+      : OS_INTEGER_SPI_BUS_BAUD_DIV == 64 ? 5 \
+      : OS_INTEGER_SPI_BUS_BAUD_DIV == 128 ? 6 : 7)
+
+#define SPI_BUS_GPIOx(_N) \
+  ((GPIO_TypeDef *)(GPIOA_BASE + (GPIOB_BASE-GPIOA_BASE)*(_N)))
+
+// DMA2, channel 3.
+#define SPI_RX_STREAM           (DMA2_Stream2)
+#define SPI_TX_STREAM           (DMA2_Stream3)
+#define SPI_DMA_CHANNEL         (3u << 25)
+
+#define SPI_RX_FLAGS \
+  (DMA_LISR_TCIF2 | DMA_LISR_HTIF2 | DMA_LISR_TEIF2 | DMA_LISR_DMEIF2 \
+      | DMA_LISR_FEIF2)
+#define SPI_TX_FLAGS \
+  (DMA_LISR_TCIF3 | DMA_LISR_HTIF3 | DMA_LISR_TEIF3 | DMA_LISR_DMEIF3 \
+      | DMA_LISR_FEIF3)
+
+// The transfer in progress is the head.
+static bus_transfer_t* volatile queue_head;
+static bus_transfer_t* queue_tail;
+
+// Sent while reading, and received while writing.
+static const uint8_t dummy_tx = 0xFF;
+static uint8_t dummy_rx;
+
+// ----------------------------------------------------------------------------
+
+void
+spi_bus_init (void)
+{
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_DMA2EN;
+  RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
+
+  GPIO_InitTypeDef GPIO_InitStructure;
+
+  // SCK, MISO, MOSI.
+  GPIO_InitStructure.Pin = GPIO_PIN_5 | GPIO_PIN_6 | GPIO_PIN_7;
+  GPIO_InitStructure.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStructure.Speed = GPIO_SPEED_FAST;
+  GPIO_InitStructure.Pull = GPIO_NOPULL;
+  GPIO_InitStructure.Alternate = GPIO_AF5_SPI1;
+  HAL_GPIO_Init (GPIOA, &GPIO_InitStructure);
+
+  SPI_RX_STREAM->CR = 0;
+  SPI_TX_STREAM->CR = 0;
+  DMA2->LIFCR = SPI_RX_FLAGS | SPI_TX_FLAGS;
+
+  // Master, software chip select, 8-bits, MSB first; the DMA requests
+  // stay enabled, the streams start the transfers.
+  SPI1->CR1 = 0;
+  SPI1->CR2 = SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN;
+  SPI1->CR1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | (SPI_BUS_BR << 3)
+      | (OS_INTEGER_SPI_BUS_MODE & 3) | SPI_CR1_SPE;
+
+  // Below configMAX_SYSCALL_INTERRUPT_PRIORITY, so they may use the
+  // FromISR() API; the TX stream interrupts only on errors.
+  uint32_t priority = (configMAX_SYSCALL_INTERRUPT_PRIORITY
+      >> (8 - __NVIC_PRIO_BITS)) + 1;
+  NVIC_SetPriority (DMA2_Stream2_IRQn, priority);
+  NVIC_SetPriority (DMA2_Stream3_IRQn, priority);
+  NVIC_EnableIRQ (DMA2_Stream2_IRQn);
+  NVIC_EnableIRQ (DMA2_Stream3_IRQn);
+}
+
+void
+spi_bus_add_device (uint16_t device)
+{
+  uint32_t port = device >> 4;
+  uint32_t pin = device & 0xF;
+
+  RCC->AHB1ENR |= (RCC_AHB1ENR_GPIOAEN << port);
+  SPI_BUS_GPIOx(port)->BSRR = (1u << pin);
+
+  GPIO_InitTypeDef GPIO_InitStructure;
+
+  GPIO_InitStructure.Pin = (1u << pin);
+  GPIO_InitStructure.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStructure.Speed = GPIO_SPEED_FAST;
+  GPIO_InitStructure.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init (SPI_BUS_GPIOx(port), &GPIO_InitStructure);
+}
+
+static inline void
+__attribute__((always_inline))
+chip_select (uint16_t device, bool active)
+{
+  // Active low; BSRR high half resets.
+  SPI_BUS_GPIOx(device >> 4)->BSRR = (1u << (device & 0xF)) << (active ? 16 : 0);
+}
+
+// Both streams run for the same number of bytes; the RX stream ends
+// last, when the last byte is completely shifted.
+static void
+start_phase (bus_transfer_t* t)
+{
+  const uint8_t* tx;
+  uint8_t* rx;
+  uint16_t n;
+  uint32_t tx_minc = 0;
+  uint32_t rx_minc = 0;
+
+  if (t->reading)
+    {
+      tx = &dummy_tx;
+      rx = t->rx;
+      rx_minc = DMA_SxCR_MINC;
+      n = t->rx_length;
+    }
+  else
+    {
+      tx = t->tx;
+      tx_minc = DMA_SxCR_MINC;
+      rx = &dummy_rx;
+      n = t->tx_length;
+    }
+
+  DMA2->LIFCR = SPI_RX_FLAGS | SPI_TX_FLAGS;
+
+  SPI_RX_STREAM->PAR = (uint32_t) &SPI1->DR;
+  SPI_RX_STREAM->M0AR = (uint32_t) rx;
+  SPI_RX_STREAM->NDTR = n;
+  SPI_RX_STREAM->CR = SPI_DMA_CHANNEL | DMA_SxCR_PL_1 | rx_minc | DMA_SxCR_TCIE
+      | DMA_SxCR_TEIE | DMA_SxCR_EN;
+
+  SPI_TX_STREAM->PAR = (uint32_t) &SPI1->DR;
+  SPI_TX_STREAM->M0AR = (uint32_t) tx;
+  SPI_TX_STREAM->NDTR = n;
+  SPI_TX_STREAM->CR = SPI_DMA_CHANNEL | DMA_SxCR_DIR_0 | tx_minc
+      | DMA_SxCR_TEIE | DMA_SxCR_EN;
+}
+
+// Stop both streams and drain the SPI, after an error or a cancel.
+static void
+abort_streams (void)
+{
+  SPI_RX_STREAM->CR = 0;
+  SPI_TX_STREAM->CR = 0;
+  while ((SPI_RX_STREAM->CR | SPI_TX_STREAM->CR) & DMA_SxCR_EN)
+    ;
+  DMA2->LIFCR = SPI_RX_FLAGS | SPI_TX_FLAGS;
+  NVIC_ClearPendingIRQ (DMA2_Stream2_IRQn);
+  NVIC_ClearPendingIRQ (DMA2_Stream3_IRQn);
+
+  // The byte in progress; a few SPI clocks at most.
+  for (uint32_t i = 0; i < 8 * 256 && (SPI1->SR & SPI_SR_BSY); ++i)
+    ;
+  // Reading DR, then SR, also clears an overrun.
+  (void) SPI1->DR;
+  (void) SPI1->SR;
+}
+
+static void
+start (bus_transfer_t* t)
+{
+  chip_select (t->device, true);
+  start_phase (t);
+}
+
+void
+spi_bus_submit (bus_transfer_t* transfer, uint16_t device, const void* tx,
+                size_t tx_length, void* rx, size_t rx_length,
+                bus_callback_t callback, void* arg)
+{
+  bus_transfer_prepare (transfer, device, tx, tx_length, rx, rx_length,
+                        callback, arg);
+  if (tx_length == 0 && rx_length == 0)
+    {
+      BaseType_t woken = pdFALSE;
+      bus_transfer_finish (transfer, BUS_TRANSFER_DONE, &woken);
+      return;
+    }
+
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (queue_head == NULL)
+    {
+      queue_head = transfer;
+      queue_tail = transfer;
+      start (transfer);
+    }
+  else
+    {
+      queue_tail->next = transfer;
+      queue_tail = transfer;
+    }
+
+  __set_PRIMASK (primask);
+}
+
+bool
+spi_bus_cancel (bus_transfer_t* transfer)
+{
+  bool cancelled = false;
+
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (transfer->state == BUS_TRANSFER_PENDING)
+    {
+      if (transfer == queue_head)
+        {
+          abort_streams ();
+          chip_select (transfer->device, false);
+          queue_head = transfer->next;
+          if (queue_head != NULL)
+            {
+              start (queue_head);
+            }
+        }
+      else
+        {
+          bus_transfer_unlink (queue_head, &queue_tail, transfer);
+        }
+      transfer->state = BUS_TRANSFER_CANCELLED;
+      cancelled = true;
+    }
+
+  __set_PRIMASK (primask);
+  return cancelled;
+}
+
+// ----------------------------------------------------------------------------
+
+// Called from the interrupt handlers, for the transfer at the head.
+static void
+complete (bus_transfer_t* t, uint8_t state)
+{
+  chip_select (t->device, false);
+
+  // Start the next transfer before the notification, the callback
+  // may queue more.
+  queue_head = t->next;
+  if (queue_head != NULL)
+    {
+      start (queue_head);
+    }
+
+  BaseType_t woken = pdFALSE;
+  bus_transfer_finish (t, state, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void
+DMA2_Stream2_IRQHandler (void);
+
+void
+DMA2_Stream3_IRQHandler (void);
+
+void
+DMA2_Stream2_IRQHandler (void)
+{
+  uint32_t flags = DMA2->LISR & SPI_RX_FLAGS;
+  DMA2->LIFCR = flags;
+
+  bus_transfer_t* t = queue_head;
+  if (t == NULL || (flags & (DMA_LISR_TCIF2 | DMA_LISR_TEIF2)) == 0)
+    {
+      return;
+    }
+
+  if (flags & DMA_LISR_TEIF2)
+    {
+      abort_streams ();
+      complete (t, BUS_TRANSFER_ERROR);
+    }
+  else if (!t->reading && t->rx_length != 0)
+    {
+      // The write is done, read with the chip select still low.
+      t->reading = 1;
+      start_phase (t);
+    }
+  else
+    {
+      complete (t, BUS_TRANSFER_DONE);
+    }
+}
+
+// Only the errors; the end of a phase is seen by the RX stream.
+void
+DMA2_Stream3_IRQHandler (void)
+{
+  uint32_t flags = DMA2->LISR & DMA_LISR_TEIF3;
+  DMA2->LIFCR = flags;
+
+  bus_transfer_t* t = queue_head;
+  if (t == NULL || flags == 0)
+    {
+      return;
+    }
+
+  abort_streams ();
+  complete (t, BUS_TRANSFER_ERROR);
+}
+
+// ----------------------------------------------------------------------------
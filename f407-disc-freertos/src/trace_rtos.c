@@ -0,0 +1,353 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "trace_rtos.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "freertos_static.h"
+#include "diag/Trace.h"
+#include "cmsis_device.h"
+
+#if defined(TRACE) \
+  && (defined(OS_USE_TRACE_TASK_BUFFERS) || defined(OS_USE_TRACE_MUTEX))
+
+// ----------------------------------------------------------------------------
+
+static volatile uint32_t ready;
+
+// Serialise only the threads; before the scheduler starts, and in
+// interrupt handlers, write directly.
+static inline uint32_t
+__attribute__((always_inline))
+trace_is_threaded (void)
+{
+  return ready && (__get_IPSR () == 0)
+      && (xTaskGetSchedulerState () == taskSCHEDULER_RUNNING);
+}
+
+// ----------------------------------------------------------------------------
+
+#if defined(OS_USE_TRACE_TASK_BUFFERS)
+
+#include "spsc_ring.h"
+
+_Static_assert(
+    (OS_INTEGER_TRACE_TASK_BUFFER_SIZE & (OS_INTEGER_TRACE_TASK_BUFFER_SIZE - 1)) == 0,
+    "OS_INTEGER_TRACE_TASK_BUFFER_SIZE must be a power of 2");
+
+// Each write is stored as a header followed by the bytes; longer
+// writes are split, so a record always fits in a ring.
+typedef struct
+{
+  uint32_t sequence;
+  uint32_t length;
+} record_header_t;
+
+#define RECORD_MAX_LENGTH \
+  (OS_INTEGER_TRACE_TASK_BUFFER_SIZE / 2 - sizeof(record_header_t))
+
+typedef struct
+{
+  spsc_ring_t ring;
+  TaskHandle_t owner;
+  // Written by the producer, and by the drain, respectively.
+  volatile uint32_t dropped;
+  uint32_t reported;
+  uint8_t buffer[OS_INTEGER_TRACE_TASK_BUFFER_SIZE];
+} trace_slot_t;
+
+// The last one is shared, by interrupt handlers and by the tasks that
+// found the pool empty.
+static trace_slot_t slots[OS_INTEGER_TRACE_TASK_BUFFERS + 1];
+
+#define SHARED_SLOT     (&slots[OS_INTEGER_TRACE_TASK_BUFFERS])
+
+static uint32_t sequence;
+
+void
+trace_rtos_init (void)
+{
+  for (uint32_t i = 0; i < sizeof(slots) / sizeof(slots[0]); ++i)
+    {
+      spsc_ring_init (&slots[i].ring, slots[i].buffer,
+                      sizeof(slots[i].buffer));
+    }
+  ready = 1;
+}
+
+static trace_slot_t*
+task_slot (void)
+{
+  trace_slot_t* slot = pvTaskGetThreadLocalStoragePointer (
+      NULL, OS_INTEGER_TRACE_TLS_INDEX);
+  if (slot != NULL)
+    {
+      return slot;
+    }
+
+  // First write of this task; the slot is given back when the task
+  // is deleted (trace_rtos_task_delete()).
+  slot = SHARED_SLOT;
+  taskENTER_CRITICAL();
+    {
+      for (uint32_t i = 0; i < OS_INTEGER_TRACE_TASK_BUFFERS; ++i)
+        {
+          if (slots[i].owner == NULL)
+            {
+              slots[i].owner = xTaskGetCurrentTaskHandle ();
+              slot = &slots[i];
+              break;
+            }
+        }
+    }
+  taskEXIT_CRITICAL();
+
+  vTaskSetThreadLocalStoragePointer (NULL, OS_INTEGER_TRACE_TLS_INDEX, slot);
+  return slot;
+}
+
+void
+trace_rtos_task_delete (void* task)
+{
+  // Its records still in the ring are written out as usual, before
+  // those of the next owner.
+  for (uint32_t i = 0; i < OS_INTEGER_TRACE_TASK_BUFFERS; ++i)
+    {
+      if (slots[i].owner == task)
+        {
+          slots[i].owner = NULL;
+          break;
+        }
+    }
+}
+
+static void
+put_record (trace_slot_t* slot, const char* buf, uint32_t length)
+{
+  record_header_t header;
+
+  header.sequence = __atomic_fetch_add (&sequence, 1, __ATOMIC_RELAXED);
+  header.length = length;
+
+  if (spsc_ring_space (&slot->ring) < sizeof(header) + length)
+    {
+      slot->dropped += length;
+      return;
+    }
+
+  // The drain takes a record only when all its bytes are in.
+  spsc_ring_write (&slot->ring, &header, sizeof(header));
+  spsc_ring_write (&slot->ring, buf, length);
+}
+
+ssize_t
+trace_write (const char* buf, size_t nbyte)
+{
+  if (!ready || xTaskGetSchedulerState () == taskSCHEDULER_NOT_STARTED)
+    {
+      return trace_write_device (buf, nbyte);
+    }
+
+  trace_slot_t* slot = (__get_IPSR () == 0) ? task_slot () : SHARED_SLOT;
+
+  for (size_t done = 0; done < nbyte;)
+    {
+      uint32_t length = nbyte - done;
+      if (length > RECORD_MAX_LENGTH)
+        {
+          length = RECORD_MAX_LENGTH;
+        }
+
+      if (slot == SHARED_SLOT)
+        {
+          // Several producers.
+          uint32_t primask = __get_PRIMASK ();
+          __disable_irq ();
+          put_record (slot, buf + done, length);
+          __set_PRIMASK (primask);
+        }
+      else
+        {
+          put_record (slot, buf + done, length);
+        }
+      done += length;
+    }
+
+  return nbyte;
+}
+
+static void
+report_dropped (uint32_t count)
+{
+  char text[40] = "[trace: ";
+  char digits[10];
+  uint32_t n = 0;
+  uint32_t len = 8;
+
+  do
+    {
+      digits[n++] = (char) ('0' + count % 10);
+      count /= 10;
+    }
+  while (count != 0);
+  while (n != 0)
+    {
+      text[len++] = digits[--n];
+    }
+
+  static const char suffix[] = " bytes dropped]\n";
+  for (uint32_t i = 0; i < sizeof(suffix) - 1; ++i)
+    {
+      text[len++] = suffix[i];
+    }
+  trace_write_device (text, len);
+}
+
+void
+trace_rtos_drain (void)
+{
+  for (;;)
+    {
+      // Take the complete record with the lowest sequence number
+      // from all rings; records still being written are left for
+      // the next time.
+      trace_slot_t* next = NULL;
+      record_header_t next_header = { 0, 0 };
+
+      for (uint32_t i = 0; i < sizeof(slots) / sizeof(slots[0]); ++i)
+        {
+          record_header_t header;
+          if (spsc_ring_peek (&slots[i].ring, &header, sizeof(header))
+              < sizeof(header))
+            {
+              continue;
+            }
+          if (spsc_ring_count (&slots[i].ring)
+              < sizeof(header) + header.length)
+            {
+              continue;
+            }
+          if (next == NULL
+              || (int32_t) (header.sequence - next_header.sequence) < 0)
+            {
+              next = &slots[i];
+              next_header = header;
+            }
+        }
+
+      if (next == NULL)
+        {
+          break;
+        }
+
+      spsc_ring_read (&next->ring, &next_header, sizeof(next_header));
+
+      char chunk[32];
+      for (uint32_t left = next_header.length; left != 0;)
+        {
+          uint32_t n = spsc_ring_read (
+              &next->ring, chunk, left < sizeof(chunk) ? left : sizeof(chunk));
+          trace_write_device (chunk, n);
+          left -= n;
+        }
+    }
+
+  for (uint32_t i = 0; i < sizeof(slots) / sizeof(slots[0]); ++i)
+    {
+      uint32_t dropped = slots[i].dropped;
+      if (dropped != slots[i].reported)
+        {
+          report_dropped (dropped - slots[i].reported);
+          slots[i].reported = dropped;
+        }
+    }
+}
+
+bool
+trace_rtos_pending (void)
+{
+  for (uint32_t i = 0; i < sizeof(slots) / sizeof(slots[0]); ++i)
+    {
+      if ((spsc_ring_count (&slots[i].ring) != 0)
+          || (slots[i].dropped != slots[i].reported))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+trace_lock (void)
+{
+}
+
+void
+trace_unlock (void)
+{
+}
+
+#endif // defined(OS_USE_TRACE_TASK_BUFFERS)
+
+// ----------------------------------------------------------------------------
+
+#if defined(OS_USE_TRACE_MUTEX)
+
+static SemaphoreHandle_t mutex;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticSemaphore_t mutex_buffer;
+#endif
+
+void
+trace_rtos_init (void)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  mutex = xSemaphoreCreateRecursiveMutexStatic (&mutex_buffer);
+#else
+  mutex = xSemaphoreCreateRecursiveMutex();
+#endif
+  ready = 1;
+}
+
+void
+trace_lock (void)
+{
+  if (trace_is_threaded ())
+    {
+      xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    }
+}
+
+void
+trace_unlock (void)
+{
+  if (trace_is_threaded ())
+    {
+      xSemaphoreGiveRecursive(mutex);
+    }
+}
+
+ssize_t
+trace_write (const char* buf, size_t nbyte)
+{
+  if (!trace_is_threaded ())
+    {
+      return trace_write_device (buf, nbyte);
+    }
+
+  xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+  ssize_t ret = trace_write_device (buf, nbyte);
+  xSemaphoreGiveRecursive(mutex);
+
+  return ret;
+}
+
+#endif // defined(OS_USE_TRACE_MUTEX)
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(TRACE) && (OS_USE_TRACE_TASK_BUFFERS || OS_USE_TRACE_MUTEX)
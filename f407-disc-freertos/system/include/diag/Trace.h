@@ -48,6 +48,12 @@ extern "C"
   ssize_t
   trace_write(const char* buf, size_t nbyte);
 
+#if defined(OS_USE_TRACE_TASK_BUFFERS) || defined(OS_USE_TRACE_MUTEX)
+  // The device output, when trace_write() is provided by the RTOS.
+  ssize_t
+  trace_write_device(const char* buf, size_t nbyte);
+#endif
+
   // ----- Portable -----
 
   int
@@ -28,7 +28,12 @@ trace_printf(const char* format, ...)
 
   // TODO: rewrite it to no longer use newlib, it is way too heavy
 
+#if defined(OS_USE_TRACE_TASK_BUFFERS) || defined(OS_USE_TRACE_MUTEX)
+  // Called concurrently by several threads.
+  char buf[OS_INTEGER_TRACE_PRINTF_TMP_ARRAY_SIZE];
+#else
   static char buf[OS_INTEGER_TRACE_PRINTF_TMP_ARRAY_SIZE];
+#endif
 
   // Print to the local buffer
   ret = vsnprintf (buf, sizeof(buf), format, ap);
@@ -18,6 +18,7 @@
 //#define OS_USE_TRACE_ITM
 //#define OS_USE_TRACE_SEMIHOSTING_DEBUG
 //#define OS_USE_TRACE_SEMIHOSTING_STDOUT
+//#define OS_USE_TRACE_USART
 
 #if !(defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
 #if defined(OS_USE_TRACE_ITM)
@@ -51,22 +52,45 @@ static ssize_t
 _trace_write_semihosting_debug(const char* buf, size_t nbyte);
 #endif
 
+#if defined(OS_USE_TRACE_USART)
+// In trace_usart.c.
+void
+_trace_initialize_usart (void);
+
+ssize_t
+_trace_write_usart (const char* buf, size_t nbyte);
+#endif
+
 // ----------------------------------------------------------------------------
 
 void
 trace_initialize(void)
 {
   // For regular ITM / semihosting, no inits required.
+#if defined(OS_USE_TRACE_USART)
+  // Otherwise done on the first write.
+  _trace_initialize_usart ();
+#endif
 }
 
 // ----------------------------------------------------------------------------
 
 // This function is called from _write() for fd==1 or fd==2 and from some
 // of the trace_* functions.
+//
+// With OS_USE_TRACE_TASK_BUFFERS or OS_USE_TRACE_MUTEX, the application
+// provides a thread safe trace_write(), which reaches the device via
+// trace_write_device().
 
+#if defined(OS_USE_TRACE_TASK_BUFFERS) || defined(OS_USE_TRACE_MUTEX)
+ssize_t
+trace_write_device (const char* buf __attribute__((unused)),
+	     size_t nbyte __attribute__((unused)))
+#else
 ssize_t
 trace_write (const char* buf __attribute__((unused)),
 	     size_t nbyte __attribute__((unused)))
+#endif
 {
 #if defined(OS_USE_TRACE_ITM)
   return _trace_write_itm (buf, nbyte);
@@ -74,6 +98,8 @@ trace_write (const char* buf __attribute__((unused)),
   return _trace_write_semihosting_stdout(buf, nbyte);
 #elif defined(OS_USE_TRACE_SEMIHOSTING_DEBUG)
   return _trace_write_semihosting_debug(buf, nbyte);
+#elif defined(OS_USE_TRACE_USART)
+  return _trace_write_usart (buf, nbyte);
 #endif
 
   return -1;
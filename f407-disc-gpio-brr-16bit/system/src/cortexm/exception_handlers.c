@@ -158,13 +158,21 @@ dumpExceptionStack (ExceptionStackFrame* frame, uint32_t lr)
 
 // ----------------------------------------------------------------------------
 
-#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
-
 #if defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT) || defined(OS_USE_TRACE_SEMIHOSTING_DEBUG)
 
+// The address of the last instruction identified as a semihosting call.
+// Since call_host() is inlined in only a few places, the same addresses
+// trap again and again, and a match allows to skip fetching and decoding
+// the op code, both here and in the HardFault_Handler trampoline.
+// The initial odd value never matches a stacked PC.
+uint32_t semihosting_bkpt_pc __attribute__((used)) = 1;
+
 int
 isSemihosting (ExceptionStackFrame* frame, uint16_t opCode);
 
+int
+processSemihosting (ExceptionStackFrame* frame);
+
 /**
  * This function provides the minimum functionality to make a semihosting program execute even without the debugger present.
  * @param frame pointer to an exception stack frame.
@@ -174,78 +182,97 @@ isSemihosting (ExceptionStackFrame* frame, uint16_t opCode);
 int
 isSemihosting (ExceptionStackFrame* frame, uint16_t opCode)
 {
+  if (frame->pc == semihosting_bkpt_pc)
+    {
+      return processSemihosting (frame);
+    }
+
   uint16_t* pw = (uint16_t*) frame->pc;
   if (*pw == opCode)
     {
-      uint32_t r0 = frame->r0;
+      return processSemihosting (frame);
+    }
+  return 0;
+}
+
+/**
+ * Perform the semihosting call, assuming the instruction at the stacked
+ * PC was already identified as a semihosting BKPT.
+ * @param frame pointer to an exception stack frame.
+ * @return 1 if the call was processed; 0 if not supported.
+ */
+int
+processSemihosting (ExceptionStackFrame* frame)
+{
+  uint32_t r0 = frame->r0;
 #if defined(OS_DEBUG_SEMIHOSTING_FAULTS) || defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT)
-      uint32_t r1 = frame->r1;
+  uint32_t r1 = frame->r1;
 #endif
 #if defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT)
-      uint32_t* blk = (uint32_t*) r1;
+  uint32_t* blk = (uint32_t*) r1;
 #endif
 
 #if defined(OS_DEBUG_SEMIHOSTING_FAULTS)
-      // trace_printf ("sh r0=%d\n", r0);
+  // trace_printf ("sh r0=%d\n", r0);
 #endif
 
-      switch (r0)
-        {
+  switch (r0)
+    {
 
 #if defined(OS_USE_SEMIHOSTING)
 
-        case SEMIHOSTING_SYS_CLOCK:
-        case SEMIHOSTING_SYS_ELAPSED:
-        case SEMIHOSTING_SYS_FLEN:
-        case SEMIHOSTING_SYS_GET_CMDLINE:
-        case SEMIHOSTING_SYS_REMOVE:
-        case SEMIHOSTING_SYS_RENAME:
-        case SEMIHOSTING_SYS_SEEK:
-        case SEMIHOSTING_SYS_SYSTEM:
-        case SEMIHOSTING_SYS_TICKFREQ:
-        case SEMIHOSTING_SYS_TMPNAM:
-        case SEMIHOSTING_SYS_ISTTY:
-          frame->r0 = (uint32_t)-1; // the call is not successful or not supported
-          break;
-
-        case SEMIHOSTING_SYS_CLOSE:
-          frame->r0 = 0; // call is successful
-          break;
-
-        case SEMIHOSTING_SYS_ERRNO:
-          frame->r0 = 0; // the value of the C library errno variable.
-          break;
-
-        case SEMIHOSTING_SYS_HEAPINFO:
-          blk[0] = 0; // heap_base
-          blk[1] = 0; // heap_limit
-          blk[2] = 0; // stack_base
-          blk[3] = 0; // stack_limit
-          break;
-
-        case SEMIHOSTING_SYS_ISERROR:
-          frame->r0 = 0; // 0 if the status word is not an error indication
-          break;
-
-        case SEMIHOSTING_SYS_READ:
-          // If R0 contains the same value as word 3, the call has
-          // failed and EOF is assumed.
-          frame->r0 = blk[2];
-          break;
-
-        case SEMIHOSTING_SYS_READC:
-          frame->r0 = '\0'; // the byte read from the console.
-          break;
-
-        case SEMIHOSTING_SYS_TIME:
-          frame->r0 = 0; // the number of seconds since 00:00 January 1, 1970.
-          break;
-
-        case SEMIHOSTING_ReportException:
-
-          NVIC_SystemReset ();
-          // Should not reach here
-          return 0;
+    case SEMIHOSTING_SYS_CLOCK:
+    case SEMIHOSTING_SYS_ELAPSED:
+    case SEMIHOSTING_SYS_FLEN:
+    case SEMIHOSTING_SYS_GET_CMDLINE:
+    case SEMIHOSTING_SYS_REMOVE:
+    case SEMIHOSTING_SYS_RENAME:
+    case SEMIHOSTING_SYS_SEEK:
+    case SEMIHOSTING_SYS_SYSTEM:
+    case SEMIHOSTING_SYS_TICKFREQ:
+    case SEMIHOSTING_SYS_TMPNAM:
+    case SEMIHOSTING_SYS_ISTTY:
+      frame->r0 = (uint32_t)-1; // the call is not successful or not supported
+      break;
+
+    case SEMIHOSTING_SYS_CLOSE:
+      frame->r0 = 0; // call is successful
+      break;
+
+    case SEMIHOSTING_SYS_ERRNO:
+      frame->r0 = 0; // the value of the C library errno variable.
+      break;
+
+    case SEMIHOSTING_SYS_HEAPINFO:
+      blk[0] = 0; // heap_base
+      blk[1] = 0; // heap_limit
+      blk[2] = 0; // stack_base
+      blk[3] = 0; // stack_limit
+      break;
+
+    case SEMIHOSTING_SYS_ISERROR:
+      frame->r0 = 0; // 0 if the status word is not an error indication
+      break;
+
+    case SEMIHOSTING_SYS_READ:
+      // If R0 contains the same value as word 3, the call has
+      // failed and EOF is assumed.
+      frame->r0 = blk[2];
+      break;
+
+    case SEMIHOSTING_SYS_READC:
+      frame->r0 = '\0'; // the byte read from the console.
+      break;
+
+    case SEMIHOSTING_SYS_TIME:
+      frame->r0 = 0; // the number of seconds since 00:00 January 1, 1970.
+      break;
+
+    case SEMIHOSTING_ReportException:
+
+      NVIC_SystemReset ();
+      // Should not reach here
+      return 0;
 
 #endif // defined(OS_USE_SEMIHOSTING)
 
@@ -255,94 +282,125 @@ isSemihosting (ExceptionStackFrame* frame, uint16_t opCode)
 #define HANDLER_STDOUT  (2)
 #define HANDLER_STDERR  (3)
 
-        case SEMIHOSTING_SYS_OPEN:
-          // Process only standard io/out/err and return 1/2/3
-          if (strcmp ((char*) blk[0], ":tt") == 0)
+    case SEMIHOSTING_SYS_OPEN:
+      // Process only standard io/out/err and return 1/2/3
+      if (strcmp ((char*) blk[0], ":tt") == 0)
+        {
+          if ((blk[1] == 0))
             {
-              if ((blk[1] == 0))
-                {
-                  frame->r0 = HANDLER_STDIN;
-                  break;
-                }
-              else if (blk[1] == 4)
-                {
-                  frame->r0 = HANDLER_STDOUT;
-                  break;
-                }
-              else if (blk[1] == 8)
-                {
-                  frame->r0 = HANDLER_STDERR;
-                  break;
-                }
+              frame->r0 = HANDLER_STDIN;
+              break;
             }
-          frame->r0 = (uint32_t)-1; // the call is not successful or not supported
-          break;
-
-        case SEMIHOSTING_SYS_WRITE:
-          // Silently ignore writes to stdout/stderr, fail on all other handler.
-          if ((blk[0] == HANDLER_STDOUT) || (blk[0] == HANDLER_STDERR))
+          else if (blk[1] == 4)
             {
-#if defined(OS_DEBUG_SEMIHOSTING_FAULTS)
-              frame->r0 = (uint32_t) blk[2]
-                  - trace_write ((char*) blk[1], blk[2]);
-#else
-              frame->r0 = 0; // all sent, no more.
-#endif // defined(OS_DEBUG_SEMIHOSTING_FAULTS)
+              frame->r0 = HANDLER_STDOUT;
+              break;
             }
-          else
+          else if (blk[1] == 8)
             {
-              // If other handler, return the total number of bytes
-              // as the number of bytes that are not written.
-              frame->r0 = blk[2];
+              frame->r0 = HANDLER_STDERR;
+              break;
             }
-          break;
+        }
+      frame->r0 = (uint32_t)-1; // the call is not successful or not supported
+      break;
+
+    case SEMIHOSTING_SYS_WRITE:
+      // Silently ignore writes to stdout/stderr, fail on all other handler.
+      if ((blk[0] == HANDLER_STDOUT) || (blk[0] == HANDLER_STDERR))
+        {
+#if defined(OS_DEBUG_SEMIHOSTING_FAULTS)
+          frame->r0 = (uint32_t) blk[2]
+              - trace_write ((char*) blk[1], blk[2]);
+#else
+          frame->r0 = 0; // all sent, no more.
+#endif // defined(OS_DEBUG_SEMIHOSTING_FAULTS)
+        }
+      else
+        {
+          // If other handler, return the total number of bytes
+          // as the number of bytes that are not written.
+          frame->r0 = blk[2];
+        }
+      break;
 
 #endif // defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT)
 
 #if defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT) || defined(OS_USE_TRACE_SEMIHOSTING_DEBUG)
 
-        case SEMIHOSTING_SYS_WRITEC:
+    case SEMIHOSTING_SYS_WRITEC:
 #if defined(OS_DEBUG_SEMIHOSTING_FAULTS)
-          {
-            char ch = *((char*) r1);
-            trace_write (&ch, 1);
-          }
+      {
+        char ch = *((char*) r1);
+        trace_write (&ch, 1);
+      }
 #endif
-          // Register R0 is corrupted.
-          break;
+      // Register R0 is corrupted.
+      break;
 
-        case SEMIHOSTING_SYS_WRITE0:
+    case SEMIHOSTING_SYS_WRITE0:
 #if defined(OS_DEBUG_SEMIHOSTING_FAULTS)
-          {
-            char* p = ((char*) r1);
-            trace_write (p, strlen (p));
-          }
+      {
+        char* p = ((char*) r1);
+        trace_write (p, strlen (p));
+      }
 #endif
-          // Register R0 is corrupted.
-          break;
+      // Register R0 is corrupted.
+      break;
 
 #endif
 
-        default:
-          return 0;
-        }
+    default:
+      return 0;
+    }
+
+  // Remember the location, the next call from here is
+  // identified without decoding.
+  semihosting_bkpt_pc = frame->pc;
+
+  // Alter the PC to make the exception returns to
+  // the instruction after the faulty BKPT.
+  frame->pc += 2;
+  return 1;
+}
+
+// Fast path, entered from the HardFault_Handler trampoline only when
+// the fault was already identified as a semihosting BKPT, so none of
+// the fault status registers are read and nothing is traced.
+// If the call is not supported, fall back to the regular handler.
 
-      // Alter the PC to make the exception returns to
-      // the instruction after the faulty BKPT.
-      frame->pc += 2;
-      return 1;
+void __attribute__ ((section(".after_vectors"),weak,used))
+HardFault_Semihosting_C (ExceptionStackFrame* frame, uint32_t lr)
+{
+  if (processSemihosting (frame))
+    {
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+      // Clear the exception cause in exception status.
+      SCB->HFSR = SCB_HFSR_DEBUGEVT_Msk;
+#endif
+      // Continue after the BKPT
+      return;
     }
-  return 0;
+
+  HardFault_Handler_C (frame, lr);
 }
 
 #endif
 
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+
 // Hard Fault handler wrapper in assembly.
 // It extracts the location of stack frame and passes it to handler
 // in C as a pointer. We also pass the LR value as second
 // parameter.
 // (Based on Joseph Yiu's, The Definitive Guide to ARM Cortex-M3 and
 // Cortex-M4 Processors, Third Edition, Chap. 12.8, page 402).
+//
+// With semihosting enabled, the wrapper also acts as a trampoline:
+// a stacked PC that matches the last known semihosting call, or a
+// debug event caused by a BKPT (HFSR.DEBUGEVT and DFSR.BKPT both set)
+// with the semihosting op code, is dispatched directly to
+// HardFault_Semihosting_C.
 
 void __attribute__ ((section(".after_vectors"),weak,naked))
 HardFault_Handler (void)
@@ -353,6 +411,29 @@ HardFault_Handler (void)
       " mrseq r0,msp    \n"
       " mrsne r0,psp    \n"
       " mov r1,lr       \n"
+#if defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT) || defined(OS_USE_TRACE_SEMIHOSTING_DEBUG)
+      " ldr r2,[r0,#24] \n" // stacked PC
+      " ldr r3,=semihosting_bkpt_pc \n"
+      " ldr r3,[r3]     \n"
+      " cmp r2,r3       \n"
+      " beq 1f          \n"
+      " ldr r3,=0xE000ED2C \n" // SCB->HFSR
+      " ldr r2,[r3]     \n"
+      " tst r2,#0x80000000 \n" // HFSR.DEBUGEVT
+      " beq 2f          \n"
+      " ldr r2,[r3,#4]  \n" // SCB->DFSR
+      " tst r2,#2       \n" // DFSR.BKPT
+      " beq 2f          \n"
+      " ldr r2,[r0,#24] \n"
+      " ldrh r2,[r2]    \n"
+      " movw r3,#0xBEAB \n" // bkpt 0xAB
+      " cmp r2,r3       \n"
+      " bne 2f          \n"
+      "1:               \n"
+      " ldr r2,=HardFault_Semihosting_C \n"
+      " bx r2           \n"
+      "2:               \n"
+#endif
       " ldr r2,=HardFault_Handler_C \n"
       " bx r2"
 
@@ -418,6 +499,12 @@ HardFault_Handler_C (ExceptionStackFrame* frame __attribute__((unused)),
 // parameter.
 // (Based on Joseph Yiu's, The Definitive Guide to ARM Cortex-M0
 // First Edition, Chap. 12.8, page 402).
+//
+// ARMv6-M has no fault status registers, so with semihosting enabled
+// the trampoline decodes the op code at the stacked PC, after checking
+// that it is inside the application code (a fetch from an invalid
+// address here would lock up the core). Semihosting calls are
+// dispatched directly to HardFault_Semihosting_C.
 
 void __attribute__ ((section(".after_vectors"),weak,naked))
 HardFault_Handler (void)
@@ -433,6 +520,27 @@ HardFault_Handler (void)
       " mrs r0,msp      \n"
       "2:"
       " mov r1,lr       \n"
+#if defined(OS_USE_SEMIHOSTING) || defined(OS_USE_TRACE_SEMIHOSTING_STDOUT) || defined(OS_USE_TRACE_SEMIHOSTING_DEBUG)
+      " ldr r2,[r0,#24] \n" // stacked PC
+      " ldr r3,=semihosting_bkpt_pc \n"
+      " ldr r3,[r3]     \n"
+      " cmp r2,r3       \n"
+      " beq 3f          \n"
+      " ldr r3,=__vectors_start \n"
+      " cmp r2,r3       \n"
+      " blo 4f          \n"
+      " ldr r3,=_etext  \n"
+      " cmp r2,r3       \n"
+      " bhs 4f          \n"
+      " ldrh r2,[r2]    \n"
+      " ldr r3,=0xBEAB  \n" // bkpt 0xAB
+      " cmp r2,r3       \n"
+      " bne 4f          \n"
+      "3:               \n"
+      " ldr r2,=HardFault_Semihosting_C \n"
+      " bx r2           \n"
+      "4:               \n"
+#endif
       " ldr r2,=HardFault_Handler_C \n"
       " bx r2"
 
@@ -446,8 +554,8 @@ void __attribute__ ((section(".after_vectors"),weak,used))
 HardFault_Handler_C (ExceptionStackFrame* frame __attribute__((unused)),
                      uint32_t lr __attribute__((unused)))
 {
-  // There is no semihosting support for Cortex-M0, since on ARMv6-M
-  // faults are fatal and it is not possible to return from the handler.
+  // Semihosting calls were already filtered out by the trampoline,
+  // so any fault reaching here is fatal.
 
 #if defined(TRACE)
   trace_printf ("[HardFault]\n");
@@ -0,0 +1,217 @@
+//
+// This file is part of the µOS++ III distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#if defined(TRACE) && defined(OS_USE_TRACE_USART)
+
+#include "cmsis_device.h"
+#include "diag/Trace.h"
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+
+// The USART trace channel, selected with OS_USE_TRACE_USART.
+//
+// Unlike ITM and semihosting, it needs no debugger: the output goes to
+// USART2, TX on PA2 (the ST-LINK virtual COM port on the Nucleo
+// boards), 8N1 at OS_INTEGER_TRACE_USART_BAUD, and under QEMU to the
+// serial chardev.
+//
+// The writes are copied into one of two buffers of
+// OS_INTEGER_TRACE_USART_BUFFER_SIZE bytes, while the other one is
+// sent in the background, by DMA1; when both are full, the
+// writer waits, polling the transfer, so it also works with the
+// interrupts disabled.
+//
+// The registers are used directly, so the UART/DMA drivers can stay
+// excluded from the build.
+
+#if !defined(OS_INTEGER_TRACE_USART_BAUD)
+#define OS_INTEGER_TRACE_USART_BAUD             (115200)
+#endif
+
+#if !defined(OS_INTEGER_TRACE_USART_BUFFER_SIZE)
+#define OS_INTEGER_TRACE_USART_BUFFER_SIZE      (256)
+#endif
+
+// The lowest priority.
+#define TRACE_USART_IRQ_PRIORITY                ((1 << __NVIC_PRIO_BITS) - 1)
+
+void
+_trace_initialize_usart (void);
+
+ssize_t
+_trace_write_usart (const char* buf, size_t nbyte);
+
+// ----------------------------------------------------------------------------
+
+static char buffers[2][OS_INTEGER_TRACE_USART_BUFFER_SIZE];
+
+// The buffer being filled, and its count; the other one may be sent.
+static uint32_t fill_index;
+static size_t fill_count;
+static volatile uint32_t busy;
+static uint32_t initialised;
+
+static uint32_t
+apb1_frequency (void)
+{
+  uint32_t ppre = (RCC->CFGR >> 10) & 7;
+  return (ppre & 4) ? (SystemCoreClock >> ((ppre & 3) + 1)) : SystemCoreClock;
+}
+
+// USART2_TX is DMA1 stream 6, channel 4.
+#define TRACE_USART_DMA_STREAM  (DMA1_Stream6)
+#define TRACE_USART_DMA_FLAGS \
+  (DMA_HISR_TCIF6 | DMA_HISR_HTIF6 | DMA_HISR_TEIF6 | DMA_HISR_DMEIF6 \
+      | DMA_HISR_FEIF6)
+
+static void
+initialize_hardware (void)
+{
+  RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_DMA1EN;
+  RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+  // PA2, alternate function 7, fast.
+  GPIOA->AFR[0] = (GPIOA->AFR[0] & ~(0xFu << (2 * 4))) | (7u << (2 * 4));
+  GPIOA->OSPEEDR |= (2u << (2 * 2));
+  GPIOA->MODER = (GPIOA->MODER & ~(3u << (2 * 2))) | (2u << (2 * 2));
+
+  USART2->BRR = (apb1_frequency () + OS_INTEGER_TRACE_USART_BAUD / 2)
+      / OS_INTEGER_TRACE_USART_BAUD;
+  USART2->CR3 = USART_CR3_DMAT;
+  USART2->CR1 = USART_CR1_UE | USART_CR1_TE;
+
+  TRACE_USART_DMA_STREAM->CR = 0;
+  TRACE_USART_DMA_STREAM->PAR = (uint32_t) &USART2->DR;
+  DMA1->HIFCR = TRACE_USART_DMA_FLAGS;
+
+  NVIC_SetPriority (DMA1_Stream6_IRQn, TRACE_USART_IRQ_PRIORITY);
+  NVIC_EnableIRQ (DMA1_Stream6_IRQn);
+}
+
+static void
+start_send (const char* p, size_t n)
+{
+  TRACE_USART_DMA_STREAM->M0AR = (uint32_t) p;
+  TRACE_USART_DMA_STREAM->NDTR = n;
+  // Channel 4, memory to peripheral, bytes.
+  TRACE_USART_DMA_STREAM->CR = (4u << 25) | DMA_SxCR_DIR_0 | DMA_SxCR_MINC
+      | DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_EN;
+}
+
+static void send_next (void);
+
+// Called with interrupts disabled, from the interrupt or polled.
+static void
+service (void)
+{
+  if (DMA1->HISR & (DMA_HISR_TCIF6 | DMA_HISR_TEIF6))
+    {
+      DMA1->HIFCR = TRACE_USART_DMA_FLAGS;
+      send_next ();
+    }
+}
+
+// Called with interrupts disabled.
+static void
+send_next (void)
+{
+  if (fill_count == 0)
+    {
+      busy = 0;
+      return;
+    }
+
+  const char* p = buffers[fill_index];
+  size_t n = fill_count;
+
+  fill_index ^= 1;
+  fill_count = 0;
+  busy = 1;
+  start_send (p, n);
+}
+
+void
+_trace_initialize_usart (void)
+{
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (!initialised)
+    {
+      initialised = 1;
+      initialize_hardware ();
+    }
+
+  __set_PRIMASK (primask);
+}
+
+ssize_t
+_trace_write_usart (const char* buf, size_t nbyte)
+{
+  if (!initialised)
+    {
+      _trace_initialize_usart ();
+    }
+
+  size_t done = 0;
+  while (done < nbyte)
+    {
+      uint32_t primask = __get_PRIMASK ();
+      __disable_irq ();
+
+      size_t n = OS_INTEGER_TRACE_USART_BUFFER_SIZE - fill_count;
+      if (n == 0)
+        {
+          // Both buffers full; advance the transfer by polling.
+          service ();
+        }
+      else
+        {
+          if (n > nbyte - done)
+            {
+              n = nbyte - done;
+            }
+          memcpy (&buffers[fill_index][fill_count], buf + done, n);
+          fill_count += n;
+          done += n;
+
+          if (!busy)
+            {
+              send_next ();
+            }
+        }
+
+      __set_PRIMASK (primask);
+    }
+
+  return (ssize_t) nbyte;
+}
+
+// ----------------------------------------------------------------------------
+
+void
+DMA1_Stream6_IRQHandler (void);
+
+void
+DMA1_Stream6_IRQHandler (void)
+{
+  // The lowest priority, so any other handler, which may write the
+  // trace, can preempt it; send_next() must not be interrupted.
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  service ();
+
+  __set_PRIMASK (primask);
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(TRACE) && defined(OS_USE_TRACE_USART)
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef IRQ_LATENCY_H_
+#define IRQ_LATENCY_H_
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+// Interrupt latency and jitter benchmarks, based on the DWT cycle counter.
+//
+// The tests use two interrupts of peripherals not used by this project
+// (CAN2 TX/RX0), pended by software, and measure:
+// - the pend-to-handler entry latency;
+// - the tail-chaining cost, from the exit of a handler to the entry
+//   of the next pending one;
+// - the preemption latency, when a higher priority interrupt is
+//   pended from a lower priority handler;
+// - the late-arrival latency, when a higher priority interrupt is
+//   pended while the lower priority one is still stacking;
+// - the cost of raising/restoring BASEPRI and the latency of an
+//   interrupt masked by BASEPRI, measured from the moment it is
+//   unmasked.
+//
+// Each test is repeated for all priority groupings and the results
+// are printed as histograms on the standard output (semihosting).
+
+#if !defined(IRQ_LATENCY_HISTOGRAM_BINS)
+#define IRQ_LATENCY_HISTOGRAM_BINS      (16)
+#endif
+
+#if !defined(IRQ_LATENCY_HISTOGRAM_BIN_WIDTH)
+#define IRQ_LATENCY_HISTOGRAM_BIN_WIDTH (2)
+#endif
+
+#if !defined(IRQ_LATENCY_ITERATIONS)
+#define IRQ_LATENCY_ITERATIONS          (1000)
+#endif
+
+typedef struct irq_latency_histogram_s
+{
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  // Values below 'base' land in the first bin, values above the
+  // last bin are counted in 'overflow'.
+  uint32_t base;
+  uint32_t bins[IRQ_LATENCY_HISTOGRAM_BINS];
+  uint32_t overflow;
+} irq_latency_histogram_t;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+  // Enable the DWT cycle counter; return 0 if not implemented
+  // (for example on some emulated cores).
+  int
+  irq_latency_init (void);
+
+  void
+  irq_latency_histogram_clear (irq_latency_histogram_t* h, uint32_t base);
+
+  void
+  irq_latency_histogram_add (irq_latency_histogram_t* h, uint32_t cycles);
+
+  void
+  irq_latency_histogram_print (const irq_latency_histogram_t* h,
+                               const char* title);
+
+  // Run all tests for all priority groupings.
+  void
+  irq_latency_run_all (uint32_t iterations);
+
+#if defined(__cplusplus)
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // IRQ_LATENCY_H_
@@ -0,0 +1,449 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "cmsis_device.h"
+#include "irq_latency.h"
+
+// ----------------------------------------------------------------------------
+
+// The A interrupt has a lower number than B, so with equal priorities
+// it is always served first.
+#define IRQ_LATENCY_IRQ_A       (CAN2_TX_IRQn)
+#define IRQ_LATENCY_IRQ_B       (CAN2_RX0_IRQn)
+
+#define IRQ_LATENCY_BAR_WIDTH   (40)
+
+enum
+{
+  TEST_PEND = 0,
+  TEST_TAIL_CHAIN,
+  TEST_PREEMPT,
+  TEST_LATE_ARRIVAL,
+  TEST_BASEPRI_UNMASK,
+};
+
+// ----------------------------------------------------------------------------
+
+// Forward declarations.
+
+void
+CAN2_TX_IRQHandler (void);
+
+void
+CAN2_RX0_IRQHandler (void);
+
+// ----------------------------------------------------------------------------
+
+static volatile uint32_t test_mode;
+
+// Time stamps, as DWT->CYCCNT values.
+static volatile uint32_t pend_stamp;
+static volatile uint32_t a_entry_stamp;
+static volatile uint32_t a_exit_stamp;
+static volatile uint32_t b_entry_stamp;
+
+static volatile uint32_t a_done;
+static volatile uint32_t b_done;
+
+// Incremented when B was served before A.
+static volatile uint32_t late_arrivals;
+
+// The cost of two consecutive reads of the cycle counter, subtracted
+// from all measurements.
+static uint32_t read_overhead;
+
+// ----------------------------------------------------------------------------
+
+void
+CAN2_TX_IRQHandler (void)
+{
+  a_entry_stamp = DWT->CYCCNT;
+
+  if (test_mode == TEST_PREEMPT)
+    {
+      pend_stamp = DWT->CYCCNT;
+      NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_B);
+      __DSB ();
+      __ISB ();
+    }
+  else if (test_mode == TEST_LATE_ARRIVAL)
+    {
+      if (b_done)
+        {
+          ++late_arrivals;
+        }
+    }
+
+  a_done = 1;
+  a_exit_stamp = DWT->CYCCNT;
+}
+
+void
+CAN2_RX0_IRQHandler (void)
+{
+  b_entry_stamp = DWT->CYCCNT;
+  b_done = 1;
+}
+
+// ----------------------------------------------------------------------------
+
+static inline uint32_t
+__attribute__((always_inline))
+elapsed (uint32_t begin, uint32_t end)
+{
+  uint32_t delta = end - begin;
+  return (delta > read_overhead) ? (delta - read_overhead) : 0;
+}
+
+static void
+reset_stamps (void)
+{
+  a_done = 0;
+  b_done = 0;
+}
+
+static uint32_t
+sample_pend (void)
+{
+  reset_stamps ();
+
+  pend_stamp = DWT->CYCCNT;
+  NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_A);
+  while (!a_done)
+    ;
+
+  return elapsed (pend_stamp, a_entry_stamp);
+}
+
+static uint32_t
+sample_tail_chain (void)
+{
+  reset_stamps ();
+
+  __disable_irq ();
+  NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_A);
+  NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_B);
+  __enable_irq ();
+  while (!(a_done && b_done))
+    ;
+
+  return elapsed (a_exit_stamp, b_entry_stamp);
+}
+
+static uint32_t
+sample_preempt (void)
+{
+  reset_stamps ();
+
+  // The A handler records the pend moment and pends B.
+  NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_A);
+  while (!(a_done && b_done))
+    ;
+
+  return elapsed (pend_stamp, b_entry_stamp);
+}
+
+static uint32_t
+sample_late_arrival (void)
+{
+  reset_stamps ();
+
+  // B is pended while A is still stacking; if the core supports
+  // late-arrival, B is served first, without a second stacking.
+  pend_stamp = DWT->CYCCNT;
+  NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_A);
+  NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_B);
+  while (!(a_done && b_done))
+    ;
+
+  return elapsed (pend_stamp, b_entry_stamp);
+}
+
+static uint32_t basepri_mask;
+
+static uint32_t
+sample_basepri_cost (void)
+{
+  uint32_t st = __get_BASEPRI ();
+
+  uint32_t begin = DWT->CYCCNT;
+  __set_BASEPRI_MAX (basepri_mask);
+  __set_BASEPRI (st);
+  uint32_t end = DWT->CYCCNT;
+
+  return elapsed (begin, end);
+}
+
+static uint32_t
+sample_primask_cost (void)
+{
+  uint32_t begin = DWT->CYCCNT;
+  __disable_irq ();
+  __enable_irq ();
+  uint32_t end = DWT->CYCCNT;
+
+  return elapsed (begin, end);
+}
+
+static uint32_t
+sample_basepri_unmask (void)
+{
+  reset_stamps ();
+
+  uint32_t st = __get_BASEPRI ();
+  __set_BASEPRI_MAX (basepri_mask);
+
+  NVIC_SetPendingIRQ (IRQ_LATENCY_IRQ_A);
+  __DSB ();
+  __ISB ();
+
+  // A is pending but masked; measure from the moment it is unmasked.
+  pend_stamp = DWT->CYCCNT;
+  __set_BASEPRI (st);
+  while (!a_done)
+    ;
+
+  return elapsed (pend_stamp, a_entry_stamp);
+}
+
+// ----------------------------------------------------------------------------
+
+typedef uint32_t
+(*irq_latency_sample_t) (void);
+
+static void
+run_test (uint32_t mode, irq_latency_sample_t sample, uint32_t iterations,
+          const char* title)
+{
+  irq_latency_histogram_t h;
+
+  test_mode = mode;
+
+  // Warm-up the caches and the prefetch buffer, and
+  // find the base of the histogram.
+  uint32_t min = 0xFFFFFFFF;
+  for (uint32_t i = 0; i < IRQ_LATENCY_HISTOGRAM_BINS; ++i)
+    {
+      uint32_t v = sample ();
+      if (v < min)
+        {
+          min = v;
+        }
+    }
+
+  irq_latency_histogram_clear (&h,
+                               min - (min % IRQ_LATENCY_HISTOGRAM_BIN_WIDTH));
+  late_arrivals = 0;
+
+  for (uint32_t i = 0; i < iterations; ++i)
+    {
+      irq_latency_histogram_add (&h, sample ());
+    }
+
+  irq_latency_histogram_print (&h, title);
+}
+
+// ----------------------------------------------------------------------------
+
+int
+irq_latency_init (void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  uint32_t begin = DWT->CYCCNT;
+  __NOP ();
+  __NOP ();
+  __NOP ();
+  __NOP ();
+  if (DWT->CYCCNT == begin)
+    {
+      // The counter does not count.
+      return 0;
+    }
+
+  read_overhead = 0xFFFFFFFF;
+  for (int i = 0; i < 16; ++i)
+    {
+      uint32_t b = DWT->CYCCNT;
+      uint32_t e = DWT->CYCCNT;
+      if (e - b < read_overhead)
+        {
+          read_overhead = e - b;
+        }
+    }
+
+  return 1;
+}
+
+void
+irq_latency_histogram_clear (irq_latency_histogram_t* h, uint32_t base)
+{
+  h->count = 0;
+  h->min = 0xFFFFFFFF;
+  h->max = 0;
+  h->sum = 0;
+  h->base = base;
+  for (int i = 0; i < IRQ_LATENCY_HISTOGRAM_BINS; ++i)
+    {
+      h->bins[i] = 0;
+    }
+  h->overflow = 0;
+}
+
+void
+irq_latency_histogram_add (irq_latency_histogram_t* h, uint32_t cycles)
+{
+  ++h->count;
+  h->sum += cycles;
+  if (cycles < h->min)
+    {
+      h->min = cycles;
+    }
+  if (cycles > h->max)
+    {
+      h->max = cycles;
+    }
+
+  uint32_t bin =
+      (cycles > h->base) ?
+          ((cycles - h->base) / IRQ_LATENCY_HISTOGRAM_BIN_WIDTH) : 0;
+  if (bin < IRQ_LATENCY_HISTOGRAM_BINS)
+    {
+      ++h->bins[bin];
+    }
+  else
+    {
+      ++h->overflow;
+    }
+}
+
+void
+irq_latency_histogram_print (const irq_latency_histogram_t* h,
+                             const char* title)
+{
+  if (h->count == 0)
+    {
+      printf ("%s: no samples\n", title);
+      return;
+    }
+
+  // Jitter is reported as the max-min spread.
+  printf ("%s: n=%u min=%u avg=%u max=%u jitter=%u cycles\n", title,
+          (unsigned int) h->count, (unsigned int) h->min,
+          (unsigned int) (h->sum / h->count), (unsigned int) h->max,
+          (unsigned int) (h->max - h->min));
+
+  uint32_t peak = h->overflow;
+  for (int i = 0; i < IRQ_LATENCY_HISTOGRAM_BINS; ++i)
+    {
+      if (h->bins[i] > peak)
+        {
+          peak = h->bins[i];
+        }
+    }
+
+  char bar[IRQ_LATENCY_BAR_WIDTH + 1];
+  for (int i = 0; i <= IRQ_LATENCY_HISTOGRAM_BINS; ++i)
+    {
+      uint32_t n = (i < IRQ_LATENCY_HISTOGRAM_BINS) ? h->bins[i] : h->overflow;
+      if (n == 0)
+        {
+          continue;
+        }
+
+      uint32_t len = (n * IRQ_LATENCY_BAR_WIDTH + peak - 1) / peak;
+      uint32_t j = 0;
+      for (; j < len; ++j)
+        {
+          bar[j] = '#';
+        }
+      bar[j] = '\0';
+
+      uint32_t lo = h->base + (uint32_t) i * IRQ_LATENCY_HISTOGRAM_BIN_WIDTH;
+      if (i < IRQ_LATENCY_HISTOGRAM_BINS)
+        {
+          printf ("  %4u-%-4u %6u %s\n", (unsigned int) lo,
+                  (unsigned int) (lo + IRQ_LATENCY_HISTOGRAM_BIN_WIDTH - 1),
+                  (unsigned int) n, bar);
+        }
+      else
+        {
+          printf ("  %4u+    %6u %s\n", (unsigned int) lo, (unsigned int) n,
+                  bar);
+        }
+    }
+}
+
+void
+irq_latency_run_all (uint32_t iterations)
+{
+  if (!irq_latency_init ())
+    {
+      printf ("DWT CYCCNT not available, latency tests skipped\n");
+      return;
+    }
+
+  printf ("CYCCNT read overhead: %u cycles\n", (unsigned int) read_overhead);
+
+  uint32_t saved_grouping = NVIC_GetPriorityGrouping ();
+
+  for (uint32_t grouping = 7 - __NVIC_PRIO_BITS; grouping <= 7; ++grouping)
+    {
+      uint32_t preempt_bits =
+          ((7 - grouping) > __NVIC_PRIO_BITS) ? __NVIC_PRIO_BITS : 7 - grouping;
+
+      NVIC_SetPriorityGrouping (grouping);
+      printf ("\nPriority grouping %u (%u preemption bits)\n",
+              (unsigned int) grouping, (unsigned int) preempt_bits);
+
+      // Same priority, A served first.
+      NVIC_SetPriority (IRQ_LATENCY_IRQ_A, NVIC_EncodePriority (grouping, 0, 0));
+      NVIC_SetPriority (IRQ_LATENCY_IRQ_B, NVIC_EncodePriority (grouping, 0, 1));
+      NVIC_EnableIRQ (IRQ_LATENCY_IRQ_A);
+      NVIC_EnableIRQ (IRQ_LATENCY_IRQ_B);
+
+      run_test (TEST_PEND, sample_pend, iterations, "pend-to-entry");
+      run_test (TEST_TAIL_CHAIN, sample_tail_chain, iterations, "tail-chain");
+
+      if (preempt_bits == 0)
+        {
+          printf ("preemption, late-arrival, BASEPRI: n/a\n");
+          continue;
+        }
+
+      // A lower priority than B.
+      NVIC_SetPriority (IRQ_LATENCY_IRQ_A, NVIC_EncodePriority (grouping, 1, 0));
+      NVIC_SetPriority (IRQ_LATENCY_IRQ_B, NVIC_EncodePriority (grouping, 0, 0));
+
+      run_test (TEST_PREEMPT, sample_preempt, iterations, "preemption");
+
+      run_test (TEST_LATE_ARRIVAL, sample_late_arrival, iterations,
+                "late-arrival");
+      printf ("  B served first %u of %u times\n",
+              (unsigned int) late_arrivals, (unsigned int) iterations);
+
+      // Mask A, but not B.
+      basepri_mask = NVIC_EncodePriority (grouping, 1, 0)
+          << (8 - __NVIC_PRIO_BITS);
+
+      run_test (TEST_PEND, sample_basepri_cost, iterations,
+                "BASEPRI raise+restore");
+      run_test (TEST_PEND, sample_primask_cost, iterations,
+                "PRIMASK disable+enable");
+      run_test (TEST_BASEPRI_UNMASK, sample_basepri_unmask, iterations,
+                "BASEPRI unmask-to-entry");
+    }
+
+  NVIC_DisableIRQ (IRQ_LATENCY_IRQ_A);
+  NVIC_DisableIRQ (IRQ_LATENCY_IRQ_B);
+  NVIC_SetPriorityGrouping (saved_grouping);
+}
+
+// ----------------------------------------------------------------------------
@@ -10,11 +10,16 @@
 #include "diag/Trace.h"
 
 #include "cmsis_device.h"
+#include "irq_latency.h"
 
 // ----------------------------------------------------------------------------
 //
 // Semihosting STM32F4 empty sample (trace via ITM).
 //
+// After the BASEPRI tests, if OS_BENCHMARK_IRQ_LATENCY is defined,
+// the interrupt latency benchmarks (see irq_latency.h) are executed
+// and the histograms are printed on the standard output.
+//
 // Trace support is enabled by adding the TRACE macro definition.
 // By default the trace messages are forwarded to the ITM output,
 // but can be rerouted to any device or completely suppressed, by
@@ -109,6 +114,10 @@ main (int argc, char* argv[])
   __NOP ();
   __NOP ();
 
+#if defined(OS_BENCHMARK_IRQ_LATENCY)
+  irq_latency_run_all (IRQ_LATENCY_ITERATIONS);
+#endif
+
   return 0;
 }
 
@@ -0,0 +1,237 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CLOCK_TREE_H_
+#define CLOCK_TREE_H_
+
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Compile time model of the STM32F4 clock tree.
+//
+// The PLL and bus prescalers are given by the OS_INTEGER_CLOCK_*
+// definitions below (the defaults reach 168 MHz from an 8 MHz HSE);
+// the preprocessor checks them against the device limits, and
+// computes the bus frequencies and the RCC/FLASH register values,
+// so the clock setup in __initialize_hardware() is a fixed sequence
+// of stores, and the peripheral clocks are constants (CLOCK_*_HZ, or
+// clock_tree::* in C++) instead of run time divisions of
+// SystemCoreClock.
+//
+// OS_INTEGER_CLOCK_HSE_HZ must be a plain number, usable by #if; it
+// defaults to HSE_VALUE, passed on the command line.
+//
+// The supply is assumed to be 2.7-3.6 V, with the regulator in scale 1
+// and, on the F42x/F43x, no over-drive (so up to 168 MHz).
+
+#if !defined(OS_INTEGER_CLOCK_HSE_HZ)
+#define OS_INTEGER_CLOCK_HSE_HZ                 (HSE_VALUE)
+#endif
+
+// VCO input = HSE / M.
+#if !defined(OS_INTEGER_CLOCK_PLL_M)
+#define OS_INTEGER_CLOCK_PLL_M                  (OS_INTEGER_CLOCK_HSE_HZ / 1000000)
+#endif
+
+// VCO output = VCO input * N.
+#if !defined(OS_INTEGER_CLOCK_PLL_N)
+#define OS_INTEGER_CLOCK_PLL_N                  (336)
+#endif
+
+// SYSCLK = VCO output / P.
+#if !defined(OS_INTEGER_CLOCK_PLL_P)
+#define OS_INTEGER_CLOCK_PLL_P                  (2)
+#endif
+
+// USB OTG FS, SDIO and RNG clock = VCO output / Q; must be 48 MHz for USB.
+#if !defined(OS_INTEGER_CLOCK_PLL_Q)
+#define OS_INTEGER_CLOCK_PLL_Q                  (7)
+#endif
+
+// HCLK = SYSCLK / AHB divider (1, 2, 4, ..., 512, except 32).
+#if !defined(OS_INTEGER_CLOCK_AHB_DIV)
+#define OS_INTEGER_CLOCK_AHB_DIV                (1)
+#endif
+
+// PCLK1/2 = HCLK / APB1/2 divider (1, 2, 4, 8, 16).
+#if !defined(OS_INTEGER_CLOCK_APB1_DIV)
+#define OS_INTEGER_CLOCK_APB1_DIV               (4)
+#endif
+
+#if !defined(OS_INTEGER_CLOCK_APB2_DIV)
+#define OS_INTEGER_CLOCK_APB2_DIV               (2)
+#endif
+
+// ----- Device limits --------------------------------------------------------
+
+#if defined(STM32F405xx) || defined(STM32F415xx) || defined(STM32F407xx) \
+  || defined(STM32F417xx)
+#define CLOCK_MAX_HCLK_HZ                       (168000000)
+#define CLOCK_MAX_PCLK1_HZ                      (42000000)
+#define CLOCK_MAX_PCLK2_HZ                      (84000000)
+#define CLOCK_MIN_VCO_HZ                        (192000000)
+#elif defined(STM32F427xx) || defined(STM32F437xx) \
+  || defined(STM32F429xx) || defined(STM32F439xx)
+#define CLOCK_MAX_HCLK_HZ                       (168000000)
+#define CLOCK_MAX_PCLK1_HZ                      (42000000)
+#define CLOCK_MAX_PCLK2_HZ                      (84000000)
+#define CLOCK_MIN_VCO_HZ                        (100000000)
+#elif defined(STM32F411xE)
+#define CLOCK_MAX_HCLK_HZ                       (100000000)
+#define CLOCK_MAX_PCLK1_HZ                      (50000000)
+#define CLOCK_MAX_PCLK2_HZ                      (100000000)
+#define CLOCK_MIN_VCO_HZ                        (100000000)
+#else
+#error "Unknown STM32F4 device, no clock limits"
+#endif
+
+#define CLOCK_MAX_VCO_HZ                        (432000000)
+
+// ----- Frequencies ----------------------------------------------------------
+
+#define CLOCK_VCO_IN_HZ \
+  (OS_INTEGER_CLOCK_HSE_HZ / OS_INTEGER_CLOCK_PLL_M)
+#define CLOCK_VCO_HZ \
+  (CLOCK_VCO_IN_HZ * OS_INTEGER_CLOCK_PLL_N)
+#define CLOCK_SYSCLK_HZ \
+  (CLOCK_VCO_HZ / OS_INTEGER_CLOCK_PLL_P)
+#define CLOCK_PLL48_HZ \
+  (CLOCK_VCO_HZ / OS_INTEGER_CLOCK_PLL_Q)
+#define CLOCK_HCLK_HZ \
+  (CLOCK_SYSCLK_HZ / OS_INTEGER_CLOCK_AHB_DIV)
+#define CLOCK_PCLK1_HZ \
+  (CLOCK_HCLK_HZ / OS_INTEGER_CLOCK_APB1_DIV)
+#define CLOCK_PCLK2_HZ \
+  (CLOCK_HCLK_HZ / OS_INTEGER_CLOCK_APB2_DIV)
+
+// The timers run at twice the bus clock when the bus is divided.
+#define CLOCK_TIM_APB1_HZ \
+  (OS_INTEGER_CLOCK_APB1_DIV == 1 ? CLOCK_PCLK1_HZ : 2 * CLOCK_PCLK1_HZ)
+#define CLOCK_TIM_APB2_HZ \
+  (OS_INTEGER_CLOCK_APB2_DIV == 1 ? CLOCK_PCLK2_HZ : 2 * CLOCK_PCLK2_HZ)
+
+// ----- Checks ---------------------------------------------------------------
+
+#if (OS_INTEGER_CLOCK_HSE_HZ % OS_INTEGER_CLOCK_PLL_M) != 0
+#error "HSE / PLL_M is not an integer frequency"
+#endif
+
+#if (OS_INTEGER_CLOCK_PLL_M < 2) || (OS_INTEGER_CLOCK_PLL_M > 63)
+#error "PLL_M out of range (2-63)"
+#endif
+
+#if (CLOCK_VCO_IN_HZ < 950000) || (CLOCK_VCO_IN_HZ > 2100000)
+#error "VCO input out of range (0.95-2.1 MHz)"
+#endif
+
+#if (OS_INTEGER_CLOCK_PLL_N < 50) || (OS_INTEGER_CLOCK_PLL_N > 432)
+#error "PLL_N out of range (50-432)"
+#endif
+
+#if (CLOCK_VCO_HZ < CLOCK_MIN_VCO_HZ) || (CLOCK_VCO_HZ > CLOCK_MAX_VCO_HZ)
+#error "VCO output out of range"
+#endif
+
+#if (OS_INTEGER_CLOCK_PLL_P != 2) && (OS_INTEGER_CLOCK_PLL_P != 4) \
+  && (OS_INTEGER_CLOCK_PLL_P != 6) && (OS_INTEGER_CLOCK_PLL_P != 8)
+#error "PLL_P must be 2, 4, 6 or 8"
+#endif
+
+#if (OS_INTEGER_CLOCK_PLL_Q < 2) || (OS_INTEGER_CLOCK_PLL_Q > 15)
+#error "PLL_Q out of range (2-15)"
+#endif
+
+#if (CLOCK_PLL48_HZ > 48000000)
+#error "PLL48CK above 48 MHz"
+#endif
+
+#if (OS_INTEGER_CLOCK_AHB_DIV != 1) && (OS_INTEGER_CLOCK_AHB_DIV != 2) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 4) && (OS_INTEGER_CLOCK_AHB_DIV != 8) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 16) && (OS_INTEGER_CLOCK_AHB_DIV != 64) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 128) && (OS_INTEGER_CLOCK_AHB_DIV != 256) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 512)
+#error "AHB divider must be 1, 2, 4, 8, 16, 64, 128, 256 or 512"
+#endif
+
+#if (OS_INTEGER_CLOCK_APB1_DIV != 1) && (OS_INTEGER_CLOCK_APB1_DIV != 2) \
+  && (OS_INTEGER_CLOCK_APB1_DIV != 4) && (OS_INTEGER_CLOCK_APB1_DIV != 8) \
+  && (OS_INTEGER_CLOCK_APB1_DIV != 16)
+#error "APB1 divider must be 1, 2, 4, 8 or 16"
+#endif
+
+#if (OS_INTEGER_CLOCK_APB2_DIV != 1) && (OS_INTEGER_CLOCK_APB2_DIV != 2) \
+  && (OS_INTEGER_CLOCK_APB2_DIV != 4) && (OS_INTEGER_CLOCK_APB2_DIV != 8) \
+  && (OS_INTEGER_CLOCK_APB2_DIV != 16)
+#error "APB2 divider must be 1, 2, 4, 8 or 16"
+#endif
+
+#if CLOCK_HCLK_HZ > CLOCK_MAX_HCLK_HZ
+#error "HCLK above the device maximum"
+#endif
+
+#if CLOCK_PCLK1_HZ > CLOCK_MAX_PCLK1_HZ
+#error "PCLK1 above the device maximum"
+#endif
+
+#if CLOCK_PCLK2_HZ > CLOCK_MAX_PCLK2_HZ
+#error "PCLK2 above the device maximum"
+#endif
+
+// ----- Register values ------------------------------------------------------
+
+// Flash wait states for HCLK, at 2.7-3.6 V.
+#if defined(STM32F411xE)
+#define CLOCK_FLASH_LATENCY \
+  (CLOCK_HCLK_HZ <= 30000000 ? 0 : CLOCK_HCLK_HZ <= 64000000 ? 1 \
+      : CLOCK_HCLK_HZ <= 90000000 ? 2 : 3)
+#else
+#define CLOCK_FLASH_LATENCY                     ((CLOCK_HCLK_HZ - 1) / 30000000)
+#endif
+
+#define CLOCK_HPRE_BITS(_D) \
+  ((_D) == 1 ? 0 : (_D) == 2 ? 8 : (_D) == 4 ? 9 : (_D) == 8 ? 10 \
+      : (_D) == 16 ? 11 : (_D) == 64 ? 12 : (_D) == 128 ? 13 \
+      : (_D) == 256 ? 14 : 15)
+#define CLOCK_PPRE_BITS(_D) \
+  ((_D) == 1 ? 0 : (_D) == 2 ? 4 : (_D) == 4 ? 5 : (_D) == 8 ? 6 : 7)
+
+#define CLOCK_RCC_PLLCFGR \
+  ((uint32_t) (OS_INTEGER_CLOCK_PLL_M \
+      | (OS_INTEGER_CLOCK_PLL_N << 6) \
+      | ((OS_INTEGER_CLOCK_PLL_P / 2 - 1) << 16) \
+      | RCC_PLLCFGR_PLLSRC_HSE \
+      | (OS_INTEGER_CLOCK_PLL_Q << 24)))
+
+// The prescalers only; SW is added when switching to the PLL.
+#define CLOCK_RCC_CFGR \
+  ((uint32_t) ((CLOCK_HPRE_BITS(OS_INTEGER_CLOCK_AHB_DIV) << 4) \
+      | (CLOCK_PPRE_BITS(OS_INTEGER_CLOCK_APB1_DIV) << 10) \
+      | (CLOCK_PPRE_BITS(OS_INTEGER_CLOCK_APB2_DIV) << 13)))
+
+#define CLOCK_FLASH_ACR \
+  ((uint32_t) (CLOCK_FLASH_LATENCY | FLASH_ACR_PRFTEN | FLASH_ACR_ICEN \
+      | FLASH_ACR_DCEN))
+
+// ----------------------------------------------------------------------------
+
+#if defined(__cplusplus)
+
+namespace clock_tree
+{
+  constexpr uint32_t sysclk_hz = CLOCK_SYSCLK_HZ;
+  constexpr uint32_t hclk_hz = CLOCK_HCLK_HZ;
+  constexpr uint32_t pclk1_hz = CLOCK_PCLK1_HZ;
+  constexpr uint32_t pclk2_hz = CLOCK_PCLK2_HZ;
+  constexpr uint32_t tim_apb1_hz = CLOCK_TIM_APB1_HZ;
+  constexpr uint32_t tim_apb2_hz = CLOCK_TIM_APB2_HZ;
+  constexpr uint32_t pll48_hz = CLOCK_PLL48_HZ;
+}
+
+#endif // defined(__cplusplus)
+
+// ----------------------------------------------------------------------------
+
+#endif // CLOCK_TREE_H_
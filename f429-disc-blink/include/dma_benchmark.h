@@ -0,0 +1,40 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef DMA_BENCHMARK_H_
+#define DMA_BENCHMARK_H_
+
+// ----------------------------------------------------------------------------
+
+// For sizes from 16 bytes to OS_INTEGER_BENCHMARK_DMA_MAX_SIZE, compare
+// the DWT cycles of a CPU memcpy() with those of dma_memcpy(): the
+// cycles the CPU spends to start it (setup) and the cycles until it is
+// done (total). The smallest size from which the DMA is done first is
+// printed, and set as dma_memory_threshold.
+
+#if !defined(OS_INTEGER_BENCHMARK_DMA_MAX_SIZE)
+#define OS_INTEGER_BENCHMARK_DMA_MAX_SIZE       (16 * 1024)
+#endif
+
+#if !defined(OS_INTEGER_BENCHMARK_DMA_RUNS)
+#define OS_INTEGER_BENCHMARK_DMA_RUNS           (8)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  // Call after dma_memory_init().
+  void
+  dma_benchmark_run (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // DMA_BENCHMARK_H_
@@ -0,0 +1,116 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef DMA_MEMORY_H_
+#define DMA_MEMORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// ----------------------------------------------------------------------------
+
+// Asynchronous memcpy()/memset() on DMA2 stream 0, memory to memory
+// (only DMA2 can do it).
+//
+// Each request uses a caller owned dma_transfer_t, which must stay
+// valid until the transfer is done; requests issued while the stream
+// is busy are queued, in order, and started from the DMA interrupt.
+// When a transfer ends, its state is updated and the callback, if any,
+// is invoked, from the interrupt handler; dma_transfer_done() and
+// dma_transfer_wait() can also be used, as a future.
+//
+// The unaligned head and tail bytes are done by the CPU, the rest by
+// word transfers (or byte transfers for a memcpy() between buffers of
+// different alignment), in chunks of up to 65535 items.
+//
+// Requests shorter than dma_memory_threshold bytes, or involving the
+// CCM RAM (not reachable by DMA; for a memset() also the descriptor,
+// which holds the value), are done by the CPU, synchronously,
+// and the callback is invoked before returning. The threshold defaults
+// to OS_INTEGER_DMA_MEMORY_THRESHOLD; the crossover benchmark
+// (OS_BENCHMARK_DMA_MEMORY) measures it, and updates it.
+//
+// The buffers must not overlap, and must not be changed by the CPU
+// while the transfer is in progress.
+
+#if !defined(OS_INTEGER_DMA_MEMORY_THRESHOLD)
+#define OS_INTEGER_DMA_MEMORY_THRESHOLD         (256)
+#endif
+
+#if !defined(OS_INTEGER_DMA_MEMORY_IRQ_PRIORITY)
+#define OS_INTEGER_DMA_MEMORY_IRQ_PRIORITY      (12)
+#endif
+
+#define DMA_TRANSFER_DONE                       (0)
+#define DMA_TRANSFER_ERROR                      (1)
+#define DMA_TRANSFER_PENDING                    (2)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  typedef struct dma_transfer_s dma_transfer_t;
+
+  typedef void
+  (*dma_callback_t) (dma_transfer_t* transfer, void* arg);
+
+  // The members are private.
+  struct dma_transfer_s
+  {
+    dma_transfer_t* next;
+    uint8_t* dst;
+    const uint8_t* src;
+    // The memset() pattern, the DMA source for a fill.
+    uint32_t value;
+    // The bytes left for the DMA, and those of the current chunk.
+    size_t size;
+    size_t chunk;
+    uint8_t element_size;
+    volatile uint8_t state;
+    dma_callback_t callback;
+    void* arg;
+  };
+
+  extern size_t dma_memory_threshold;
+
+  // Enable the DMA2 clock and interrupt.
+  void
+  dma_memory_init (void);
+
+  void
+  dma_memcpy (dma_transfer_t* transfer, void* dst, const void* src,
+              size_t n, dma_callback_t callback, void* arg);
+
+  void
+  dma_memset (dma_transfer_t* transfer, void* dst, int c, size_t n,
+              dma_callback_t callback, void* arg);
+
+  static inline bool
+  __attribute__((always_inline))
+  dma_transfer_done (const dma_transfer_t* transfer)
+  {
+    return transfer->state != DMA_TRANSFER_PENDING;
+  }
+
+  // Busy wait for the transfer to end; return DMA_TRANSFER_DONE or
+  // DMA_TRANSFER_ERROR.
+  static inline int
+  __attribute__((always_inline))
+  dma_transfer_wait (const dma_transfer_t* transfer)
+  {
+    while (transfer->state == DMA_TRANSFER_PENDING)
+      ;
+    return transfer->state;
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+#endif // DMA_MEMORY_H_
@@ -8,6 +8,7 @@
 #include "stm32f4xx.h"
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx_hal_cortex.h"
+#include "clock_tree.h"
 
 // ----------------------------------------------------------------------------
 
@@ -18,11 +19,11 @@
 //
 // The code to set the clock is at the end.
 //
-// Note1: The default clock settings assume that the HSE_VALUE is a multiple
-// of 1MHz, and try to reach the maximum speed available for the
-// board. It does NOT guarantee that the required USB clock of 48MHz is
-// available. If you need this, please update the settings of PLL_M, PLL_N,
-// PLL_P, PLL_Q to match your needs.
+// Note1: The clock tree is defined at compile time, in include/clock_tree.h;
+// the default settings assume that the HSE_VALUE is a multiple of 1MHz,
+// and reach 168 MHz, with the 48MHz USB clock. To change them, define
+// OS_INTEGER_CLOCK_PLL_M, _PLL_N, _PLL_P, _PLL_Q and the bus dividers;
+// invalid settings are reported by the compiler.
 //
 // Note2: The external memory controllers are not enabled. If needed, you
 // have to define DATA_IN_ExtSRAM or DATA_IN_ExtSDRAM and to configure
@@ -55,9 +56,9 @@ __initialize_hardware (void)
   // Enable HSE Oscillator and activate PLL with HSE as source
   SystemClock_Config ();
 
-  // Call the CSMSIS system clock routine to store the clock frequency
-  // in the SystemCoreClock global RAM location.
-  SystemCoreClockUpdate ();
+  // The clock is known at compile time, no need to compute it from
+  // the RCC registers.
+  SystemCoreClock = CLOCK_HCLK_HZ;
 
   // Initialise the HAL Library; it must be the first
   // instruction to be executed in the main program.
@@ -85,65 +86,34 @@ SysTick_Handler(void)
 
 // ----------------------------------------------------------------------------
 
-/**
- * @brief  System Clock Configuration
- *         The system Clock is configured as follow :
- *            System Clock source            = PLL (HSE)
- *            SYSCLK(Hz)                     = 168000000
- *            HCLK(Hz)                       = 168000000
- *            AHB Prescaler                  = 1
- *            APB1 Prescaler                 = 4
- *            APB2 Prescaler                 = 2
- *            HSE Frequency(Hz)              = HSE_VALUE
- *            PLL_M                          = (HSE_VALUE/1000000u)
- *            PLL_N                          = 336
- *            PLL_P                          = 2
- *            PLL_Q                          = 7
- *            VDD(V)                         = 3.3
- *            Main regulator output voltage  = Scale1 mode
- *            Flash Latency(WS)              = 5
- * @param  None
- * @retval None
- */
+// Switch to the PLL, with the register values computed by clock_tree.h;
+// SYSCLK = HSE / PLL_M * PLL_N / PLL_P, HCLK, PCLK1 and PCLK2 divided
+// from it, the flash wait states set for HCLK, regulator in scale 1.
 void
 SystemClock_Config (void)
 {
-  RCC_ClkInitTypeDef RCC_ClkInitStruct;
-  RCC_OscInitTypeDef RCC_OscInitStruct;
+  // Enable the Power Control clock, to set the voltage scaling.
+  RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+  PWR->CR |= PWR_CR_VOS;
 
-  // Enable Power Control clock
-  __PWR_CLK_ENABLE()
-  ;
+  RCC->CR |= RCC_CR_HSEON;
+  while ((RCC->CR & RCC_CR_HSERDY) == 0)
+    ;
 
-  // The voltage scaling allows optimizing the power consumption when the
-  // device is clocked below the maximum system frequency, to update the
-  // voltage scaling value regarding system frequency refer to product
-  // datasheet.
-  __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1);
+  RCC->PLLCFGR = CLOCK_RCC_PLLCFGR;
+  RCC->CR |= RCC_CR_PLLON;
 
-  // Enable HSE Oscillator and activate PLL with HSE as source
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
-  RCC_OscInitStruct.HSEState = RCC_HSE_ON;
-  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
-
-  // This assumes the HSE_VALUE is a multiple of 1MHz. If this is not
-  // your case, you have to recompute these PLL constants.
-  RCC_OscInitStruct.PLL.PLLM = (HSE_VALUE / 1000000u);
-  RCC_OscInitStruct.PLL.PLLN = 336;
-  RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2;
-  RCC_OscInitStruct.PLL.PLLQ = 7;
-  HAL_RCC_OscConfig (&RCC_OscInitStruct);
-
-  // Select PLL as system clock source and configure the HCLK, PCLK1 and PCLK2
-  // clocks dividers
-  RCC_ClkInitStruct.ClockType = (RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_HCLK
-      | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2);
-  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
-  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV4;
-  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV2;
-  HAL_RCC_ClockConfig (&RCC_ClkInitStruct, FLASH_LATENCY_5);
+  // The wait states and bus prescalers must be in place before the
+  // clock increases.
+  FLASH->ACR = CLOCK_FLASH_ACR;
+  RCC->CFGR = CLOCK_RCC_CFGR;
+
+  while ((RCC->CR & RCC_CR_PLLRDY) == 0)
+    ;
+
+  RCC->CFGR = CLOCK_RCC_CFGR | RCC_CFGR_SW_PLL;
+  while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL)
+    ;
 }
 
 // ----------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "dma_benchmark.h"
+#include "dma_memory.h"
+#include "cmsis_device.h"
+#include "diag/Trace.h"
+
+#include <string.h>
+
+#if defined(OS_BENCHMARK_DMA_MEMORY)
+
+// ----------------------------------------------------------------------------
+
+static uint32_t src_buffer[OS_INTEGER_BENCHMARK_DMA_MAX_SIZE / 4];
+static uint32_t dst_buffer[OS_INTEGER_BENCHMARK_DMA_MAX_SIZE / 4];
+
+void
+dma_benchmark_run (void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  for (size_t i = 0; i < sizeof(src_buffer) / sizeof(src_buffer[0]); ++i)
+    {
+      src_buffer[i] = i * 0x9E3779B9u;
+    }
+
+  size_t saved_threshold = dma_memory_threshold;
+  size_t crossover = 0;
+  dma_transfer_t transfer;
+
+  trace_printf ("%8s %8s %8s %8s\n", "bytes", "cpu", "dma set", "dma all");
+
+  for (size_t size = 16; size <= OS_INTEGER_BENCHMARK_DMA_MAX_SIZE; size *= 2)
+    {
+      uint32_t cpu = 0xFFFFFFFF;
+      uint32_t setup = 0xFFFFFFFF;
+      uint32_t total = 0xFFFFFFFF;
+      int errors = 0;
+
+      for (int run = 0; run < OS_INTEGER_BENCHMARK_DMA_RUNS; ++run)
+        {
+          uint32_t begin = DWT->CYCCNT;
+          memcpy (dst_buffer, src_buffer, size);
+          uint32_t cycles = DWT->CYCCNT - begin;
+          if (cycles < cpu)
+            {
+              cpu = cycles;
+            }
+
+          memset (dst_buffer, 0, size);
+
+          // Force the DMA for all sizes.
+          dma_memory_threshold = 0;
+          begin = DWT->CYCCNT;
+          dma_memcpy (&transfer, dst_buffer, src_buffer, size, NULL, NULL);
+          uint32_t started = DWT->CYCCNT;
+          int state = dma_transfer_wait (&transfer);
+          uint32_t end = DWT->CYCCNT;
+
+          if (started - begin < setup)
+            {
+              setup = started - begin;
+            }
+          if (end - begin < total)
+            {
+              total = end - begin;
+            }
+          if (state != DMA_TRANSFER_DONE
+              || memcmp (dst_buffer, src_buffer, size) != 0)
+            {
+              ++errors;
+            }
+        }
+
+      if (crossover == 0 && total < cpu)
+        {
+          crossover = size;
+        }
+
+      trace_printf ("%8u %8u %8u %8u%s\n", size, cpu, setup, total,
+                    errors ? " errors" : "");
+    }
+
+  if (crossover != 0)
+    {
+      dma_memory_threshold = crossover;
+      trace_printf ("DMA faster from %u bytes\n", crossover);
+    }
+  else
+    {
+      dma_memory_threshold = saved_threshold;
+      trace_printf ("DMA never faster\n");
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(OS_BENCHMARK_DMA_MEMORY)
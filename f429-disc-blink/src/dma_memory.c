@@ -0,0 +1,255 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "dma_memory.h"
+#include "cmsis_device.h"
+
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+
+#define DMA_MEMORY_STREAM       (DMA2_Stream0)
+
+#define DMA_MEMORY_FLAGS \
+  (DMA_LISR_TCIF0 | DMA_LISR_HTIF0 | DMA_LISR_TEIF0 | DMA_LISR_DMEIF0 \
+      | DMA_LISR_FEIF0)
+
+#define DMA_MEMORY_MAX_ITEMS    (0xFFFF)
+
+#define CCM_BEGIN               (CCMDATARAM_BASE)
+#define CCM_END                 (CCMDATARAM_BASE + 64 * 1024)
+
+size_t dma_memory_threshold = OS_INTEGER_DMA_MEMORY_THRESHOLD;
+
+// The transfer in progress is the head.
+static dma_transfer_t* volatile queue_head;
+static dma_transfer_t* queue_tail;
+
+// ----------------------------------------------------------------------------
+
+void
+dma_memory_init (void)
+{
+  RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+
+  DMA_MEMORY_STREAM->CR = 0;
+  DMA2->LIFCR = DMA_MEMORY_FLAGS;
+
+  NVIC_SetPriority (DMA2_Stream0_IRQn, OS_INTEGER_DMA_MEMORY_IRQ_PRIORITY);
+  NVIC_EnableIRQ (DMA2_Stream0_IRQn);
+}
+
+static bool
+in_ccm (const void* p, size_t n)
+{
+  uint32_t begin = (uint32_t) p;
+  return (begin < CCM_END) && (begin + n > CCM_BEGIN);
+}
+
+static void
+start_chunk (dma_transfer_t* t)
+{
+  DMA_Stream_TypeDef* stream = DMA_MEMORY_STREAM;
+
+  size_t items = t->size / t->element_size;
+  if (items > DMA_MEMORY_MAX_ITEMS)
+    {
+      items = DMA_MEMORY_MAX_ITEMS;
+    }
+  t->chunk = items * t->element_size;
+
+  uint32_t cr = DMA_SxCR_DIR_1 | DMA_SxCR_MINC | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+  if (t->element_size == 4)
+    {
+      cr |= DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1;
+    }
+
+  // In memory to memory mode the "peripheral" is the source.
+  if (t->src != NULL)
+    {
+      stream->PAR = (uint32_t) t->src;
+      cr |= DMA_SxCR_PINC;
+    }
+  else
+    {
+      stream->PAR = (uint32_t) &t->value;
+    }
+  stream->M0AR = (uint32_t) t->dst;
+  stream->NDTR = items;
+  // Direct mode is not allowed memory to memory; use the FIFO.
+  stream->FCR = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH;
+
+  DMA2->LIFCR = DMA_MEMORY_FLAGS;
+  stream->CR = cr;
+  stream->CR = cr | DMA_SxCR_EN;
+}
+
+static void
+finish (dma_transfer_t* t, uint8_t state)
+{
+  t->state = state;
+  if (t->callback != NULL)
+    {
+      t->callback (t, t->arg);
+    }
+}
+
+static void
+enqueue (dma_transfer_t* t)
+{
+  t->next = NULL;
+  t->state = DMA_TRANSFER_PENDING;
+
+  uint32_t primask = __get_PRIMASK ();
+  __disable_irq ();
+
+  if (queue_head == NULL)
+    {
+      queue_head = t;
+      queue_tail = t;
+      start_chunk (t);
+    }
+  else
+    {
+      queue_tail->next = t;
+      queue_tail = t;
+    }
+
+  __set_PRIMASK (primask);
+}
+
+void
+dma_memcpy (dma_transfer_t* transfer, void* dst, const void* src, size_t n,
+            dma_callback_t callback, void* arg)
+{
+  uint8_t* d = dst;
+  const uint8_t* s = src;
+
+  transfer->callback = callback;
+  transfer->arg = arg;
+
+  if (n < dma_memory_threshold || in_ccm (d, n) || in_ccm (s, n))
+    {
+      memcpy (d, s, n);
+      finish (transfer, DMA_TRANSFER_DONE);
+      return;
+    }
+
+  if ((((uint32_t) d ^ (uint32_t) s) & 3) == 0)
+    {
+      // Same alignment; the ends by the CPU, the middle by words.
+      while (((uint32_t) d & 3) != 0 && n != 0)
+        {
+          *d++ = *s++;
+          --n;
+        }
+      size_t tail = n & 3;
+      n -= tail;
+      memcpy (d + n, s + n, tail);
+      transfer->element_size = 4;
+    }
+  else
+    {
+      transfer->element_size = 1;
+    }
+
+  transfer->dst = d;
+  transfer->src = s;
+  transfer->size = n;
+  if (n == 0)
+    {
+      finish (transfer, DMA_TRANSFER_DONE);
+      return;
+    }
+  enqueue (transfer);
+}
+
+void
+dma_memset (dma_transfer_t* transfer, void* dst, int c, size_t n,
+            dma_callback_t callback, void* arg)
+{
+  uint8_t* d = dst;
+
+  transfer->callback = callback;
+  transfer->arg = arg;
+
+  // The DMA reads the value from the descriptor.
+  if (n < dma_memory_threshold || in_ccm (d, n)
+      || in_ccm (&transfer->value, sizeof(transfer->value)))
+    {
+      memset (d, c, n);
+      finish (transfer, DMA_TRANSFER_DONE);
+      return;
+    }
+
+  while (((uint32_t) d & 3) != 0 && n != 0)
+    {
+      *d++ = (uint8_t) c;
+      --n;
+    }
+  size_t tail = n & 3;
+  n -= tail;
+  memset (d + n, c, tail);
+
+  transfer->value = (uint8_t) c * 0x01010101u;
+  transfer->element_size = 4;
+  transfer->dst = d;
+  transfer->src = NULL;
+  transfer->size = n;
+  if (n == 0)
+    {
+      finish (transfer, DMA_TRANSFER_DONE);
+      return;
+    }
+  enqueue (transfer);
+}
+
+// ----------------------------------------------------------------------------
+
+void
+DMA2_Stream0_IRQHandler (void);
+
+void
+DMA2_Stream0_IRQHandler (void)
+{
+  uint32_t flags = DMA2->LISR & DMA_MEMORY_FLAGS;
+  DMA2->LIFCR = flags;
+
+  dma_transfer_t* t = queue_head;
+  if (t == NULL || (flags & (DMA_LISR_TCIF0 | DMA_LISR_TEIF0)) == 0)
+    {
+      return;
+    }
+
+  uint8_t state = DMA_TRANSFER_DONE;
+  if (flags & DMA_LISR_TEIF0)
+    {
+      state = DMA_TRANSFER_ERROR;
+    }
+  else
+    {
+      t->dst += t->chunk;
+      if (t->src != NULL)
+        {
+          t->src += t->chunk;
+        }
+      t->size -= t->chunk;
+      if (t->size != 0)
+        {
+          start_chunk (t);
+          return;
+        }
+    }
+
+  // Start the next transfer before the callback, which may queue more.
+  queue_head = t->next;
+  if (queue_head != NULL)
+    {
+      start_chunk (queue_head);
+    }
+  finish (t, state);
+}
+
+// ----------------------------------------------------------------------------
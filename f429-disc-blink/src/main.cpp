@@ -11,6 +11,8 @@
 
 #include "timer_systick.h"
 #include "blink_led.h"
+#include "dma_memory.h"
+#include "dma_benchmark.h"
 
 // ----------------------------------------------------------------------------
 //
@@ -107,6 +109,11 @@ main (int argc, char* argv[])
   timer_systick timer;
   timer.start ();
 
+  dma_memory_init ();
+
+#if defined(OS_BENCHMARK_DMA_MEMORY)
+  dma_benchmark_run ();
+#endif
 
 #define LOOP_COUNT (1 << (sizeof(blink_leds) / sizeof(blink_leds[0])))
 
@@ -0,0 +1,202 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#ifndef CLOCK_TREE_H_
+#define CLOCK_TREE_H_
+
+#include "cmsis_device.h"
+
+// ----------------------------------------------------------------------------
+
+// Compile time model of the STM32F1 clock tree (not the connectivity
+// line, which has a second PLL).
+//
+// The PLL source and multiplier and the bus prescalers are given by
+// the OS_USE_CLOCK_* and OS_INTEGER_CLOCK_* definitions below; the
+// preprocessor checks them against the device limits, and computes
+// the bus frequencies and the RCC/FLASH register values, so the clock
+// setup in __initialize_hardware_early() is a fixed sequence of
+// stores, and the peripheral clocks are constants (CLOCK_*_HZ, or
+// clock_tree::* in C++) instead of run time divisions of
+// SystemCoreClock.
+//
+// By default the PLL runs from HSI/2, at 64 MHz, which needs no
+// external parts. With OS_USE_CLOCK_HSE defined, it runs from the HSE
+// (OS_INTEGER_CLOCK_HSE_HZ, a plain number, defaults to HSE_VALUE), at
+// 72 MHz from 8 MHz; on the Nucleo boards the HSE is the 8 MHz MCO
+// output of the ST-LINK, so also define OS_USE_CLOCK_HSE_BYPASS.
+
+#if defined(STM32F10X_CL)
+#error "The connectivity line clock tree is not modelled"
+#endif
+
+#if !defined(OS_INTEGER_CLOCK_HSE_HZ)
+#define OS_INTEGER_CLOCK_HSE_HZ                 (HSE_VALUE)
+#endif
+
+// PLL input = HSE / PREDIV (1 or 2), or HSI / 2.
+#if !defined(OS_INTEGER_CLOCK_PLL_PREDIV)
+#define OS_INTEGER_CLOCK_PLL_PREDIV             (1)
+#endif
+
+// SYSCLK = PLL input * MUL (2-16).
+#if !defined(OS_INTEGER_CLOCK_PLL_MUL)
+#if defined(OS_USE_CLOCK_HSE)
+#define OS_INTEGER_CLOCK_PLL_MUL                (72000000 / OS_INTEGER_CLOCK_HSE_HZ)
+#else
+#define OS_INTEGER_CLOCK_PLL_MUL                (16)
+#endif
+#endif
+
+// HCLK = SYSCLK / AHB divider (1, 2, 4, ..., 512, except 32).
+#if !defined(OS_INTEGER_CLOCK_AHB_DIV)
+#define OS_INTEGER_CLOCK_AHB_DIV                (1)
+#endif
+
+// PCLK1/2 = HCLK / APB1/2 divider (1, 2, 4, 8, 16).
+#if !defined(OS_INTEGER_CLOCK_APB1_DIV)
+#define OS_INTEGER_CLOCK_APB1_DIV               (2)
+#endif
+
+#if !defined(OS_INTEGER_CLOCK_APB2_DIV)
+#define OS_INTEGER_CLOCK_APB2_DIV               (1)
+#endif
+
+// ADC clock = PCLK2 / ADC divider (2, 4, 6, 8).
+#if !defined(OS_INTEGER_CLOCK_ADC_DIV)
+#define OS_INTEGER_CLOCK_ADC_DIV                (6)
+#endif
+
+// ----- Frequencies ----------------------------------------------------------
+
+#if defined(OS_USE_CLOCK_HSE)
+#define CLOCK_PLL_IN_HZ \
+  (OS_INTEGER_CLOCK_HSE_HZ / OS_INTEGER_CLOCK_PLL_PREDIV)
+#else
+// HSI_VALUE is cast, not usable by #if.
+#define CLOCK_PLL_IN_HZ                         (8000000 / 2)
+#endif
+
+#define CLOCK_SYSCLK_HZ \
+  (CLOCK_PLL_IN_HZ * OS_INTEGER_CLOCK_PLL_MUL)
+#define CLOCK_HCLK_HZ \
+  (CLOCK_SYSCLK_HZ / OS_INTEGER_CLOCK_AHB_DIV)
+#define CLOCK_PCLK1_HZ \
+  (CLOCK_HCLK_HZ / OS_INTEGER_CLOCK_APB1_DIV)
+#define CLOCK_PCLK2_HZ \
+  (CLOCK_HCLK_HZ / OS_INTEGER_CLOCK_APB2_DIV)
+#define CLOCK_ADC_HZ \
+  (CLOCK_PCLK2_HZ / OS_INTEGER_CLOCK_ADC_DIV)
+
+// The timers run at twice the bus clock when the bus is divided.
+#define CLOCK_TIM_APB1_HZ \
+  (OS_INTEGER_CLOCK_APB1_DIV == 1 ? CLOCK_PCLK1_HZ : 2 * CLOCK_PCLK1_HZ)
+#define CLOCK_TIM_APB2_HZ \
+  (OS_INTEGER_CLOCK_APB2_DIV == 1 ? CLOCK_PCLK2_HZ : 2 * CLOCK_PCLK2_HZ)
+
+// ----- Checks ---------------------------------------------------------------
+
+#if (OS_INTEGER_CLOCK_PLL_PREDIV != 1) && (OS_INTEGER_CLOCK_PLL_PREDIV != 2)
+#error "PLL_PREDIV must be 1 or 2"
+#endif
+
+#if defined(OS_USE_CLOCK_HSE) \
+  && ((OS_INTEGER_CLOCK_HSE_HZ < 4000000) || (OS_INTEGER_CLOCK_HSE_HZ > 16000000))
+#error "HSE out of range (4-16 MHz)"
+#endif
+
+#if (OS_INTEGER_CLOCK_PLL_MUL < 2) || (OS_INTEGER_CLOCK_PLL_MUL > 16)
+#error "PLL_MUL out of range (2-16)"
+#endif
+
+#if (CLOCK_SYSCLK_HZ < 16000000) || (CLOCK_SYSCLK_HZ > 72000000)
+#error "PLL output out of range (16-72 MHz)"
+#endif
+
+#if (OS_INTEGER_CLOCK_AHB_DIV != 1) && (OS_INTEGER_CLOCK_AHB_DIV != 2) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 4) && (OS_INTEGER_CLOCK_AHB_DIV != 8) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 16) && (OS_INTEGER_CLOCK_AHB_DIV != 64) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 128) && (OS_INTEGER_CLOCK_AHB_DIV != 256) \
+  && (OS_INTEGER_CLOCK_AHB_DIV != 512)
+#error "AHB divider must be 1, 2, 4, 8, 16, 64, 128, 256 or 512"
+#endif
+
+#if (OS_INTEGER_CLOCK_APB1_DIV != 1) && (OS_INTEGER_CLOCK_APB1_DIV != 2) \
+  && (OS_INTEGER_CLOCK_APB1_DIV != 4) && (OS_INTEGER_CLOCK_APB1_DIV != 8) \
+  && (OS_INTEGER_CLOCK_APB1_DIV != 16)
+#error "APB1 divider must be 1, 2, 4, 8 or 16"
+#endif
+
+#if (OS_INTEGER_CLOCK_APB2_DIV != 1) && (OS_INTEGER_CLOCK_APB2_DIV != 2) \
+  && (OS_INTEGER_CLOCK_APB2_DIV != 4) && (OS_INTEGER_CLOCK_APB2_DIV != 8) \
+  && (OS_INTEGER_CLOCK_APB2_DIV != 16)
+#error "APB2 divider must be 1, 2, 4, 8 or 16"
+#endif
+
+#if (OS_INTEGER_CLOCK_ADC_DIV != 2) && (OS_INTEGER_CLOCK_ADC_DIV != 4) \
+  && (OS_INTEGER_CLOCK_ADC_DIV != 6) && (OS_INTEGER_CLOCK_ADC_DIV != 8)
+#error "ADC divider must be 2, 4, 6 or 8"
+#endif
+
+#if CLOCK_PCLK1_HZ > 36000000
+#error "PCLK1 above 36 MHz"
+#endif
+
+#if CLOCK_ADC_HZ > 14000000
+#error "ADC clock above 14 MHz"
+#endif
+
+// ----- Register values ------------------------------------------------------
+
+// Flash wait states for SYSCLK.
+#define CLOCK_FLASH_LATENCY \
+  (CLOCK_SYSCLK_HZ <= 24000000 ? 0 : CLOCK_SYSCLK_HZ <= 48000000 ? 1 : 2)
+
+#define CLOCK_HPRE_BITS(_D) \
+  ((_D) == 1 ? 0 : (_D) == 2 ? 8 : (_D) == 4 ? 9 : (_D) == 8 ? 10 \
+      : (_D) == 16 ? 11 : (_D) == 64 ? 12 : (_D) == 128 ? 13 \
+      : (_D) == 256 ? 14 : 15)
+#define CLOCK_PPRE_BITS(_D) \
+  ((_D) == 1 ? 0 : (_D) == 2 ? 4 : (_D) == 4 ? 5 : (_D) == 8 ? 6 : 7)
+
+#if defined(OS_USE_CLOCK_HSE)
+#define CLOCK_RCC_CFGR_PLLSRC \
+  (RCC_CFGR_PLLSRC | (OS_INTEGER_CLOCK_PLL_PREDIV == 2 ? RCC_CFGR_PLLXTPRE : 0))
+#else
+#define CLOCK_RCC_CFGR_PLLSRC                   (0)
+#endif
+
+// The prescalers and PLL only; SW is added when switching to the PLL.
+#define CLOCK_RCC_CFGR \
+  ((uint32_t) ((CLOCK_HPRE_BITS(OS_INTEGER_CLOCK_AHB_DIV) << 4) \
+      | (CLOCK_PPRE_BITS(OS_INTEGER_CLOCK_APB1_DIV) << 8) \
+      | (CLOCK_PPRE_BITS(OS_INTEGER_CLOCK_APB2_DIV) << 11) \
+      | ((OS_INTEGER_CLOCK_ADC_DIV / 2 - 1) << 14) \
+      | CLOCK_RCC_CFGR_PLLSRC \
+      | ((OS_INTEGER_CLOCK_PLL_MUL - 2) << 18)))
+
+#define CLOCK_FLASH_ACR \
+  ((uint32_t) (CLOCK_FLASH_LATENCY | FLASH_ACR_PRFTBE))
+
+// ----------------------------------------------------------------------------
+
+#if defined(__cplusplus)
+
+namespace clock_tree
+{
+  constexpr uint32_t sysclk_hz = CLOCK_SYSCLK_HZ;
+  constexpr uint32_t hclk_hz = CLOCK_HCLK_HZ;
+  constexpr uint32_t pclk1_hz = CLOCK_PCLK1_HZ;
+  constexpr uint32_t pclk2_hz = CLOCK_PCLK2_HZ;
+  constexpr uint32_t tim_apb1_hz = CLOCK_TIM_APB1_HZ;
+  constexpr uint32_t tim_apb2_hz = CLOCK_TIM_APB2_HZ;
+  constexpr uint32_t adc_hz = CLOCK_ADC_HZ;
+}
+
+#endif // defined(__cplusplus)
+
+// ----------------------------------------------------------------------------
+
+#endif // CLOCK_TREE_H_
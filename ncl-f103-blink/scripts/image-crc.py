@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+#
+# This file is part of the GNU ARM Eclipse distribution.
+# Copyright (c) 2014 Liviu Ionescu.
+#
+# Stamp the CRC-32 of the flash image into the .image_crc section of
+# the ELF, as a post-build step; crc32_check_image() (include/crc32.h)
+# verifies it at boot.
+#
+# The CRC is computed as the STM32 CRC unit does (polynomial
+# 0x04C11DB7, initial value 0xFFFFFFFF, not reflected, no final XOR,
+# little endian words), over the flash content from the vectors up to
+# .image_crc, with the gaps filled with 0xFF, as left by the
+# programmer.
+#
+# Usage:
+#   image-crc.py project.elf [--prefix arm-none-eabi-]
+#
+
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+
+def crc32_stm32(data, crc=0xFFFFFFFF):
+    table = []
+    for i in range(256):
+        c = i << 24
+        for _ in range(8):
+            c = ((c << 1) ^ 0x04C11DB7) if c & 0x80000000 else (c << 1)
+        table.append(c & 0xFFFFFFFF)
+
+    def byte(crc, b):
+        return ((crc << 8) & 0xFFFFFFFF) ^ table[(crc >> 24) ^ b]
+
+    words = len(data) // 4
+    for i in range(words):
+        # Each little endian word, MSB first.
+        for b in reversed(data[4 * i:4 * i + 4]):
+            crc = byte(crc, b)
+    for b in data[4 * words:]:
+        crc = byte(crc, b)
+    return crc
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Stamp the flash image CRC-32 into an ELF file.')
+    parser.add_argument('elf')
+    parser.add_argument('--prefix', default='arm-none-eabi-',
+                        help='toolchain prefix (default arm-none-eabi-)')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        image = os.path.join(tmp, 'image.bin')
+        # Only the flash sections; .image_crc is the last one.
+        subprocess.check_call([args.prefix + 'objcopy', '-O', 'binary',
+                               '--gap-fill', '0xff',
+                               '--remove-section', '.bss*',
+                               '--remove-section', '.noinit*',
+                               args.elf, image])
+        with open(image, 'rb') as f:
+            data = f.read()
+
+        crc = crc32_stm32(data[:-4])
+        stamp = os.path.join(tmp, 'crc.bin')
+        with open(stamp, 'wb') as f:
+            f.write(struct.pack('<I', crc))
+
+        subprocess.check_call([args.prefix + 'objcopy',
+                               '--update-section', '.image_crc=' + stamp,
+                               args.elf])
+
+    print('%s: image CRC-32 %08X, %d bytes' % (args.elf, crc, len(data) - 4))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
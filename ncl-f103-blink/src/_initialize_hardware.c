@@ -0,0 +1,77 @@
+//
+// This file is part of the µOS++ III distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+// ----------------------------------------------------------------------------
+
+#include "cmsis_device.h"
+#include "clock_tree.h"
+
+// ----------------------------------------------------------------------------
+
+// The clock tree is defined at compile time, in include/clock_tree.h,
+// and set here with the register values computed there, instead of
+// SystemInit()/SetSysClock() and SystemCoreClockUpdate().
+
+extern unsigned int __vectors_start;
+
+// Forward declarations.
+
+void
+__initialize_hardware_early (void);
+
+void
+__initialize_hardware (void);
+
+// ----------------------------------------------------------------------------
+
+// Called early from _start(), right before data & bss init.
+//
+// After Reset the Cortex-M processor is in Thread mode,
+// priority is Privileged, and the Stack is set to Main.
+
+void
+__initialize_hardware_early (void)
+{
+#if defined(OS_USE_CLOCK_HSE)
+#if defined(OS_USE_CLOCK_HSE_BYPASS)
+  RCC->CR |= RCC_CR_HSEBYP;
+#endif
+  RCC->CR |= RCC_CR_HSEON;
+  while ((RCC->CR & RCC_CR_HSERDY) == 0)
+    ;
+#endif
+
+  // The wait states must be in place before the clock increases.
+  FLASH->ACR = CLOCK_FLASH_ACR;
+  RCC->CFGR = CLOCK_RCC_CFGR;
+
+  RCC->CR |= RCC_CR_PLLON;
+  while ((RCC->CR & RCC_CR_PLLRDY) == 0)
+    ;
+
+  RCC->CFGR = CLOCK_RCC_CFGR | RCC_CFGR_SW_PLL;
+  while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL)
+    ;
+
+  // Set VTOR to the actual address, provided by the linker script.
+  SCB->VTOR = (uint32_t) (&__vectors_start);
+
+#if defined(OS_DEBUG_SEMIHOSTING_FAULTS)
+  SCB->SHCSR |= SCB_SHCSR_USGFAULTENA_Msk;
+#endif
+}
+
+// Called from _start(), right after data & bss init, before
+// constructors.
+
+void
+__initialize_hardware (void)
+{
+  // The clock is known at compile time, no need to compute it from
+  // the RCC registers.
+  SystemCoreClock = CLOCK_HCLK_HZ;
+}
+
+// ----------------------------------------------------------------------------
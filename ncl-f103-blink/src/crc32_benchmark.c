@@ -0,0 +1,80 @@
+//
+// This file is part of the GNU ARM Eclipse distribution.
+// Copyright (c) 2014 Liviu Ionescu.
+//
+
+#include "crc32_benchmark.h"
+#include "crc32.h"
+#include "cmsis_device.h"
+#include "diag/Trace.h"
+
+#if defined(OS_BENCHMARK_CRC32)
+
+// ----------------------------------------------------------------------------
+
+static uint32_t buffer[OS_INTEGER_BENCHMARK_CRC32_SIZE / 4];
+
+// Print hundredths of MB/s.
+static void
+print_rate (const char* name, size_t size, uint32_t cycles)
+{
+  uint32_t rate = (uint32_t) ((uint64_t) size * (SystemCoreClock / 10000)
+      / (cycles ? cycles : 1));
+  trace_printf ("  %-8s %8u cycles %4u.%02u MB/s\n", name, cycles,
+                rate / 100, rate % 100);
+}
+
+void
+crc32_benchmark_run (void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  uint32_t x = 0x2545F491;
+  for (size_t i = 0; i < sizeof(buffer) / sizeof(buffer[0]); ++i)
+    {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      buffer[i] = x;
+    }
+
+  trace_printf ("CRC-32, unit %s\n",
+                crc32_hardware_available () ? "available" : "not available");
+
+  for (size_t size = 64; size <= OS_INTEGER_BENCHMARK_CRC32_SIZE; size *= 4)
+    {
+      trace_printf ("%u bytes\n", size);
+
+      uint32_t begin = DWT->CYCCNT;
+      uint32_t expected = crc32_software (CRC32_INIT, buffer, size);
+      print_rate ("table", size, DWT->CYCCNT - begin);
+
+      if (!crc32_hardware_available ())
+        {
+          continue;
+        }
+
+      uint32_t crc = CRC32_INIT;
+      begin = DWT->CYCCNT;
+      crc32_hardware (&crc, buffer, size, false);
+      print_rate ("unit", size, DWT->CYCCNT - begin);
+      if (crc != expected)
+        {
+          trace_printf ("  unit %08X != table %08X\n", crc, expected);
+        }
+
+      crc = CRC32_INIT;
+      begin = DWT->CYCCNT;
+      crc32_hardware (&crc, buffer, size, true);
+      print_rate ("unit+dma", size, DWT->CYCCNT - begin);
+      if (crc != expected)
+        {
+          trace_printf ("  unit+dma %08X != table %08X\n", crc, expected);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+#endif // defined(OS_BENCHMARK_CRC32)
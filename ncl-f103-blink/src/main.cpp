@@ -11,6 +11,8 @@
 
 #include "timer_systick.h"
 #include "blink_led.h"
+#include "crc32.h"
+#include "crc32_benchmark.h"
 
 // ----------------------------------------------------------------------------
 //
@@ -118,6 +120,24 @@ main (int argc, char* argv[])
   timer_systick timer;
   timer.start ();
 
+  crc32_init ();
+
+  // Check the flash image against the CRC stamped after the link.
+  int image = crc32_check_image ();
+  if (image == CRC32_IMAGE_NOT_STAMPED)
+    {
+      trace_puts ("Image CRC not stamped.");
+    }
+  else if (image != CRC32_IMAGE_OK)
+    {
+      trace_puts ("Image CRC mismatch, stopped.");
+      for (;;)
+        ;
+    }
+
+#if defined(OS_BENCHMARK_CRC32)
+  crc32_benchmark_run ();
+#endif
 
 #define LOOP_COUNT (5)
   int loops = LOOP_COUNT;
@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+#
+# This file is part of the GNU ARM Eclipse distribution.
+# Copyright (c) 2014 Liviu Ionescu.
+#
+# Per project selection of the vendor driver modules (the STM32F4 HAL,
+# or the STM32F0/F1 Standard Peripherals Library, in
+# system/src/stm32*-*/).
+#
+# Each project lists the modules it builds in drivers.txt, one file
+# name without the .c per line, # comments allowed; all the other
+# modules of the driver folder are excluded from the build.
+#
+#   sync    rewrite the 'system' folder exclusions of all the build
+#           configurations in .cproject from drivers.txt;
+#   check   verify that .cproject matches drivers.txt, and that all the
+#           configurations compile with -ffunction-sections and
+#           -fdata-sections and link with --gc-sections; the exit code
+#           is 1 on any mismatch;
+#   report  print the bytes each object file (module) takes in the
+#           final image, and the bytes --gc-sections removed from it,
+#           from the linker map file (Debug/<project>.map).
+#
+# Usage:
+#   drivers.py sync PROJECT...
+#   drivers.py check PROJECT...
+#   drivers.py report MAP [--all]
+#
+
+import argparse
+import glob
+import os
+import re
+import sys
+
+MANIFEST = 'drivers.txt'
+
+# The folders with vendor drivers, relative to system/.
+DRIVER_FOLDERS = 'src/stm32*-hal src/stm32*-stdperiph'.split()
+
+# The options that must be true in every build configuration.
+SECTION_OPTIONS = ('optimization.functionsections',
+                   'optimization.datasections',
+                   'linker.gcsections')
+
+SYSTEM_ENTRY = re.compile(
+    r'<entry excluding="([^"]*)"([^>]*kind="sourcePath" name="system"/>)')
+
+
+def driver_folder(project):
+    folders = []
+    for pattern in DRIVER_FOLDERS:
+        folders += glob.glob(os.path.join(project, 'system', pattern))
+    if len(folders) != 1:
+        return None
+    return os.path.relpath(folders[0], os.path.join(project, 'system'))
+
+
+def read_manifest(project):
+    modules = []
+    with open(os.path.join(project, MANIFEST)) as f:
+        for line in f:
+            line = line.split('#', 1)[0].strip()
+            if line:
+                modules.append(line)
+    return modules
+
+
+def excluded_drivers(project, folder, modules):
+    available = sorted(
+        os.path.basename(f)[:-2]
+        for f in glob.glob(os.path.join(project, 'system', folder, '*.c')))
+    unknown = [m for m in modules if m not in available]
+    if unknown:
+        raise ValueError('%s: not in %s: %s' %
+                         (project, folder, ', '.join(unknown)))
+    return ['%s/%s.c' % (folder, m) for m in available if m not in modules]
+
+
+def split_exclusions(value, folder):
+    # The driver exclusions, and the others, kept as they are.
+    drivers = []
+    others = []
+    for e in value.split('|'):
+        if e.startswith(folder + '/'):
+            drivers.append(e)
+        elif e:
+            others.append(e)
+    return drivers, others
+
+
+def sync(project):
+    folder = driver_folder(project)
+    if folder is None:
+        print('%s: no driver folder, skipped' % project)
+        return 0
+
+    excluded = excluded_drivers(project, folder, read_manifest(project))
+    path = os.path.join(project, '.cproject')
+    with open(path, newline='') as f:
+        text = f.read()
+
+    def replace(m):
+        _, others = split_exclusions(m.group(1), folder)
+        return '<entry excluding="%s"%s' % ('|'.join(others + excluded),
+                                           m.group(2))
+
+    text, count = SYSTEM_ENTRY.subn(replace, text)
+    if count == 0:
+        raise ValueError('%s: no system source entry in .cproject' % project)
+
+    with open(path, 'w', newline='') as f:
+        f.write(text)
+    print('%s: %d configurations, %d modules excluded' %
+          (project, count, len(excluded)))
+    return 0
+
+
+def check(project):
+    path = os.path.join(project, '.cproject')
+    with open(path) as f:
+        text = f.read()
+    errors = 0
+
+    for option in SECTION_OPTIONS:
+        values = re.findall(r'superClass="[^"]*\.%s"[^>]*? value="([^"]*)"' %
+                            re.escape(option), text)
+        if not values or any(v != 'true' for v in values):
+            print('%s: %s not enabled in all configurations' %
+                  (project, option))
+            errors += 1
+
+    folder = driver_folder(project)
+    if folder is not None:
+        expected = set(excluded_drivers(project, folder,
+                                        read_manifest(project)))
+        for m in SYSTEM_ENTRY.finditer(text):
+            drivers, _ = split_exclusions(m.group(1), folder)
+            if set(drivers) != expected:
+                built = sorted(os.path.basename(e)[:-2]
+                               for e in expected - set(drivers))
+                listed = sorted(os.path.basename(e)[:-2]
+                                for e in set(drivers) - expected)
+                print('%s: .cproject differs from %s '
+                      '(built, not listed: %s; listed, not built: %s)' %
+                      (project, MANIFEST, ', '.join(built) or '-',
+                       ', '.join(listed) or '-'))
+                errors += 1
+                break
+
+    if errors == 0:
+        print('%s: ok' % project)
+    return 1 if errors else 0
+
+
+def parse_map(path):
+    # Sizes of the input sections, per object file, from the map file:
+    # (used flash, used ram, discarded).
+    modules = {}
+    state = None
+    section = None
+    pending = None
+    line_re = re.compile(
+        r'^ (\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if line.startswith('Discarded input sections'):
+                state = 'discarded'
+                continue
+            if line.startswith('Memory Configuration'):
+                state = None
+                continue
+            if line.startswith('Linker script and memory map'):
+                state = 'map'
+                continue
+            if state is None:
+                continue
+
+            # Output sections start in the first column.
+            if state == 'map' and line[:1] == '.':
+                section = line.split()[0]
+                continue
+
+            # Long input section names are alone on their line.
+            if re.match(r'^ \S+$', line):
+                pending = line.strip()
+                continue
+
+            m = line_re.match(line)
+            if not m:
+                pending = None
+                continue
+            name = m.group(1) or pending
+            pending = None
+            if name is None or name == '*fill*':
+                continue
+            address = int(m.group(2), 16)
+            size = int(m.group(3), 16)
+            module = m.group(4).strip()
+            if size == 0:
+                continue
+
+            sizes = modules.setdefault(module, [0, 0, 0])
+            if state == 'discarded':
+                sizes[2] += size
+            elif address == 0 or section is None:
+                # Not loaded, like the debug sections.
+                continue
+            elif section.startswith(('.bss', '.noinit', '._user_heap')):
+                sizes[1] += size
+            elif section.startswith('.data'):
+                sizes[0] += size
+                sizes[1] += size
+            else:
+                sizes[0] += size
+    return modules
+
+
+def report(path, show_all):
+    modules = parse_map(path)
+    rows = sorted(modules.items(), key=lambda kv: (-kv[1][0], kv[0]))
+    total = [0, 0, 0]
+
+    print('%8s %8s %10s  %s' % ('flash', 'ram', 'discarded', 'module'))
+    for module, sizes in rows:
+        for i in range(3):
+            total[i] += sizes[i]
+        if sizes[0] == 0 and sizes[1] == 0 and not show_all:
+            continue
+        print('%8d %8d %10d  %s' % (sizes[0], sizes[1], sizes[2], module))
+    print('%8d %8d %10d  total' % tuple(total))
+
+    # Modules entirely discarded should not be built at all.
+    unused = sorted(m for m, s in modules.items()
+                    if s[0] == 0 and s[1] == 0 and s[2] != 0
+                    and '/system/src/stm32' in m)
+    if unused:
+        print('\nDriver modules with no bytes in the image '
+              '(candidates for removal from %s):' % MANIFEST)
+        for m in unused:
+            print('  ' + os.path.splitext(os.path.basename(m))[0])
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Per project selection of the vendor driver modules.')
+    sub = parser.add_subparsers(dest='command')
+    p = sub.add_parser('sync', help='update .cproject from ' + MANIFEST)
+    p.add_argument('projects', nargs='+')
+    p = sub.add_parser('check', help='verify .cproject')
+    p.add_argument('projects', nargs='+')
+    p = sub.add_parser('report', help='bytes per module, from the map file')
+    p.add_argument('map')
+    p.add_argument('--all', action='store_true',
+                   help='also list the modules with no bytes in the image')
+    args = parser.parse_args()
+
+    try:
+        if args.command == 'sync':
+            for project in args.projects:
+                sync(project.rstrip('/'))
+            return 0
+        if args.command == 'check':
+            return max(check(project.rstrip('/'))
+                       for project in args.projects)
+        if args.command == 'report':
+            return report(args.map, args.all)
+    except (OSError, ValueError) as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    parser.print_help()
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# This file is part of the GNU ARM Eclipse distribution.
+# Copyright (c) 2014 Liviu Ionescu.
+#
+# Compare the system/ copies of the projects, per family.
+#
+# Each project carries its own system/ tree (CMSIS, cortexm startup,
+# diag/trace, newlib glue, vendor drivers), so it can be imported and
+# built alone. This script shows how the copies of each folder differ
+# between the projects of the same family: the distinct variants, the
+# projects using each, and, with --files, the files where a variant
+# differs from the most common one; it is the list of places to update
+# when a change is made to one of them.
+#
+# Usage:
+#   system-diff.py [--files] [FOLDER...]
+#
+# FOLDER is a system/ sub-folder, like src/cortexm or include/diag;
+# by default all of src/ and include/.
+#
+
+import argparse
+import glob
+import hashlib
+import os
+import sys
+
+
+def family(project):
+    for pattern, name in (('stm32f0*', 'stm32f0'), ('stm32f1*', 'stm32f1'),
+                          ('stm32f4*', 'stm32f4')):
+        if glob.glob(os.path.join(project, 'system', 'src', pattern)):
+            return name
+    return 'cortex-m'
+
+
+def digest_files(folder):
+    files = {}
+    for root, _, names in os.walk(folder):
+        for name in names:
+            path = os.path.join(root, name)
+            with open(path, 'rb') as f:
+                files[os.path.relpath(path, folder)] = hashlib.md5(
+                    f.read()).hexdigest()
+    return files
+
+
+def compare(projects, folder, show_files):
+    variants = {}
+    for project in projects:
+        path = os.path.join(project, 'system', folder)
+        if not os.path.isdir(path):
+            continue
+        files = digest_files(path)
+        key = hashlib.md5(repr(sorted(files.items())).encode()).hexdigest()
+        variants.setdefault(key, (files, []))[1].append(project)
+
+    if len(variants) <= 1:
+        return 0
+
+    ordered = sorted(variants.values(), key=lambda v: -len(v[1]))
+    common = ordered[0][0]
+    print('  %s: %d variants' % (folder, len(ordered)))
+    for files, users in ordered:
+        print('    %s' % ' '.join(sorted(users)))
+        if show_files and files is not common:
+            names = sorted(set(files) | set(common))
+            for name in names:
+                if name not in common:
+                    print('      + %s' % name)
+                elif name not in files:
+                    print('      - %s' % name)
+                elif files[name] != common[name]:
+                    print('      ~ %s' % name)
+    return len(ordered) - 1
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare the system/ copies of the projects.')
+    parser.add_argument('folders', nargs='*')
+    parser.add_argument('--files', action='store_true',
+                        help='list the files which differ from the most '
+                        'common variant')
+    args = parser.parse_args()
+
+    projects = sorted(os.path.dirname(p)
+                      for p in glob.glob('*/system')
+                      if os.path.isdir(p))
+    families = {}
+    for project in projects:
+        families.setdefault(family(project), []).append(project)
+
+    for name in sorted(families):
+        members = families[name]
+        folders = args.folders
+        if not folders:
+            folders = sorted(set(
+                os.path.relpath(d, os.path.join(p, 'system'))
+                for p in members
+                for d in glob.glob(os.path.join(p, 'system', '*', '*'))
+                if os.path.isdir(d)))
+        print('%s (%d projects)' % (name, len(members)))
+        differences = 0
+        for folder in folders:
+            differences += compare(members, folder, args.files)
+        if differences == 0:
+            print('  identical')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())